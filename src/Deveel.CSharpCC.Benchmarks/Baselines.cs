@@ -0,0 +1,122 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+using BenchmarkDotNet.Reports;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// Compares the results of a run with the ones stored in the baseline
+	/// directory, one CSV file per benchmark class.
+	/// </summary>
+	/// <remarks>
+	/// A benchmark regresses when its mean time grows by more than
+	/// <see cref="TimeTolerance"/> or its allocations by more than
+	/// <see cref="AllocationTolerance"/>. Allocations of the generated code do not
+	/// depend on the machine, so their tolerance is much smaller.
+	/// </remarks>
+	public static class Baselines {
+		public const double TimeTolerance = 0.10;
+		public const double AllocationTolerance = 0.02;
+
+		private sealed class Result {
+			public double MeanNanoseconds;
+			public long AllocatedBytes;
+		}
+
+		/// <summary>
+		/// Reports the regressions of the summaries against the baselines, or
+		/// replaces the baselines when <paramref name="update"/> is set.
+		/// </summary>
+		/// <returns>
+		/// Returns <c>false</c> if any benchmark regressed.
+		/// </returns>
+		public static bool Check(IEnumerable<Summary> summaries, string directory, bool update, TextWriter output) {
+			bool passed = true;
+			foreach (Summary summary in summaries) {
+				Dictionary<string, Result> results = GetResults(summary);
+				if (results.Count == 0)
+					continue;
+
+				string name = summary.BenchmarksCases[0].Descriptor.Type.Name;
+				string file = Path.Combine(directory, name + ".csv");
+				if (update) {
+					Directory.CreateDirectory(directory);
+					Write(file, results);
+					output.WriteLine("Updated the baseline {0}", file);
+					continue;
+				}
+
+				if (!File.Exists(file)) {
+					output.WriteLine("No baseline for {0}: run with --update-baselines to create it.", name);
+					continue;
+				}
+
+				Dictionary<string, Result> baseline = Read(file);
+				foreach (KeyValuePair<string, Result> pair in results) {
+					Result expected;
+					if (!baseline.TryGetValue(pair.Key, out expected))
+						continue;
+
+					double time = pair.Value.MeanNanoseconds / expected.MeanNanoseconds - 1;
+					if (time > TimeTolerance) {
+						output.WriteLine("REGRESSION {0}: {1:0.0}% slower than the baseline", pair.Key, time * 100);
+						passed = false;
+					}
+
+					if (expected.AllocatedBytes >= 0 && pair.Value.AllocatedBytes > expected.AllocatedBytes * (1 + AllocationTolerance)) {
+						output.WriteLine("REGRESSION {0}: allocates {1} bytes, the baseline {2}",
+							pair.Key, pair.Value.AllocatedBytes, expected.AllocatedBytes);
+						passed = false;
+					}
+				}
+			}
+
+			return passed;
+		}
+
+		private static Dictionary<string, Result> GetResults(Summary summary) {
+			Dictionary<string, Result> results = new Dictionary<string, Result>();
+			foreach (BenchmarkReport report in summary.Reports) {
+				if (report.ResultStatistics == null)
+					continue;
+
+				Result result = new Result();
+				result.MeanNanoseconds = report.ResultStatistics.Mean;
+				long? allocated = report.GcStats.GetBytesAllocatedPerOperation(report.BenchmarkCase);
+				result.AllocatedBytes = allocated == null ? -1 : allocated.Value;
+				results[report.BenchmarkCase.DisplayInfo] = result;
+			}
+			return results;
+		}
+
+		private static void Write(string file, Dictionary<string, Result> results) {
+			using (StreamWriter writer = new StreamWriter(file, false, new UTF8Encoding(false))) {
+				writer.WriteLine("Benchmark;MeanNanoseconds;AllocatedBytes");
+				foreach (KeyValuePair<string, Result> pair in results) {
+					writer.WriteLine("{0};{1};{2}", pair.Key,
+						pair.Value.MeanNanoseconds.ToString("R", CultureInfo.InvariantCulture),
+						pair.Value.AllocatedBytes.ToString(CultureInfo.InvariantCulture));
+				}
+			}
+		}
+
+		private static Dictionary<string, Result> Read(string file) {
+			Dictionary<string, Result> results = new Dictionary<string, Result>();
+			string[] lines = File.ReadAllLines(file);
+			for (int i = 1; i < lines.Length; i++) {
+				string[] fields = lines[i].Split(';');
+				if (fields.Length != 3)
+					continue;
+
+				Result result = new Result();
+				result.MeanNanoseconds = Double.Parse(fields[1], CultureInfo.InvariantCulture);
+				result.AllocatedBytes = Int64.Parse(fields[2], CultureInfo.InvariantCulture);
+				results[fields[0]] = result;
+			}
+			return results;
+		}
+	}
+}
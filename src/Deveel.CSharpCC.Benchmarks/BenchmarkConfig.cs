@@ -0,0 +1,121 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+
+using BenchmarkDotNet.Columns;
+using BenchmarkDotNet.Configs;
+using BenchmarkDotNet.Diagnosers;
+using BenchmarkDotNet.Exporters;
+using BenchmarkDotNet.Reports;
+using BenchmarkDotNet.Running;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// Measures the allocations of every benchmark and, for the grammar
+	/// benchmarks, the throughput and the allocations per token.
+	/// </summary>
+	public class BenchmarkConfig : ManualConfig {
+		public BenchmarkConfig() {
+			AddDiagnoser(MemoryDiagnoser.Default);
+			AddColumn(new PerTokenColumn(false), new PerTokenColumn(true));
+			AddExporter(MarkdownExporter.GitHub, CsvExporter.Default);
+		}
+	}
+
+	/// <summary>
+	/// A column dividing the results of a <see cref="GrammarBenchmark"/> by the
+	/// number of tokens of its input.
+	/// </summary>
+	public sealed class PerTokenColumn : IColumn {
+		private static readonly Dictionary<string, int> tokenCounts = new Dictionary<string, int>();
+
+		private readonly bool allocations;
+
+		public PerTokenColumn(bool allocations) {
+			this.allocations = allocations;
+		}
+
+		public string Id {
+			get { return "PerToken" + (allocations ? "Allocated" : "Throughput"); }
+		}
+
+		public string ColumnName {
+			get { return allocations ? "Allocated/token" : "Tokens/s"; }
+		}
+
+		public bool AlwaysShow {
+			get { return true; }
+		}
+
+		public ColumnCategory Category {
+			get { return ColumnCategory.Custom; }
+		}
+
+		public int PriorityInCategory {
+			get { return allocations ? 1 : 0; }
+		}
+
+		public bool IsNumeric {
+			get { return true; }
+		}
+
+		public UnitType UnitType {
+			get { return allocations ? UnitType.Size : UnitType.Dimensionless; }
+		}
+
+		public string Legend {
+			get {
+				return allocations
+					? "Bytes allocated per token of the input"
+					: "Tokens of the input read per second";
+			}
+		}
+
+		public bool IsAvailable(Summary summary) {
+			return true;
+		}
+
+		public bool IsDefault(Summary summary, BenchmarkCase benchmarkCase) {
+			return false;
+		}
+
+		public string GetValue(Summary summary, BenchmarkCase benchmarkCase) {
+			return GetValue(summary, benchmarkCase, SummaryStyle.Default);
+		}
+
+		public string GetValue(Summary summary, BenchmarkCase benchmarkCase, SummaryStyle style) {
+			BenchmarkReport report = summary[benchmarkCase];
+			int tokens = CountTokens(benchmarkCase);
+			if (report == null || report.ResultStatistics == null || tokens == 0)
+				return "-";
+
+			if (allocations) {
+				long? allocated = report.GcStats.GetBytesAllocatedPerOperation(benchmarkCase);
+				if (allocated == null)
+					return "-";
+				return ((double) allocated.Value / tokens).ToString("0.00", CultureInfo.InvariantCulture) + " B";
+			}
+
+			double seconds = report.ResultStatistics.Mean / 1e9;
+			return (tokens / seconds).ToString("N0", CultureInfo.InvariantCulture);
+		}
+
+		private static int CountTokens(BenchmarkCase benchmarkCase) {
+			Type type = benchmarkCase.Descriptor.Type;
+			if (!typeof(GrammarBenchmark).IsAssignableFrom(type))
+				return 0;
+
+			int size = (int) benchmarkCase.Parameters["SizeKB"];
+			string key = type.FullName + "/" + size;
+			lock (tokenCounts) {
+				int count;
+				if (!tokenCounts.TryGetValue(key, out count)) {
+					GrammarBenchmark benchmark = (GrammarBenchmark) Activator.CreateInstance(type);
+					count = benchmark.CountTokens(benchmark.CreateInput(size * 1024));
+					tokenCounts.Add(key, count);
+				}
+				return count;
+			}
+		}
+	}
+}
@@ -0,0 +1,147 @@
+﻿using System;
+using System.Globalization;
+using System.Text;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// Generates the synthetic inputs of the benchmarks: the same size always
+	/// gives the same text, so that runs can be compared with the baselines.
+	/// </summary>
+	public static class Corpus {
+		private const int Seed = 20140301;
+
+		private static readonly string[] Words = {
+			"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta", "iota", "kappa",
+			"lambda", "mu", "nu", "xi", "omicron", "pi", "rho", "sigma", "tau", "upsilon"
+		};
+
+		public static string Json(int size) {
+			Random random = new Random(Seed);
+			StringBuilder sb = new StringBuilder(size + 256);
+			sb.Append("[\n");
+			for (int i = 0; sb.Length < size; i++) {
+				if (i > 0)
+					sb.Append(",\n");
+				JsonRecord(sb, random, i, 2);
+			}
+			sb.Append("\n]\n");
+			return sb.ToString();
+		}
+
+		private static void JsonRecord(StringBuilder sb, Random random, int id, int depth) {
+			sb.Append("  {\"id\": ").Append(id);
+			sb.Append(", \"name\": \"").Append(Word(random)).Append(' ').Append(Word(random)).Append("\\n\"");
+			sb.Append(", \"score\": ").Append((random.NextDouble() * 1000).ToString("0.###", CultureInfo.InvariantCulture));
+			sb.Append(", \"ratio\": -").Append(random.Next(1, 9)).Append(".5e-").Append(random.Next(1, 9));
+			sb.Append(", \"active\": ").Append(random.Next(2) == 0 ? "true" : "false");
+			sb.Append(", \"parent\": null");
+			sb.Append(", \"tags\": [");
+			for (int i = random.Next(4); i > 0; i--) {
+				sb.Append('"').Append(Word(random)).Append('"');
+				if (i > 1)
+					sb.Append(", ");
+			}
+			sb.Append(']');
+			if (depth > 0) {
+				sb.Append(", \"children\": [");
+				for (int i = random.Next(3); i > 0; i--) {
+					JsonRecord(sb, random, id * 10 + i, depth - 1);
+					if (i > 1)
+						sb.Append(", ");
+				}
+				sb.Append(']');
+			}
+			sb.Append('}');
+		}
+
+		public static string Sql(int size) {
+			Random random = new Random(Seed);
+			StringBuilder sb = new StringBuilder(size + 512);
+			for (int i = 0; sb.Length < size; i++) {
+				switch (i % 5) {
+					case 0:
+						sb.Append("-- report ").Append(i).Append('\n');
+						sb.Append("SELECT DISTINCT c.id, c.name AS customer_name, SUM(o.total * (1 - o.discount)) total,\n");
+						sb.Append("       CASE WHEN c.credit > ").Append(random.Next(1000)).Append(" THEN 'gold' ELSE 'standard' END AS level\n");
+						sb.Append("FROM customers c INNER JOIN orders o ON o.customer_id = c.id\n");
+						sb.Append("     LEFT OUTER JOIN regions r ON r.id = c.region_id\n");
+						sb.Append("WHERE o.created BETWEEN '2014-01-01' AND '2014-12-31' AND c.name LIKE '")
+							.Append(Word(random)).Append("%' AND NOT c.deleted IS NULL\n");
+						sb.Append("GROUP BY c.id, c.name, c.credit HAVING COUNT(*) > ").Append(random.Next(10)).Append('\n');
+						sb.Append("ORDER BY total DESC, c.name ASC;\n");
+						break;
+					case 1:
+						sb.Append("INSERT INTO orders (id, customer_id, total, discount) VALUES ");
+						for (int j = 0; j < 8; j++) {
+							if (j > 0)
+								sb.Append(", ");
+							sb.Append('(').Append(i * 8 + j).Append(", ").Append(random.Next(500)).Append(", ")
+								.Append((random.NextDouble() * 500).ToString("0.00", CultureInfo.InvariantCulture))
+								.Append(", .").Append(random.Next(10)).Append(')');
+						}
+						sb.Append(";\n");
+						break;
+					case 2:
+						sb.Append("UPDATE customers SET credit = credit + ").Append(random.Next(100))
+							.Append(", name = 'O''").Append(Word(random)).Append("' WHERE id IN (SELECT customer_id FROM orders WHERE total >= ")
+							.Append(random.Next(1000)).Append(");\n");
+						break;
+					case 3:
+						sb.Append("/* cleanup of ").Append(Word(random)).Append(" */\n");
+						sb.Append("DELETE FROM orders WHERE discount <> 0 AND (total / 2 < 10 OR customer_id NOT IN (1, 2, 3));\n");
+						break;
+					default:
+						sb.Append("CREATE TABLE t").Append(i).Append(" (id INTEGER PRIMARY KEY NOT NULL, name VARCHAR(")
+							.Append(random.Next(10, 200)).Append(") DEFAULT 'x', amount DECIMAL(10, 2) NULL);\n");
+						break;
+				}
+			}
+			return sb.ToString();
+		}
+
+		public static string Expression(int size) {
+			Random random = new Random(Seed);
+			StringBuilder sb = new StringBuilder(size + 512);
+			for (int i = 0; sb.Length < size; i++) {
+				sb.Append("// function ").Append(i).Append('\n');
+				sb.Append("fun f").Append(i).Append("(a, b, c) {\n");
+				sb.Append("  let x = (a + b * ").Append(random.Next(100)).Append(") << 2 ^ (c % 7) & 0xFF | ~b;\n");
+				sb.Append("  let y = a >= b && b != c || !(a < ").Append(random.Next(100)).Append(") ? x * 1.5e2 : -x / 3;\n");
+				sb.Append("  for (x = 0; x <= 10; x += 1) y = y + g(x, y - 1, [x, y, \"").Append(Word(random)).Append("\"])[0].value;\n");
+				sb.Append("  while (y > 0) { y -= a * (b + c) - (a - b) * c; if (y == 1) return nil; else y = y >> 1; }\n");
+				sb.Append("  /* closure */ let h = fun (z) { return z * x + y; };\n");
+				sb.Append("  return h(x) + h(y) * (x + y * (x - y * (x + 1)));\n");
+				sb.Append("}\n");
+			}
+			return sb.ToString();
+		}
+
+		/// <summary>
+		/// A grammar for CSharpCC itself, made of simple token definitions and
+		/// productions that call each other.
+		/// </summary>
+		public static string Grammar(int size) {
+			Random random = new Random(Seed);
+			StringBuilder sb = new StringBuilder(size + 512);
+			sb.Append("options {\n  STATIC = false;\n}\n\n");
+			sb.Append("PARSER_BEGIN(Generated)\nnamespace Generated;\n\nusing System;\n\npublic class Generated {\n}\n\nPARSER_END(Generated)\n\n");
+			sb.Append("SKIP: {\n\" \" |\n\"\\t\" |\n\"\\n\" |\n\"\\r\"\n}\n\n");
+			sb.Append("TOKEN: {\n< ID: [\"a\"-\"z\"] ( [\"a\"-\"z\",\"0\"-\"9\"] )* > |\n< NUM: ( [\"0\"-\"9\"] )+ >\n}\n\n");
+			for (int i = 0; sb.Length < size; i++) {
+				sb.Append("TOKEN: {\n< KW").Append(i).Append(": \"").Append(Word(random)).Append(i).Append("\" >\n}\n\n");
+				sb.Append("// Rule ").Append(i).Append('\n');
+				sb.Append("int Rule").Append(i).Append("() :\n{ Token t; int count = 0; }\n{\n");
+				sb.Append("( t = <ID> { count += t.Image.Length; } | <NUM> { count++; }");
+				if (i > 0)
+					sb.Append(" | \"(\" count = Rule").Append(random.Next(i)).Append("() \")\"");
+				sb.Append(" )* [ <KW").Append(i).Append("> ]\n");
+				sb.Append("{ return count; }\n}\n\n");
+			}
+			return sb.ToString();
+		}
+
+		private static string Word(Random random) {
+			return Words[random.Next(Words.Length)];
+		}
+	}
+}
@@ -0,0 +1,45 @@
+﻿using System;
+using System.IO;
+
+using BenchmarkDotNet.Attributes;
+using BenchmarkDotNet.Engines;
+
+using Deveel.CSharpCC.Benchmarks.Expression;
+using Deveel.CSharpCC.Benchmarks.Json;
+using Deveel.CSharpCC.Benchmarks.Sql;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// The time of the first parse in a new process, that includes loading and
+	/// compiling the generated code and initializing its tables.
+	/// </summary>
+	[Config(typeof(BenchmarkConfig))]
+	[SimpleJob(RunStrategy.ColdStart, launchCount: 20, warmupCount: 0, iterationCount: 1)]
+	public class FirstParseBenchmark {
+		private string json;
+		private string sql;
+		private string expression;
+
+		[GlobalSetup]
+		public void Setup() {
+			json = Corpus.Json(1024);
+			sql = Corpus.Sql(1024);
+			expression = Corpus.Expression(1024);
+		}
+
+		[Benchmark]
+		public int Json() {
+			return new JsonParser(new StringReader(json)).Document();
+		}
+
+		[Benchmark]
+		public int Sql() {
+			return new SqlParser(new StringReader(sql)).Script();
+		}
+
+		[Benchmark]
+		public int Expression() {
+			return new ExpressionParser(new StringReader(expression)).Program();
+		}
+	}
+}
@@ -0,0 +1,44 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+using Deveel.CSharpCC.Parser;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// Runs the whole generation in-process, through the entry point of the
+	/// csharpcc program.
+	/// </summary>
+	public static class Generator {
+		/// <summary>
+		/// Writes the given grammar text to <c>Synthetic.cc</c> in the output directory
+		/// and generates its parser there, with the console output of the generator
+		/// discarded.
+		/// </summary>
+		/// <returns>
+		/// Returns the figures of the phases of the generation.
+		/// </returns>
+		public static IList<GenerationStats.PhaseStats> Run(string grammar, string outputDirectory) {
+			string grammarFile = Path.Combine(outputDirectory, "Synthetic.cc");
+			File.WriteAllText(grammarFile, grammar);
+
+			TextWriter stdout = Console.Out;
+			TextWriter stderr = Console.Error;
+			Console.SetOut(TextWriter.Null);
+			Console.SetError(TextWriter.Null);
+
+			int code;
+			try {
+				code = Program.MainProgram(new string[] { "-OUTPUT_DIRECTORY=" + outputDirectory, grammarFile });
+			} finally {
+				Console.SetOut(stdout);
+				Console.SetError(stderr);
+			}
+
+			if (code != 0)
+				throw new InvalidOperationException("The generation of the grammar failed with the exit code " + code + ".");
+
+			return GenerationStats.Phases;
+		}
+	}
+}
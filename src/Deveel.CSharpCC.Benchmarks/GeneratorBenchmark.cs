@@ -0,0 +1,45 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+using BenchmarkDotNet.Attributes;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// The time and the allocations of the whole generation of the synthetic
+	/// grammars, so that the baselines catch the parts of the generator that
+	/// become super-linear again.
+	/// </summary>
+	[Config(typeof(BenchmarkConfig))]
+	public class GeneratorBenchmark {
+		private string grammar;
+		private string outputDirectory;
+
+		[ParamsSource("Families")]
+		public string Family { get; set; }
+
+		[Params(100, 400)]
+		public int Size { get; set; }
+
+		public IEnumerable<string> Families {
+			get { return GrammarFamilies.All; }
+		}
+
+		[GlobalSetup]
+		public void Setup() {
+			grammar = GrammarFamilies.Create(Family, Size);
+			outputDirectory = Path.Combine(Path.GetTempPath(), "csharpcc-bench-" + Guid.NewGuid().ToString("N"));
+			Directory.CreateDirectory(outputDirectory);
+		}
+
+		[GlobalCleanup]
+		public void Cleanup() {
+			Directory.Delete(outputDirectory, true);
+		}
+
+		[Benchmark]
+		public int Generate() {
+			return Generator.Run(grammar, outputDirectory).Count;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+﻿using System;
+
+using BenchmarkDotNet.Attributes;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// The lexing and parsing throughput of a generated parser on inputs of
+	/// several sizes.
+	/// </summary>
+	[Config(typeof(BenchmarkConfig))]
+	public abstract class GrammarBenchmark {
+		private string input;
+
+		/// <summary>
+		/// The size of the input, in kilobytes.
+		/// </summary>
+		[Params(16, 256, 4096)]
+		public int SizeKB { get; set; }
+
+		[GlobalSetup]
+		public void Setup() {
+			input = CreateInput(SizeKB * 1024);
+		}
+
+		/// <summary>
+		/// Reads all the tokens of the input.
+		/// </summary>
+		[Benchmark]
+		public int Lex() {
+			return CountTokens(input);
+		}
+
+		/// <summary>
+		/// Parses the whole input.
+		/// </summary>
+		[Benchmark]
+		public int Parse() {
+			return Parse(input);
+		}
+
+		/// <summary>
+		/// Generates an input of about the given number of characters.
+		/// </summary>
+		public abstract string CreateInput(int size);
+
+		/// <summary>
+		/// Reads all the tokens of the text and returns how many they are, not
+		/// counting the end of file.
+		/// </summary>
+		public abstract int CountTokens(string text);
+
+		protected abstract int Parse(string text);
+	}
+}
@@ -0,0 +1,166 @@
+﻿using System;
+using System.Text;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// Synthesizes grammars of growing size, each stressing one part of the generator.
+	/// </summary>
+	public static class GrammarFamilies {
+		/// <summary>
+		/// N keywords with IGNORE_CASE, sharing prefixes: the string literal DFA
+		/// of <c>RStringLiteral</c>.
+		/// </summary>
+		public const string Keywords = "Keywords";
+
+		/// <summary>
+		/// N regular expression tokens built from shared private expressions: the
+		/// NFA of <c>NfaState</c>.
+		/// </summary>
+		public const string Tokens = "Tokens";
+
+		/// <summary>
+		/// N productions whose choices need a lookahead of k tokens:
+		/// <c>LookaheadCalc</c> and the phase-3 routines of <c>ParseEngine</c>.
+		/// </summary>
+		public const string Lookahead = "Lookahead";
+
+		/// <summary>
+		/// N lexical states, each with its own tokens.
+		/// </summary>
+		public const string LexicalStates = "LexicalStates";
+
+		public static readonly string[] All = { Keywords, Tokens, Lookahead, LexicalStates };
+
+		/// <summary>
+		/// The depth of the lookahead of the <see cref="Lookahead"/> family.
+		/// </summary>
+		public const int LookaheadDepth = 4;
+
+		private static readonly string[] Prefixes = { "select", "sel", "set", "sequence", "serial", "server", "session", "service" };
+
+		public static string Create(string family, int size) {
+			switch (family) {
+				case Keywords:
+					return CreateKeywords(size);
+				case Tokens:
+					return CreateTokens(size);
+				case Lookahead:
+					return CreateLookahead(size, LookaheadDepth);
+				case LexicalStates:
+					return CreateLexicalStates(size);
+				default:
+					throw new ArgumentException("Unknown grammar family " + family, "family");
+			}
+		}
+
+		private static StringBuilder Header(string options) {
+			StringBuilder sb = new StringBuilder();
+			sb.Append("options {\n  STATIC = false;\n").Append(options).Append("}\n\n");
+			sb.Append("PARSER_BEGIN(Synthetic)\nnamespace Synthetic;\n\nusing System;\n\npublic class Synthetic {\n}\n\nPARSER_END(Synthetic)\n\n");
+			sb.Append("<*> SKIP: {\n\" \" |\n\"\\t\" |\n\"\\n\" |\n\"\\r\"\n}\n\n");
+			return sb;
+		}
+
+		private static string CreateKeywords(int size) {
+			StringBuilder sb = Header("  IGNORE_CASE = true;\n");
+			sb.Append("TOKEN: {\n");
+			for (int i = 0; i < size; i++)
+				sb.Append("< K").Append(i).Append(": \"").Append(Prefixes[i % Prefixes.Length]).Append(i).Append("\" > |\n");
+			sb.Append("< IDENTIFIER: [\"a\"-\"z\"] ( [\"a\"-\"z\",\"0\"-\"9\"] )* >\n}\n\n");
+
+			sb.Append("void Start() :\n{}\n{\n( <IDENTIFIER>");
+			for (int i = 0; i < size; i++)
+				sb.Append(" | <K").Append(i).Append('>');
+			sb.Append(" )* <EOF>\n}\n");
+			return sb.ToString();
+		}
+
+		private static string CreateTokens(int size) {
+			StringBuilder sb = Header("");
+			sb.Append("TOKEN: {\n");
+			sb.Append("< #DIGITS: ( [\"0\"-\"9\"] )+ > |\n");
+			sb.Append("< #LETTERS: ( [\"a\"-\"z\",\"A\"-\"Z\"] )+ > |\n");
+			sb.Append("< #SUFFIX: ( \".\" <DIGITS> | \"_\" <LETTERS> ( <DIGITS> )? )* >\n}\n\n");
+			sb.Append("TOKEN: {\n");
+			for (int i = 0; i < size; i++) {
+				if (i > 0)
+					sb.Append(" |\n");
+				sb.Append("< T").Append(i).Append(": \"#").Append(i).Append(":\" ( <LETTERS> | <DIGITS> \"e\" ( [\"+\",\"-\"] )? <DIGITS> ) <SUFFIX> >");
+			}
+			sb.Append("\n}\n\n");
+
+			sb.Append("void Start() :\n{}\n{\n(");
+			for (int i = 0; i < size; i++) {
+				if (i > 0)
+					sb.Append(" |");
+				sb.Append(" <T").Append(i).Append('>');
+			}
+			sb.Append(" )* <EOF>\n}\n");
+			return sb.ToString();
+		}
+
+		private static string CreateLookahead(int size, int depth) {
+			StringBuilder sb = Header("  FORCE_LA_CHECK = true;\n  CHOICE_AMBIGUITY_CHECK = " + depth + ";\n");
+			sb.Append("TOKEN: {\n< A: \"a\" > |\n< B: \"b\" > |\n< C: \"c\" >\n}\n\n");
+			sb.Append("TOKEN: {\n");
+			for (int i = 0; i < size; i++) {
+				if (i > 0)
+					sb.Append(" |\n");
+				sb.Append("< P").Append(i).Append(": \"p").Append(i).Append("\" >");
+			}
+			sb.Append("\n}\n\n");
+
+			sb.Append("void Start() :\n{}\n{\n(");
+			for (int i = 0; i < size; i++) {
+				if (i > 0)
+					sb.Append(" |");
+				sb.Append(" Rule").Append(i).Append("()");
+			}
+			sb.Append(" )* <EOF>\n}\n\n");
+
+			sb.Append("void Prefix() :\n{}\n{\n");
+			for (int i = 0; i < depth - 1; i++)
+				sb.Append("\"a\" ");
+			sb.Append("}\n\n");
+
+			// Both alternatives start with the same depth - 1 tokens, and can be
+			// preceded by a call to a previous rule.
+			for (int i = 0; i < size; i++) {
+				sb.Append("void Rule").Append(i).Append("() :\n{}\n{\n");
+				sb.Append("<P").Append(i).Append("> ( LOOKAHEAD(").Append(depth).Append(") Prefix() \"b\"");
+				if (i > 0)
+					sb.Append(" [ Rule").Append(i - 1).Append("() ]");
+				sb.Append(" | Prefix() \"c\" )\n}\n\n");
+			}
+			return sb.ToString();
+		}
+
+		private static string CreateLexicalStates(int size) {
+			StringBuilder sb = Header("");
+			sb.Append("TOKEN: {\n");
+			for (int i = 0; i < size; i++) {
+				if (i > 0)
+					sb.Append(" |\n");
+				sb.Append("< ENTER").Append(i).Append(": \"<").Append(i).Append(">\" > : S").Append(i);
+			}
+			sb.Append("\n}\n\n");
+
+			for (int i = 0; i < size; i++) {
+				sb.Append("<S").Append(i).Append("> TOKEN: {\n");
+				sb.Append("< WORD").Append(i).Append(": ( [\"a\"-\"z\"] )+ \"").Append(i).Append("\" > |\n");
+				sb.Append("< NUMBER").Append(i).Append(": ( [\"0\"-\"9\"] )+ ( \".\" ( [\"0\"-\"9\"] )+ )? > |\n");
+				sb.Append("< LEAVE").Append(i).Append(": \"</").Append(i).Append(">\" > : DEFAULT\n}\n\n");
+			}
+
+			sb.Append("void Start() :\n{}\n{\n(");
+			for (int i = 0; i < size; i++) {
+				if (i > 0)
+					sb.Append(" |");
+				sb.Append("\n  <ENTER").Append(i).Append("> ( <WORD").Append(i).Append("> | <NUMBER").Append(i)
+					.Append("> )* <LEAVE").Append(i).Append('>');
+			}
+			sb.Append("\n)* <EOF>\n}\n");
+			return sb.ToString();
+		}
+	}
+}
@@ -0,0 +1,168 @@
+options {
+	STATIC = false;
+}
+
+PARSER_BEGIN(ExpressionParser)
+namespace Deveel.CSharpCC.Benchmarks.Expression;
+
+using System;
+
+public class ExpressionParser {
+}
+
+PARSER_END(ExpressionParser)
+
+SKIP: {
+" " |
+"\t" |
+"\n" |
+"\r" |
+< "//" ( ~["\n","\r"] )* > |
+< "/*" ( ~["*"] )* "*" ( "*" | ~["*","/"] ( ~["*"] )* "*" )* "/" >
+}
+
+TOKEN: {
+< LET: "let" > |
+< FUN: "fun" > |
+< IF: "if" > |
+< ELSE: "else" > |
+< WHILE: "while" > |
+< FOR: "for" > |
+< RETURN: "return" > |
+< TRUE: "true" > |
+< FALSE: "false" > |
+< NIL: "nil" >
+}
+
+TOKEN: {
+< NUMBER: ( ["0"-"9"] )+ ( "." ( ["0"-"9"] )+ )? ( ["e","E"] ( ["+","-"] )? ( ["0"-"9"] )+ )? > |
+< HEX_NUMBER: "0" ["x","X"] ( ["0"-"9","a"-"f","A"-"F"] )+ > |
+< STRING: "\"" ( ~["\"","\\","\n","\r"] | "\\" ["n","t","r","\"","\\"] )* "\"" > |
+< IDENTIFIER: ["a"-"z","A"-"Z","_"] ( ["a"-"z","A"-"Z","0"-"9","_"] )* >
+}
+
+// Returns the number of statements in the program.
+int Program() :
+{ int count = 0; }
+{
+( Statement() { count++; } )* <EOF>
+{ return count; }
+}
+
+void Statement() :
+{}
+{
+"let" <IDENTIFIER> "=" Expression() ";"
+| LOOKAHEAD(2) "fun" <IDENTIFIER> "(" [ <IDENTIFIER> ( "," <IDENTIFIER> )* ] ")" Block()
+| "if" "(" Expression() ")" Statement() [ LOOKAHEAD(1) "else" Statement() ]
+| "while" "(" Expression() ")" Statement()
+| "for" "(" [ Expression() ] ";" [ Expression() ] ";" [ Expression() ] ")" Statement()
+| "return" [ Expression() ] ";"
+| Block()
+| Expression() ";"
+}
+
+void Block() :
+{}
+{
+"{" ( Statement() )* "}"
+}
+
+void Expression() :
+{}
+{
+Conditional() [ ( "=" | "+=" | "-=" | "*=" | "/=" ) Expression() ]
+}
+
+void Conditional() :
+{}
+{
+LogicalOr() [ "?" Expression() ":" Conditional() ]
+}
+
+void LogicalOr() :
+{}
+{
+LogicalAnd() ( "||" LogicalAnd() )*
+}
+
+void LogicalAnd() :
+{}
+{
+BitwiseOr() ( "&&" BitwiseOr() )*
+}
+
+void BitwiseOr() :
+{}
+{
+BitwiseXor() ( "|" BitwiseXor() )*
+}
+
+void BitwiseXor() :
+{}
+{
+BitwiseAnd() ( "^" BitwiseAnd() )*
+}
+
+void BitwiseAnd() :
+{}
+{
+Equality() ( "&" Equality() )*
+}
+
+void Equality() :
+{}
+{
+Relational() ( ( "==" | "!=" ) Relational() )*
+}
+
+void Relational() :
+{}
+{
+Shift() ( ( "<" | "<=" | ">" | ">=" ) Shift() )*
+}
+
+void Shift() :
+{}
+{
+Additive() ( ( "<<" | ">>" ) Additive() )*
+}
+
+void Additive() :
+{}
+{
+Multiplicative() ( ( "+" | "-" ) Multiplicative() )*
+}
+
+void Multiplicative() :
+{}
+{
+Unary() ( ( "*" | "/" | "%" ) Unary() )*
+}
+
+void Unary() :
+{}
+{
+( "-" | "!" | "~" ) Unary() | Postfix()
+}
+
+void Postfix() :
+{}
+{
+Primary() ( "(" [ Expression() ( "," Expression() )* ] ")" | "[" Expression() "]" | "." <IDENTIFIER> )*
+}
+
+void Primary() :
+{}
+{
+<NUMBER>
+| <HEX_NUMBER>
+| <STRING>
+| "true"
+| "false"
+| "nil"
+| <IDENTIFIER>
+| "(" Expression() ")"
+| "[" [ Expression() ( "," Expression() )* ] "]"
+| "fun" "(" [ <IDENTIFIER> ( "," <IDENTIFIER> )* ] ")" Block()
+}
@@ -0,0 +1,67 @@
+options {
+	STATIC = false;
+}
+
+PARSER_BEGIN(JsonParser)
+namespace Deveel.CSharpCC.Benchmarks.Json;
+
+using System;
+
+public class JsonParser {
+}
+
+PARSER_END(JsonParser)
+
+SKIP: {
+" " |
+"\t" |
+"\n" |
+"\r"
+}
+
+TOKEN: {
+< LBRACE: "{" > |
+< RBRACE: "}" > |
+< LBRACKET: "[" > |
+< RBRACKET: "]" > |
+< COMMA: "," > |
+< COLON: ":" > |
+< TRUE: "true" > |
+< FALSE: "false" > |
+< NULL: "null" >
+}
+
+TOKEN: {
+< NUMBER: ( "-" )? ( "0" | ["1"-"9"] ( ["0"-"9"] )* ) ( "." ( ["0"-"9"] )+ )? ( ["e","E"] ( ["+","-"] )? ( ["0"-"9"] )+ )? > |
+< STRING: "\"" ( ~["\"","\\","\n","\r"] | "\\" ( ["\"","\\","/","b","f","n","r","t"] | "u" <HEX> <HEX> <HEX> <HEX> ) )* "\"" > |
+< #HEX: ["0"-"9","a"-"f","A"-"F"] >
+}
+
+// Returns the number of values in the document.
+int Document() :
+{ int count; }
+{
+count = Value() <EOF>
+{ return count; }
+}
+
+int Value() :
+{ int count = 1; }
+{
+( count = JsonObject() | count = JsonArray() | <STRING> | <NUMBER> | <TRUE> | <FALSE> | <NULL> )
+{ return count; }
+}
+
+int JsonObject() :
+{ int count = 1; int member; }
+{
+"{" [ <STRING> ":" member = Value() { count += member; } ( "," <STRING> ":" member = Value() { count += member; } )* ] "}"
+{ return count; }
+}
+
+int JsonArray() :
+{ int count = 1; int element; }
+{
+"[" [ element = Value() { count += element; } ( "," element = Value() { count += element; } )* ] "]"
+{ return count; }
+}
@@ -0,0 +1,273 @@
+options {
+	STATIC = false;
+	IGNORE_CASE = true;
+}
+
+PARSER_BEGIN(SqlParser)
+namespace Deveel.CSharpCC.Benchmarks.Sql;
+
+using System;
+
+public class SqlParser {
+}
+
+PARSER_END(SqlParser)
+
+SKIP: {
+" " |
+"\t" |
+"\n" |
+"\r" |
+< "--" ( ~["\n","\r"] )* >
+}
+
+MORE: {
+"/*" : IN_COMMENT
+}
+
+<IN_COMMENT>
+SKIP: {
+"*/" : DEFAULT
+}
+
+<IN_COMMENT>
+MORE: {
+< ~[] >
+}
+
+TOKEN: {
+< SELECT: "select" > |
+< DISTINCT: "distinct" > |
+< FROM: "from" > |
+< WHERE: "where" > |
+< GROUP: "group" > |
+< BY: "by" > |
+< HAVING: "having" > |
+< ORDER: "order" > |
+< ASC: "asc" > |
+< DESC: "desc" > |
+< AS: "as" > |
+< JOIN: "join" > |
+< INNER: "inner" > |
+< LEFT: "left" > |
+< OUTER: "outer" > |
+< ON: "on" > |
+< AND: "and" > |
+< OR: "or" > |
+< NOT: "not" > |
+< IN: "in" > |
+< LIKE: "like" > |
+< BETWEEN: "between" > |
+< IS: "is" > |
+< NULL: "null" > |
+< CASE: "case" > |
+< WHEN: "when" > |
+< THEN: "then" > |
+< ELSE: "else" > |
+< END: "end" > |
+< INSERT: "insert" > |
+< INTO: "into" > |
+< VALUES: "values" > |
+< UPDATE: "update" > |
+< SET: "set" > |
+< DELETE: "delete" > |
+< CREATE: "create" > |
+< TABLE: "table" > |
+< PRIMARY: "primary" > |
+< KEY: "key" > |
+< DEFAULT_VALUE: "default" >
+}
+
+TOKEN: {
+< INTEGER: ( ["0"-"9"] )+ > |
+< DECIMAL: ( ["0"-"9"] )+ "." ( ["0"-"9"] )* | "." ( ["0"-"9"] )+ > |
+< STRING: "'" ( ~["'"] | "''" )* "'" > |
+< IDENTIFIER: ["a"-"z","_"] ( ["a"-"z","0"-"9","_"] )* > |
+< QUOTED_IDENTIFIER: "\"" ( ~["\"","\n","\r"] )+ "\"" >
+}
+
+TOKEN: {
+< EQ: "=" > |
+< NE: "<>" > |
+< BANG_NE: "!=" > |
+< LT: "<" > |
+< LE: "<=" > |
+< GT: ">" > |
+< GE: ">=" > |
+< CONCAT: "||" >
+}
+
+// Returns the number of statements in the script.
+int Script() :
+{ int count = 0; }
+{
+[ Statement() { count++; } ] ( ";" [ Statement() { count++; } ] )* <EOF>
+{ return count; }
+}
+
+void Statement() :
+{}
+{
+Select() | Insert() | Update() | Delete() | CreateTable()
+}
+
+void Select() :
+{}
+{
+"SELECT" [ "DISTINCT" ] SelectList()
+"FROM" TableReference() ( "," TableReference() | Join() )*
+[ "WHERE" Expression() ]
+[ "GROUP" "BY" ExpressionList() [ "HAVING" Expression() ] ]
+[ "ORDER" "BY" OrderItem() ( "," OrderItem() )* ]
+}
+
+void SelectList() :
+{}
+{
+"*" | SelectItem() ( "," SelectItem() )*
+}
+
+void SelectItem() :
+{}
+{
+Expression() [ [ "AS" ] Identifier() ]
+}
+
+void TableReference() :
+{}
+{
+( Name() | "(" Select() ")" ) [ [ "AS" ] Identifier() ]
+}
+
+void Join() :
+{}
+{
+[ "INNER" | "LEFT" [ "OUTER" ] ] "JOIN" TableReference() "ON" Expression()
+}
+
+void OrderItem() :
+{}
+{
+Expression() [ "ASC" | "DESC" ]
+}
+
+void Insert() :
+{}
+{
+"INSERT" "INTO" Name() [ "(" Identifier() ( "," Identifier() )* ")" ]
+( "VALUES" "(" ExpressionList() ")" ( "," "(" ExpressionList() ")" )* | Select() )
+}
+
+void Update() :
+{}
+{
+"UPDATE" Name() "SET" Assignment() ( "," Assignment() )* [ "WHERE" Expression() ]
+}
+
+void Assignment() :
+{}
+{
+Identifier() "=" Expression()
+}
+
+void Delete() :
+{}
+{
+"DELETE" "FROM" Name() [ "WHERE" Expression() ]
+}
+
+void CreateTable() :
+{}
+{
+"CREATE" "TABLE" Name() "(" ColumnDefinition() ( "," ColumnDefinition() )* ")"
+}
+
+void ColumnDefinition() :
+{}
+{
+Identifier() Identifier() [ "(" <INTEGER> [ "," <INTEGER> ] ")" ]
+( "NOT" "NULL" | "NULL" | "PRIMARY" "KEY" | "DEFAULT" Primary() )*
+}
+
+void ExpressionList() :
+{}
+{
+Expression() ( "," Expression() )*
+}
+
+void Expression() :
+{}
+{
+AndExpression() ( "OR" AndExpression() )*
+}
+
+void AndExpression() :
+{}
+{
+NotExpression() ( "AND" NotExpression() )*
+}
+
+void NotExpression() :
+{}
+{
+"NOT" NotExpression() | Comparison()
+}
+
+void Comparison() :
+{}
+{
+Additive()
+[
+  ( "=" | "<>" | "!=" | "<" | "<=" | ">" | ">=" ) Additive()
+| "IS" [ "NOT" ] "NULL"
+| [ "NOT" ] ( "IN" "(" ( Select() | ExpressionList() ) ")" | "LIKE" Additive() | "BETWEEN" Additive() "AND" Additive() )
+]
+}
+
+void Additive() :
+{}
+{
+Multiplicative() ( ( "+" | "-" | "||" ) Multiplicative() )*
+}
+
+void Multiplicative() :
+{}
+{
+Unary() ( ( "*" | "/" | "%" ) Unary() )*
+}
+
+void Unary() :
+{}
+{
+"-" Unary() | Primary()
+}
+
+void Primary() :
+{}
+{
+<INTEGER>
+| <DECIMAL>
+| <STRING>
+| "NULL"
+| "(" ( Select() | Expression() ) ")"
+| Case()
+| Name() [ "(" [ "*" | [ "DISTINCT" ] ExpressionList() ] ")" ]
+}
+
+void Case() :
+{}
+{
+"CASE" [ Expression() ] ( "WHEN" Expression() "THEN" Expression() )+ [ "ELSE" Expression() ] "END"
+}
+
+void Name() :
+{}
+{
+Identifier() ( "." Identifier() )*
+}
+
+void Identifier() :
+{}
+{
+<IDENTIFIER> | <QUOTED_IDENTIFIER>
+}
@@ -0,0 +1,100 @@
+﻿using System;
+using System.IO;
+
+using Deveel.CSharpCC.Benchmarks.Expression;
+using Deveel.CSharpCC.Benchmarks.Json;
+using Deveel.CSharpCC.Benchmarks.Sql;
+using Deveel.CSharpCC.Parser;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	public class JsonBenchmark : GrammarBenchmark {
+		public override string CreateInput(int size) {
+			return Corpus.Json(size);
+		}
+
+		public override int CountTokens(string text) {
+			JsonParser parser = new JsonParser(new StringReader(text));
+			int count = 0;
+			while (parser.GetNextToken().Kind != JsonParserConstants.EOF)
+				count++;
+			return count;
+		}
+
+		protected override int Parse(string text) {
+			return new JsonParser(new StringReader(text)).Document();
+		}
+	}
+
+	public class SqlBenchmark : GrammarBenchmark {
+		public override string CreateInput(int size) {
+			return Corpus.Sql(size);
+		}
+
+		public override int CountTokens(string text) {
+			SqlParser parser = new SqlParser(new StringReader(text));
+			int count = 0;
+			while (parser.GetNextToken().Kind != SqlParserConstants.EOF)
+				count++;
+			return count;
+		}
+
+		protected override int Parse(string text) {
+			return new SqlParser(new StringReader(text)).Script();
+		}
+	}
+
+	public class ExpressionBenchmark : GrammarBenchmark {
+		public override string CreateInput(int size) {
+			return Corpus.Expression(size);
+		}
+
+		public override int CountTokens(string text) {
+			ExpressionParser parser = new ExpressionParser(new StringReader(text));
+			int count = 0;
+			while (parser.GetNextToken().Kind != ExpressionParserConstants.EOF)
+				count++;
+			return count;
+		}
+
+		protected override int Parse(string text) {
+			return new ExpressionParser(new StringReader(text)).Program();
+		}
+	}
+
+	/// <summary>
+	/// The parser of CSharpCC itself, generated from <c>CSharpCC.cc</c> when the
+	/// library is built, reading grammars.
+	/// </summary>
+	/// <remarks>
+	/// The parser records what it reads in the static state of the generator,
+	/// that is cleared before every run.
+	/// </remarks>
+	public class CSharpCCGrammarBenchmark : GrammarBenchmark {
+		public override string CreateInput(int size) {
+			return Corpus.Grammar(size);
+		}
+
+		public override int CountTokens(string text) {
+			ReInit();
+			CSharpCCParser parser = new CSharpCCParser(new StringReader(text));
+			int count = 0;
+			while (parser.GetNextToken().kind != CSharpCCParserConstants.EOF)
+				count++;
+			return count;
+		}
+
+		protected override int Parse(string text) {
+			ReInit();
+			new CSharpCCParser(new StringReader(text)).csharpcc_input();
+			return CSharpCCGlobals.bnfproductions.Count;
+		}
+
+		private static void ReInit() {
+			Expansion.reInit();
+			CSharpCCErrors.ReInit();
+			CSharpCCGlobals.ReInit();
+			Options.init();
+			CSharpCCParserInternals.reInit();
+		}
+	}
+}
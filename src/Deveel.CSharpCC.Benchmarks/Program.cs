@@ -0,0 +1,59 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+using BenchmarkDotNet.Reports;
+using BenchmarkDotNet.Running;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	internal class Program {
+		// Usage: Deveel.CSharpCC.Benchmarks [--update-baselines] [--baselines <dir>] [BenchmarkDotNet arguments]
+		//        Deveel.CSharpCC.Benchmarks --scalability [--sizes 50,100,200,400] [--output <file.csv>]
+		private static int Main(string[] args) {
+			bool update = false;
+			bool scalability = false;
+			string baselines = null;
+			string sizes = "50,100,200,400";
+			string output = "scalability.csv";
+			List<string> rest = new List<string>();
+			for (int i = 0; i < args.Length; i++) {
+				if (args[i] == "--update-baselines") {
+					update = true;
+				} else if (args[i] == "--baselines" && i + 1 < args.Length) {
+					baselines = args[++i];
+				} else if (args[i] == "--scalability") {
+					scalability = true;
+				} else if (args[i] == "--sizes" && i + 1 < args.Length) {
+					sizes = args[++i];
+				} else if (args[i] == "--output" && i + 1 < args.Length) {
+					output = args[++i];
+				} else {
+					rest.Add(args[i]);
+				}
+			}
+
+			if (scalability) {
+				ScalabilityReport.Run(Array.ConvertAll(sizes.Split(','), Int32.Parse), Console.Out, output);
+				return 0;
+			}
+
+			if (baselines == null)
+				baselines = FindBaselines();
+
+			IEnumerable<Summary> summaries = BenchmarkSwitcher.FromAssembly(typeof(Program).Assembly).Run(rest.ToArray());
+			return Baselines.Check(summaries, baselines, update, Console.Out) ? 0 : 1;
+		}
+
+		// The Baselines directory next to the project, looked up from the output directory.
+		private static string FindBaselines() {
+			DirectoryInfo dir = new DirectoryInfo(AppDomain.CurrentDomain.BaseDirectory);
+			while (dir != null) {
+				if (File.Exists(Path.Combine(dir.FullName, "Deveel.CSharpCC.Benchmarks.csproj")))
+					return Path.Combine(dir.FullName, "Baselines");
+				dir = dir.Parent;
+			}
+
+			return Path.Combine(Environment.CurrentDirectory, "Baselines");
+		}
+	}
+}
@@ -0,0 +1,136 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+using Deveel.CSharpCC.Parser;
+
+namespace Deveel.CSharpCC.Benchmarks {
+	/// <summary>
+	/// Generates every grammar family at growing sizes and reports, for every
+	/// phase, how its time and its heap grow with the size of the grammar.
+	/// </summary>
+	/// <remarks>
+	/// The growth is the exponent e of <c>time ~ size^e</c> between the two
+	/// largest sizes: about 1 for a linear phase, 2 for a quadratic one.
+	/// </remarks>
+	public static class ScalabilityReport {
+		/// <summary>
+		/// Phases growing faster than this are marked in the report.
+		/// </summary>
+		public const double SuperLinearGrowth = 1.3;
+
+		// Phases shorter than this are too noisy to tell how they grow.
+		private const double MinMilliseconds = 5;
+
+		private sealed class Sample {
+			public string Phase;
+			public int Depth;
+			public double Milliseconds;
+			public long AllocatedBytes;
+			public long HeapBytesAtEnd;
+		}
+
+		public static void Run(int[] sizes, TextWriter output, string csvFile) {
+			string outputDirectory = Path.Combine(Path.GetTempPath(), "csharpcc-scalability-" + Guid.NewGuid().ToString("N"));
+			Directory.CreateDirectory(outputDirectory);
+
+			try {
+				using (StreamWriter csv = new StreamWriter(csvFile, false, new UTF8Encoding(false))) {
+					csv.WriteLine("family,size,phase,depth,milliseconds,allocatedBytes,heapBytesAtEnd");
+
+					foreach (string family in GrammarFamilies.All) {
+						// Once to compile the generator.
+						Generator.Run(GrammarFamilies.Create(family, sizes[0]), outputDirectory);
+
+						List<List<Sample>> runs = new List<List<Sample>>();
+						foreach (int size in sizes) {
+							GC.Collect();
+							GC.WaitForPendingFinalizers();
+							GC.Collect();
+
+							List<Sample> run = Snapshot(Generator.Run(GrammarFamilies.Create(family, size), outputDirectory));
+							runs.Add(run);
+							foreach (Sample sample in run) {
+								csv.WriteLine(String.Format(CultureInfo.InvariantCulture, "{0},{1},\"{2}\",{3},{4:0.000},{5},{6}",
+									family, size, sample.Phase, sample.Depth, sample.Milliseconds, sample.AllocatedBytes, sample.HeapBytesAtEnd));
+							}
+						}
+
+						WriteFamily(output, family, sizes, runs);
+					}
+				}
+			} finally {
+				Directory.Delete(outputDirectory, true);
+			}
+
+			output.WriteLine("The samples are in {0}", csvFile);
+		}
+
+		private static List<Sample> Snapshot(IList<GenerationStats.PhaseStats> phases) {
+			List<Sample> samples = new List<Sample>();
+			foreach (GenerationStats.PhaseStats stats in phases) {
+				Sample sample = new Sample();
+				sample.Phase = stats.Name;
+				sample.Depth = stats.Depth;
+				sample.Milliseconds = stats.Elapsed.TotalMilliseconds;
+				sample.AllocatedBytes = stats.AllocatedBytes;
+				sample.HeapBytesAtEnd = stats.HeapBytesAtEnd;
+				samples.Add(sample);
+			}
+			return samples;
+		}
+
+		private static void WriteFamily(TextWriter output, string family, int[] sizes, List<List<Sample>> runs) {
+			output.WriteLine();
+			output.WriteLine("{0}: time (ms) by size", family);
+
+			StringBuilder header = new StringBuilder();
+			header.AppendFormat("{0,-40}", "Phase");
+			foreach (int size in sizes)
+				header.AppendFormat(" {0,10}", size);
+			header.AppendFormat(" {0,8} {1,14}", "Growth", "End heap (KB)");
+			output.WriteLine(header);
+
+			// Lexical states are reported one by one and differ between the sizes.
+			List<Sample> last = runs[runs.Count - 1];
+			foreach (Sample sample in last) {
+				if (sample.Phase.StartsWith("LexGen <", StringComparison.Ordinal) && sample.Phase != "LexGen <DEFAULT>")
+					continue;
+
+				StringBuilder line = new StringBuilder();
+				line.AppendFormat("{0,-40}", new String(' ', sample.Depth * 2) + sample.Phase);
+				double[] times = new double[runs.Count];
+				for (int i = 0; i < runs.Count; i++) {
+					Sample s = Find(runs[i], sample.Phase);
+					times[i] = s == null ? 0 : s.Milliseconds;
+					line.Append(String.Format(CultureInfo.InvariantCulture, " {0,10:0.0}", times[i]));
+				}
+
+				double growth = Growth(sizes, times);
+				line.Append(Double.IsNaN(growth) ? String.Format(" {0,8}", "-") : String.Format(CultureInfo.InvariantCulture, " {0,8:0.00}", growth));
+				line.AppendFormat(" {0,14}", sample.HeapBytesAtEnd / 1024);
+				if (growth > SuperLinearGrowth)
+					line.Append("  super-linear");
+				output.WriteLine(line);
+			}
+		}
+
+		private static double Growth(int[] sizes, double[] times) {
+			int n = sizes.Length;
+			if (n < 2 || times[n - 1] < MinMilliseconds || times[n - 2] <= 0)
+				return Double.NaN;
+
+			return Math.Log(times[n - 1] / times[n - 2]) / Math.Log((double) sizes[n - 1] / sizes[n - 2]);
+		}
+
+		private static Sample Find(List<Sample> run, string phase) {
+			foreach (Sample sample in run) {
+				if (sample.Phase == phase)
+					return sample;
+			}
+			return null;
+		}
+	}
+}
@@ -0,0 +1,295 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+using Deveel.CSharpCC.Parser;
+using Deveel.CSharpCC.Util;
+
+using Microsoft.CodeAnalysis;
+using Microsoft.CodeAnalysis.Diagnostics;
+using Microsoft.CodeAnalysis.Text;
+
+namespace Deveel.CSharpCC.Generator {
+	/// <summary>
+	/// Generates the parsers of the grammars (<c>.cc</c>) given to the compilation as
+	/// <c>AdditionalFiles</c>, without a step of the build that runs <c>csharpcc</c>.
+	/// </summary>
+	/// <remarks>
+	/// <para>
+	/// The options of a grammar are read from the metadata <c>CSharpCCOptions</c> of
+	/// the file and from the property of the same name, written as on the command line.
+	/// </para>
+	/// <para>
+	/// The compiler gives a grammar again to the generation only when its text or its
+	/// options change: an edit of the code of the project does not generate the parser
+	/// again.
+	/// </para>
+	/// <para>
+	/// Each error and each warning of the generation is reported as a diagnostic of its
+	/// own, at the line and the column of the grammar it is about.
+	/// </para>
+	/// </remarks>
+	[Generator(LanguageNames.CSharp)]
+	public sealed class CSharpCCSourceGenerator : IIncrementalGenerator {
+		private static readonly DiagnosticDescriptor GenerationFailed = new DiagnosticDescriptor(
+			"CSCC001", "The grammar cannot be generated", "{0}", "CSharpCC", DiagnosticSeverity.Error, true);
+
+		private static readonly DiagnosticDescriptor GenerationWarning = new DiagnosticDescriptor(
+			"CSCC002", "The grammar was generated with warnings", "{0}", "CSharpCC", DiagnosticSeverity.Warning, true);
+
+		// The generator keeps its state in static fields: a single generation at a time.
+		private static readonly object generationLock = new object();
+
+		public void Initialize(IncrementalGeneratorInitializationContext context) {
+			IncrementalValuesProvider<GrammarInput> grammars = context.AdditionalTextsProvider
+				.Where(file => file.Path.EndsWith(".cc", StringComparison.OrdinalIgnoreCase))
+				.Combine(context.AnalyzerConfigOptionsProvider)
+				.Select((pair, cancellationToken) => GrammarInput.Create(pair.Left, pair.Right, cancellationToken))
+				.Where(input => input != null);
+
+			IncrementalValuesProvider<GrammarOutput> outputs = grammars
+				.Select((input, cancellationToken) => Generate(input));
+
+			context.RegisterSourceOutput(outputs, (production, output) => {
+				foreach (KeyValuePair<string, string> source in output.Sources)
+					production.AddSource(source.Key, SourceText.From(source.Value, Encoding.UTF8));
+
+				bool errorReported = false;
+				foreach (CSharpCCErrors.Message message in output.Messages) {
+					DiagnosticDescriptor descriptor = message.IsError ? GenerationFailed : GenerationWarning;
+					production.ReportDiagnostic(Diagnostic.Create(descriptor, output.GetLocation(message), message.Text));
+					errorReported |= message.IsError;
+				}
+
+				// A failure that gave no message of its own: the output of the generation tells why.
+				if (output.Failed && !errorReported)
+					production.ReportDiagnostic(Diagnostic.Create(GenerationFailed, output.GetLocation(null), output.Log));
+			});
+		}
+
+		private static GrammarOutput Generate(GrammarInput input) {
+			Dictionary<string, byte[]> files = new Dictionary<string, byte[]>(StringComparer.OrdinalIgnoreCase);
+			StringWriter log = new StringWriter();
+			List<CSharpCCErrors.Message> messages = new List<CSharpCCErrors.Message>();
+			bool failed;
+
+			lock (generationLock) {
+				TextWriter console = Console.Out;
+				TextWriter error = Console.Error;
+				Console.SetOut(log);
+				Console.SetError(log);
+				GeneratedFileStream.Capture = files;
+				CSharpCCErrors.Capture = messages;
+				try {
+					failed = !Run(input, messages);
+				} catch (Exception e) {
+					log.WriteLine(e.ToString());
+					messages.Add(new CSharpCCErrors.Message(true, 0, 0, e.Message));
+					failed = true;
+				} finally {
+					CSharpCCErrors.Capture = null;
+					GeneratedFileStream.Capture = null;
+					Console.SetError(error);
+					Console.SetOut(console);
+				}
+			}
+
+			string prefix = Path.GetFileNameWithoutExtension(input.Path);
+			List<KeyValuePair<string, string>> sources = new List<KeyValuePair<string, string>>();
+			if (!failed) {
+				List<string> names = new List<string>(files.Keys);
+				names.Sort(StringComparer.Ordinal);
+				foreach (string file in names) {
+					if (!file.EndsWith(".cs", StringComparison.OrdinalIgnoreCase))
+						continue;
+
+					string text = Encoding.UTF8.GetString(files[file]);
+					if (text.Length > 0 && text[0] == '\uFEFF')
+						text = text.Substring(1);
+					sources.Add(new KeyValuePair<string, string>(HintName(prefix, Path.GetFileName(file)), text));
+				}
+			}
+
+			return new GrammarOutput(input, sources, messages, log.ToString().Trim(), failed);
+		}
+
+		// The steps of Program.MainProgram, on the text given by the compiler and with
+		// the generated files kept in memory. The errors that CSharpCCErrors does not
+		// report are added to the messages here.
+		private static bool Run(GrammarInput input, List<CSharpCCErrors.Message> messages) {
+			CSharpCCGlobals.ReInitAll();
+
+			foreach (string option in SplitOptions(input.Options)) {
+				if (!Options.IsOption(option)) {
+					messages.Add(new CSharpCCErrors.Message(true, 0, 0, "\"" + option + "\" is not an option setting."));
+					return false;
+				}
+				SetOption(option, messages);
+			}
+
+			// Nothing is written: the output directory only names the generated files.
+			Options.SetCmdLineOption("-OUTPUT_DIRECTORY=" + Path.GetDirectoryName(input.Path));
+			Options.SetCmdLineOption("-GENERATION_CACHE=false");
+
+			try {
+				CSharpCCGlobals.FileName = CSharpCCGlobals.OriginalFileName = input.Path;
+				new CSharpCCParser(new StringReader(input.Text)).csharpcc_input();
+
+				if (Options.getUnicodeInput())
+					NfaState.unicodeWarningGiven = true;
+
+				Semanticize.start();
+				ParseGen.start();
+				LexGen.start();
+				OtherFilesGen.start();
+
+				return CSharpCCErrors.ErrorCount == 0;
+			} catch (MetaParseException) {
+				return false;
+			} catch (ParseException e) {
+				Console.Out.WriteLine(e.ToString());
+				if (e.currentToken != null && e.currentToken.next != null)
+					messages.Add(new CSharpCCErrors.Message(true, e.currentToken.next.beginLine, e.currentToken.next.beginColumn, e.Message));
+				else
+					messages.Add(new CSharpCCErrors.Message(true, 0, 0, e.Message));
+				return false;
+			}
+		}
+
+		// Options.SetCmdLineOption writes the settings it ignores to the console: they
+		// are warnings of the grammar here.
+		private static void SetOption(string option, List<CSharpCCErrors.Message> messages) {
+			TextWriter console = Console.Out;
+			StringWriter output = new StringWriter();
+			Console.SetOut(output);
+			try {
+				Options.SetCmdLineOption(option);
+			} finally {
+				Console.SetOut(console);
+			}
+
+			string warning = output.ToString().Trim();
+			if (warning.Length > 0) {
+				console.WriteLine(warning);
+				if (warning.StartsWith("Warning: ", StringComparison.Ordinal))
+					warning = warning.Substring("Warning: ".Length);
+				messages.Add(new CSharpCCErrors.Message(false, 0, 0, warning));
+			}
+		}
+
+		private static string HintName(string prefix, string fileName) {
+			StringBuilder sb = new StringBuilder(prefix.Length + fileName.Length + 1);
+			foreach (char c in prefix + "." + fileName)
+				sb.Append(Char.IsLetterOrDigit(c) || c == '.' || c == '_' ? c : '_');
+			return sb.ToString();
+		}
+
+		// Splits the option settings on the spaces, except between double quotes.
+		private static List<string> SplitOptions(string options) {
+			List<string> args = new List<string>();
+			StringBuilder arg = new StringBuilder();
+			bool quoted = false;
+
+			foreach (char c in options) {
+				if (c == '"') {
+					quoted = !quoted;
+				} else if ((Char.IsWhiteSpace(c) || c == ';') && !quoted) {
+					if (arg.Length > 0)
+						args.Add(arg.ToString());
+					arg.Length = 0;
+				} else {
+					arg.Append(c);
+				}
+			}
+
+			if (arg.Length > 0)
+				args.Add(arg.ToString());
+
+			return args;
+		}
+
+		// The grammar as the compiler gives it: equal inputs are not generated again.
+		private sealed class GrammarInput : IEquatable<GrammarInput> {
+			private GrammarInput(string path, string text, string options) {
+				Path = path;
+				Text = text;
+				Options = options;
+			}
+
+			public string Path { get; private set; }
+
+			public string Text { get; private set; }
+
+			public string Options { get; private set; }
+
+			public static GrammarInput Create(AdditionalText file, AnalyzerConfigOptionsProvider optionsProvider, CancellationToken cancellationToken) {
+				SourceText text = file.GetText(cancellationToken);
+				if (text == null)
+					return null;
+
+				string options = "";
+				string value;
+				if (optionsProvider.GlobalOptions.TryGetValue("build_property.CSharpCCOptions", out value))
+					options = value;
+				if (optionsProvider.GetOptions(file).TryGetValue("build_metadata.AdditionalFiles.CSharpCCOptions", out value))
+					options = options + " " + value;
+
+				return new GrammarInput(file.Path, text.ToString(), options.Trim());
+			}
+
+			public bool Equals(GrammarInput other) {
+				return other != null && Path == other.Path && Text == other.Text && Options == other.Options;
+			}
+
+			public override bool Equals(object obj) {
+				return Equals(obj as GrammarInput);
+			}
+
+			public override int GetHashCode() {
+				return Path.GetHashCode() ^ Text.GetHashCode() ^ Options.GetHashCode();
+			}
+		}
+
+		private sealed class GrammarOutput {
+			private readonly GrammarInput input;
+			private TextLineCollection lines;
+
+			public GrammarOutput(GrammarInput input, List<KeyValuePair<string, string>> sources, List<CSharpCCErrors.Message> messages, string log, bool failed) {
+				this.input = input;
+				Sources = sources;
+				Messages = messages;
+				Log = log;
+				Failed = failed;
+			}
+
+			public List<KeyValuePair<string, string>> Sources { get; private set; }
+
+			public List<CSharpCCErrors.Message> Messages { get; private set; }
+
+			public string Log { get; private set; }
+
+			public bool Failed { get; private set; }
+
+			// The place in the grammar of a message: its first character when the message
+			// is about no place in it (or when there is no message).
+			public Location GetLocation(CSharpCCErrors.Message message) {
+				if (lines == null)
+					lines = SourceText.From(input.Text).Lines;
+
+				int line = message == null ? 0 : Math.Max(message.Line - 1, 0);
+				int column = message == null ? 0 : Math.Max(message.Column - 1, 0);
+				if (line >= lines.Count) {
+					line = lines.Count - 1;
+					column = 0;
+				}
+
+				TextLine textLine = lines[line];
+				column = Math.Min(column, textLine.End - textLine.Start);
+				LinePosition position = new LinePosition(line, column);
+				return Location.Create(input.Path, new TextSpan(textLine.Start + column, 0), new LinePositionSpan(position, position));
+			}
+		}
+	}
+}
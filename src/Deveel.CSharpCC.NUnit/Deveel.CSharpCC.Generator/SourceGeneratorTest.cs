@@ -0,0 +1,143 @@
+﻿extern alias generator;
+
+using System;
+using System.Collections.Immutable;
+using System.Threading;
+
+using Microsoft.CodeAnalysis;
+using Microsoft.CodeAnalysis.CSharp;
+using Microsoft.CodeAnalysis.Diagnostics;
+using Microsoft.CodeAnalysis.Text;
+
+using NUnit.Framework;
+
+using CSharpCCSourceGenerator = generator::Deveel.CSharpCC.Generator.CSharpCCSourceGenerator;
+
+namespace Deveel.CSharpCC.Generator {
+	[TestFixture]
+	public class SourceGeneratorTest {
+		private const string GrammarPath = "/grammars/SimpleParser.cc";
+
+		[Test]
+		public void ReportUndefinedToken() {
+			ImmutableArray<Diagnostic> diagnostics = Generate(MakeUpGrammar("  <A> <B> <EOF>"));
+
+			Assert.AreEqual(1, diagnostics.Length);
+			AssertDiagnostic(diagnostics[0], "CSCC001", "Undefined lexical token name \"B\".", 12, 7);
+		}
+
+		[Test]
+		public void ReportSyntaxError() {
+			ImmutableArray<Diagnostic> diagnostics = Generate(MakeUpGrammar("  <A> ) <EOF>"));
+
+			Assert.AreEqual(1, diagnostics.Length);
+			AssertDiagnostic(diagnostics[0], "CSCC001", null, 12, 7);
+			StringAssert.StartsWith("Encountered \")\" at line 12, column 7.", diagnostics[0].GetMessage());
+		}
+
+		[Test]
+		public void ReportInvalidOption() {
+			ImmutableArray<Diagnostic> diagnostics = Generate(MakeUpGrammar("  <A> <EOF>"), "STATIC=false");
+
+			Assert.AreEqual(1, diagnostics.Length);
+			AssertDiagnostic(diagnostics[0], "CSCC001", "\"STATIC=false\" is not an option setting.", 1, 1);
+		}
+
+		[Test]
+		public void ReportIgnoredOption() {
+			ImmutableArray<Diagnostic> diagnostics = Generate(MakeUpGrammar("  <A> <EOF>"), "-NOT_AN_OPTION=true");
+
+			Assert.AreEqual(1, diagnostics.Length);
+			AssertDiagnostic(diagnostics[0], "CSCC002", "Bad option \"-NOT_AN_OPTION=true\" will be ignored.", 1, 1);
+		}
+
+		private static void AssertDiagnostic(Diagnostic diagnostic, string id, string message, int line, int column) {
+			Assert.AreEqual(id, diagnostic.Id);
+			if (message != null)
+				Assert.AreEqual(message, diagnostic.GetMessage());
+
+			FileLinePositionSpan span = diagnostic.Location.GetLineSpan();
+			Assert.AreEqual(GrammarPath, span.Path);
+			Assert.AreEqual(line, span.StartLinePosition.Line + 1);
+			Assert.AreEqual(column, span.StartLinePosition.Character + 1);
+		}
+
+		private static ImmutableArray<Diagnostic> Generate(string grammar, string options = null) {
+			GeneratorDriver driver = CSharpGeneratorDriver.Create(
+				new ISourceGenerator[] { new CSharpCCSourceGenerator().AsSourceGenerator() },
+				new AdditionalText[] { new GrammarText(GrammarPath, grammar) },
+				optionsProvider: options == null ? null : new OptionsProvider(options));
+			return driver.RunGenerators(CSharpCompilation.Create("Grammar")).GetRunResult().Diagnostics;
+		}
+
+		// The production of Input is on the lines 11 to 13.
+		private static string MakeUpGrammar(string input) {
+			return "PARSER_BEGIN(SimpleParser)\n" +
+			       "namespace Deveel.CSharpCC.Parser;\n" +
+			       "public class SimpleParser {\n" +
+			       "}\n" +
+			       "PARSER_END(SimpleParser)\n" +
+			       "TOKEN: {\n" +
+			       "< A: \"a\" >\n" +
+			       "}\n" +
+			       "void Input() :\n" +
+			       "{}\n" +
+			       "{\n" +
+			       input + "\n" +
+			       "}\n";
+		}
+
+		private sealed class GrammarText : AdditionalText {
+			private readonly string path;
+			private readonly string text;
+
+			public GrammarText(string path, string text) {
+				this.path = path;
+				this.text = text;
+			}
+
+			public override string Path {
+				get { return path; }
+			}
+
+			public override SourceText GetText(CancellationToken cancellationToken = default(CancellationToken)) {
+				return SourceText.From(text);
+			}
+		}
+
+		private sealed class OptionsProvider : AnalyzerConfigOptionsProvider {
+			private readonly AnalyzerConfigOptions options;
+
+			public OptionsProvider(string csharpccOptions) {
+				options = new ConfigOptions(csharpccOptions);
+			}
+
+			public override AnalyzerConfigOptions GlobalOptions {
+				get { return options; }
+			}
+
+			public override AnalyzerConfigOptions GetOptions(SyntaxTree tree) {
+				return ConfigOptions.Empty;
+			}
+
+			public override AnalyzerConfigOptions GetOptions(AdditionalText textFile) {
+				return ConfigOptions.Empty;
+			}
+
+			private sealed class ConfigOptions : AnalyzerConfigOptions {
+				public static readonly ConfigOptions Empty = new ConfigOptions(null);
+
+				private readonly string csharpccOptions;
+
+				public ConfigOptions(string csharpccOptions) {
+					this.csharpccOptions = csharpccOptions;
+				}
+
+				public override bool TryGetValue(string key, out string value) {
+					value = csharpccOptions;
+					return csharpccOptions != null && key == "build_property.CSharpCCOptions";
+				}
+			}
+		}
+	}
+}
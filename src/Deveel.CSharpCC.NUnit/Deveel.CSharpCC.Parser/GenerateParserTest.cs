@@ -1,6 +1,13 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.IO;
+using System.Reflection;
 using System.Text;
+using System.Text.RegularExpressions;
+
+using Microsoft.CodeAnalysis;
+using Microsoft.CodeAnalysis.CSharp;
+using Microsoft.CodeAnalysis.Emit;
 
 using NUnit.Framework;
 
@@ -14,32 +21,27 @@ namespace Deveel.CSharpCC.Parser {
 
 		private void DeleteFiles() {
 			// Initialize all static state
-			ReInitAll();
+			CSharpCCGlobals.ReInitAll();
 
 			DeleteFile("SimpleParser.cs");
 			DeleteFile("SimpleParserConstants.cs");
+			DeleteFile("SimpleCharStream.cs");
 			DeleteFile("SimpleParserTokenManager.cs");
 			DeleteFile("TokenManagerError.cs");
 			DeleteFile("Token.cs");
 			DeleteFile("ParseException.cs");
-		}
-
-		private void ReInitAll() {
-			Expansion.reInit();
-			CSharpCCErrors.ReInit();
-			CSharpCCGlobals.ReInit();
-			Options.init();
-			CSharpCCParserInternals.reInit();
-			RStringLiteral.reInit();
-			// CSharpFiles.reInit();
-			LexGen.reInit();
-			NfaState.reInit();
-			MatchInfo.reInit();
-			LookaheadWalk.reInit();
-			Semanticize.reInit();
-			ParseGen.reInit();
-			OtherFilesGen.reInit();
-			ParseEngine.reInit();
+			DeleteFile("TokenRing.cs");
+			DeleteFile("SimpleParserTokenizer.cs");
+			DeleteFile("SimpleParserBatch.cs");
+			DeleteFile("NameTable.cs");
+			DeleteFile("SimpleParserEventSource.cs");
+			DeleteFile("SimpleParserLookaheadProfile.cs");
+			DeleteFile("SimpleParserProfile.cs");
+			DeleteFile("SimpleParser.profile");
+			DeleteFile("SimpleParserCache.txt");
+			DeleteFile("SimpleParserStats.json");
+			DeleteFile("SimpleParserTree.cs");
+			DeleteFile("ISimpleParserEventSink.cs");
 		}
 
 		private void DeleteFile(string fileName) {
@@ -50,14 +52,847 @@ namespace Deveel.CSharpCC.Parser {
 
 		[TearDown]
 		public void TearDown() {
-			
+			DeleteFiles();
 		}
 
 		[Test]
 		public void GenerateNoErrors() {
-			var input = MakeUpGrammar();
 			SetupOptions();
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+		}
+
+		[Test]
+		public void GeneratePipelinedTokenManager() {
+			SetupOptions();
+			Options.SetCmdLineOption("PIPELINED_TOKEN_MANAGER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "TokenRing.cs")));
+		}
+
+		[Test]
+		public void ParseWithPipelinedTokenManager() {
+			SetupOptions();
+			Options.SetCmdLineOption("PIPELINED_TOKEN_MANAGER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual("'hello'", RunDriver(ParseInputDriver, "READ AND PRINT 'hello'").Trim());
+
+			// The lexical error of the producer thread reaches the parser with its stack trace.
+			string error = RunDriver(ParseInputDriver, "READ AND PRINT 'hello");
+			StringAssert.Contains("InvalidOperationException", error);
+			StringAssert.Contains("TokenManagerError", error);
+			StringAssert.Contains("SimpleParserTokenManager.GetNextToken", error);
+		}
+
+		[Test]
+		public void ParseInParallelBatches() {
+			SetupOptions();
+			Options.SetCmdLineOption("STATEMENT_SEPARATOR=SEMICOLON");
+			Generate(MakeUpListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      foreach (SimpleParserBatch.Result<int> result in new SimpleParserBatch(2).Parse<int>(input, delegate(SimpleParser p) { return p.Statement(); })) {\n" +
+				"        sb.Append(result.Chunk.BeginLine).Append(':').Append(result.Chunk.BeginColumn).Append('=');\n" +
+				"        sb.Append(result.Error == null ? result.Value.ToString() : result.Error.GetType().Name).Append(' ');\n" +
+				"      }\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+
+			// The empty statement is dropped, every chunk starts right after its
+			// separator and the error of a chunk does not stop the others.
+			Assert.AreEqual("1:1=2 1:5=3 2:15=ParseException 2:19=1 ",
+				RunDriver(driver, "a b;\n1 (2 3) 'x'; ;c );\n(d)"));
+		}
+
+		[Test]
+		public void SplitOutOfBrackets() {
+			SetupOptions();
+			Options.SetCmdLineOption("STATEMENT_SEPARATOR=SEMICOLON");
+			Generate(MakeUpListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      foreach (SimpleParserBatch.Chunk chunk in SimpleParserBatch.Split(input))\n" +
+				"        sb.Append('[').Append(input.Substring(chunk.Offset, chunk.Length)).Append(']');\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+
+			// The separators in parentheses or in a string do not end the statement.
+			Assert.AreEqual("[a (b; (c;)) 'x;y'][ d][ e) f]",
+				RunDriver(driver, "a (b; (c;)) 'x;y'; d; e) f"));
+		}
+
+		[Test]
+		public void GenerateParallelTokenizer() {
+			SetupOptions();
+			Options.SetCmdLineOption("PARALLEL_TOKENIZER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenizer.cs")));
+		}
+
+		[Test]
+		public void TokenizeInParallel() {
+			string expected = LexWithDefaults(MakeUpCommentedListGrammar(), LexerInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("PARALLEL_TOKENIZER=true");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      try {\n" +
+				"        // Chunks guessed in the default state only, and in both states.\n" +
+				"        foreach (Token t in SimpleParserTokenizer.Tokenize(input, 7, new int[] { 0 }))\n" +
+				"          Tokens.Dump(sb, t);\n" +
+				"        sb.Append('|');\n" +
+				"        foreach (Token t in SimpleParserTokenizer.Tokenize(input, 7, new int[] { 1, 0 }))\n" +
+				"          Tokens.Dump(sb, t);\n" +
+				"      } catch (System.Exception e) {\n" +
+				"        return e.ToString();\n" +
+				"      }\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+
+			Assert.AreEqual(expected + "|" + expected, RunDriver(driver, TokensDump, LexerInput));
+
+			// A lexical error on a worker reaches the caller with the stack trace of the worker.
+			string error = RunDriver(driver, TokensDump, LexerInput + "\n\n(a #)\n");
+			StringAssert.Contains("TokenManagerError", error);
+			StringAssert.Contains("SimpleParserTokenManager.GetNextToken", error);
+		}
+
+		[Test]
+		public void GenerateTokenKindScanner() {
+			SetupOptions();
+			Options.SetCmdLineOption("TOKEN_KIND_SCANNER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("int NextTokenKind(out int start, out int length)", tokenManager);
+		}
+
+		[Test]
+		public void ScanTokenKinds() {
+			string expected = LexWithDefaults(MakeUpCommentedListGrammar(), LexerInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("TOKEN_KIND_SCANNER=true");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(TokensDriver, TokensDump, LexerInput));
+
+			// The scanner reads the kinds and the text of the tokens GetNextToken reads.
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      SimpleParserTokenManager tokens = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input), 1, 1));\n" +
+				"      SimpleParserTokenManager kinds = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input), 1, 1));\n" +
+				"      for (int n = 1; ; n++) {\n" +
+				"        Token t = tokens.GetNextToken();\n" +
+				"        int start, length;\n" +
+				"        int kind = kinds.NextTokenKind(out start, out length);\n" +
+				"        if (kind != t.Kind || (kind != SimpleParserConstants.EOF && input.Substring(start, length) != t.Image))\n" +
+				"          return \"token \" + n + \": \" + kind + \" \" + input.Substring(start, length) + \" for \" + t.Kind + \" \" + t.Image;\n" +
+				"        if (kind == SimpleParserConstants.EOF)\n" +
+				"          return n + \" tokens\";\n" +
+				"      }\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			Assert.AreEqual("41 tokens", RunDriver(driver, LexerInput));
+		}
+
+		[Test]
+		public void GenerateInternedTokens() {
+			SetupOptions();
+			Options.SetCmdLineOption("INTERN_TOKENS=STRING_LITERAL");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "NameTable.cs")));
+		}
+
+		[Test]
+		public void ReadInternedTokens() {
+			string expected = LexWithDefaults(MakeUpCommentedListGrammar(), LexerInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("INTERN_TOKENS=NAME");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(TokensDriver, TokensDump, LexerInput));
+
+			// The names with the same text share one string.
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      SimpleParserTokenManager tm = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input), 1, 1));\n" +
+				"      System.Collections.Generic.List<string> names = new System.Collections.Generic.List<string>();\n" +
+				"      int shared = 0;\n" +
+				"      for (Token t = tm.GetNextToken(); t.Kind != SimpleParserConstants.EOF; t = tm.GetNextToken()) {\n" +
+				"        if (t.Kind != SimpleParserConstants.NAME)\n" +
+				"          continue;\n" +
+				"        foreach (string name in names) {\n" +
+				"          if (name == t.Image && (object) name == (object) t.Image)\n" +
+				"            shared++;\n" +
+				"        }\n" +
+				"        names.Add(t.Image);\n" +
+				"      }\n" +
+				"      return names.Count + \" names, \" + shared + \" shared\";\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			// a/a, a/a, a/a and bb/bb.
+			Assert.AreEqual("5 names, 4 shared", RunDriver(driver, "a (bb a) 'a' bb;\n(a)"));
+		}
+
+		[Test]
+		public void GenerateTypedTokenValues() {
+			SetupOptions();
+			Options.SetCmdLineOption("TOKEN_VALUES=STRING_LITERAL:verbatim");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("return new QuotedToken(", tokenManager);
+			string token = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "Token.cs"));
+			StringAssert.Contains("class ValueToken<T> : Token", token);
+		}
+
+		[Test]
+		public void ReadTypedTokenValues() {
+			SetupOptions();
+			// STRING_LITERAL is the kind 10, with the bit 1 of its ordinal set.
+			Options.SetCmdLineOption("TOKEN_VALUES=STRING_LITERAL:verbatim");
+			Generate(MakeUpListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual("-=12;-=(;String a b='a b';String ='';-=x;-=);",
+				RunDriver(TokenValuesDriver, "12 ('a b' '' x)"));
+		}
+
+		[Test]
+		public void ReadTypedTokenImages() {
+			SetupOptions();
+			Options.SetCmdLineOption("TOKEN_VALUES=NUMBER:long");
+			Generate(MakeUpListGrammar());
+
+			// The image is the one read, even where the value is written otherwise.
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual("Int64 12=12;Int64 7=007;Int64 0=0;Int64 0=00;-=x;",
+				RunDriver(TokenValuesDriver, "12 007 0 00 x"));
+		}
+
+		[Test]
+		public void ReadTypedTokenValuesOutOfRange() {
+			SetupOptions();
+			Options.SetCmdLineOption("TOKEN_VALUES=NUMBER:long,NAME:int");
+			// The names are the numbers after a plus sign, to read an int kind.
+			string grammar = MakeUpListGrammar()
+				.Replace("< NUMBER: ([\"0\"-\"9\"])+ > |", "< NUMBER: ([\"0\"-\"9\"])+ | \"0x\" ([\"0\"-\"9\", \"a\"-\"f\"])+ > |")
+				.Replace("< NAME: [\"a\"-\"z\"] ([\"a\"-\"z\", \"0\"-\"9\"])* > |", "< NAME: \"+\" ([\"0\"-\"9\"])+ > |");
+			Generate(grammar);
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(
+				"Int64 9223372036854775807=9223372036854775807;Int64 9223372036854775807=0x7fffffffffffffff;\n" +
+				"Lexical error at line 1, column 3.  The value of \"9223372036854775808\" is out of the range of its kind.\n" +
+				"Lexical error at line 2, column 1.  The value of \"99999999999999999999\" is out of the range of its kind.\n" +
+				"Lexical error at line 1, column 1.  The value of \"0x8000000000000000\" is out of the range of its kind.\n" +
+				"Int32 2147483647=+2147483647;\n" +
+				"Lexical error at line 1, column 1.  The value of \"+2147483648\" is out of the range of its kind.\n",
+				RunDriver(TokenErrorsDriver, "9223372036854775807 0x7fffffffffffffff\0( 9223372036854775808\0\n99999999999999999999\0" +
+				          "0x8000000000000000\0+2147483647\0+2147483648"));
+		}
+
+		// Reads the tokens of each input between '\0', and returns the value and the
+		// image of each, or the lexical error.
+		private const string TokenErrorsDriver =
+			"namespace Deveel.CSharpCC.Parser {\n" +
+			"  public static class Driver {\n" +
+			"    public static string Run(string input) {\n" +
+			"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+			"      foreach (string part in input.Split('\\0')) {\n" +
+			"        SimpleParserTokenManager tm = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(part), 1, 1));\n" +
+			"        try {\n" +
+			"          for (Token t = tm.GetNextToken(); t.Kind != 0; t = tm.GetNextToken()) {\n" +
+			"            if (t.Value != null)\n" +
+			"              sb.Append(t.Value.GetType().Name + \" \" + t.Value).Append('=').Append(t.Image).Append(';');\n" +
+			"          }\n" +
+			"          sb.Append('\\n');\n" +
+			"        } catch (TokenManagerError e) {\n" +
+			"          sb.Append(e.Message).Append('\\n');\n" +
+			"        }\n" +
+			"      }\n" +
+			"      return sb.ToString();\n" +
+			"    }\n" +
+			"  }\n" +
+			"}\n";
+
+		// Reads the tokens of the input, and returns the value and the image of each.
+		private const string TokenValuesDriver =
+			"namespace Deveel.CSharpCC.Parser {\n" +
+			"  public static class Driver {\n" +
+			"    public static string Run(string input) {\n" +
+			"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+			"      SimpleParserTokenManager tm = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input), 1, 1));\n" +
+			"      for (Token t = tm.GetNextToken(); t.Kind != 0; t = tm.GetNextToken()) {\n" +
+			"        sb.Append(t.Value == null ? \"-\" : t.Value.GetType().Name + \" \" + t.Value).Append('=').Append(t.Image).Append(';');\n" +
+			"      }\n" +
+			"      return sb.ToString();\n" +
+			"    }\n" +
+			"  }\n" +
+			"}\n";
+
+		[Test]
+		public void GenerateParseTree() {
+			SetupOptions();
+			Options.SetCmdLineOption("BUILD_TREE=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "SimpleParserTree.cs")));
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			StringAssert.Contains("int cc_node = cc_tree.Open(0, token);", parser);
+			StringAssert.Contains("cc_tree.Close(cc_node, token);", parser);
+		}
+
+		[Test]
+		public void ParseTree() {
+			SetupOptions();
+			Options.SetCmdLineOption("BUILD_TREE=true");
+			Generate(MakeUpListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      SimpleParser parser = new SimpleParser(new System.IO.StringReader(\"\"));\n" +
+				"      SimpleParserTree tree = parser.Tree;\n" +
+				"      // The nodes of the second parse are written over those of the first.\n" +
+				"      foreach (string part in input.Split('\\0')) {\n" +
+				"        parser.ReInit(new System.IO.StringReader(part));\n" +
+				"        sb.Append(tree.Count).Append(\": \");\n" +
+				"        parser.Input();\n" +
+				"        for (int i = 0; i < tree.Count; i++) {\n" +
+				"          SimpleParserTree.Node node = tree[i];\n" +
+				"          sb.Append(tree.GetProductionName(i)).Append('(').Append(node.Parent).Append(' ');\n" +
+				"          sb.Append(node.FirstToken == null ? \"-\" : node.FirstToken.Image + \"..\" + node.LastToken.Image).Append(\") \");\n" +
+				"        }\n" +
+				"      }\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+
+			Assert.AreEqual("0: Input(-1 a..) Item(0 a..a) Item(0 (..)) List(2 (..)) Item(3 1..1) Item(3 'x'..'x') " +
+				"0: Input(-1 (..) Item(0 (..)) List(1 (..)) ",
+				RunDriver(driver, "a ; (1 'x')\0()"));
+		}
+
+		[Test]
+		public void GenerateEventSink() {
+			SetupOptions();
+			Options.SetCmdLineOption("EVENT_SINK=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "ISimpleParserEventSink.cs")));
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			StringAssert.Contains("class SimpleParser<TSink>", parser);
+			StringAssert.Contains("where TSink : struct, ISimpleParserEventSink", parser);
+			StringAssert.Contains("cc_sink.Enter(0);", parser);
+			StringAssert.Contains("cc_sink.Token(token);", parser);
+			StringAssert.Contains("oldToken.Next = null;", parser);
+		}
+
+		[Test]
+		public void ParseWithEventSink() {
+			SetupOptions();
+			Options.SetCmdLineOption("EVENT_SINK=true");
+			Generate(MakeUpListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public struct Sink : ISimpleParserEventSink {\n" +
+				"    public System.Text.StringBuilder Log;\n" +
+				"    public Token First;\n" +
+				"    public void Enter(int production) { Log.Append('<').Append(production).Append(' '); }\n" +
+				"    public void Exit(int production) { Log.Append(production).Append(\"> \"); }\n" +
+				"    public void Token(Token token) {\n" +
+				"      if (First == null) First = token;\n" +
+				"      Log.Append(token.Image).Append(' ');\n" +
+				"    }\n" +
+				"  }\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      SimpleParser<Sink> parser = new SimpleParser<Sink>(new System.IO.StringReader(input));\n" +
+				"      Sink sink = new Sink();\n" +
+				"      sink.Log = new System.Text.StringBuilder();\n" +
+				"      parser.Sink = sink;\n" +
+				"      parser.Input();\n" +
+				"      // The consumed tokens are unlinked from the next.\n" +
+				"      return parser.Sink.Log.Append(parser.Sink.First.Next == null).ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+
+			Assert.AreEqual("<0 <2 a 2> ; <2 <3 ( <2 1 2> <2 <3 ( ) 3> 2> ) 3> 2>  0> True",
+				RunDriver(driver, "a ; (1 ())"));
+		}
+
+		[Test]
+		public void GenerateInstrumented() {
+			SetupOptions();
+			Options.SetCmdLineOption("INSTRUMENT=true");
+			Options.SetCmdLineOption("CLR_VERSION=5.0");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "SimpleParserEventSource.cs")));
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			StringAssert.Contains("cc_enter(0);", parser);
+		}
+
+		[Test]
+		public void CountInstrumentedCalls() {
+			string expected = ParseWithDefaults(MakeUpCommentedListGrammar(), ParserInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("INSTRUMENT=true");
+			Options.SetCmdLineOption("CLR_VERSION=4.5");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(ParseListDriver, ParserInput));
+
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      new SimpleParser(new System.IO.StringReader(input)).Input();\n" +
+				"      SimpleParserEventSource log = SimpleParserEventSource.Log;\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      for (int i = 0; i < log.ProductionCount; i++)\n" +
+				"        sb.Append(log.GetProductionName(i)).Append('=').Append(log.GetProductionCalls(i)).Append(' ');\n" +
+				"      sb.Append(\"entry points=\").Append(log.EntryPoints);\n" +
+				"      sb.Append(\" tokens=\").Append(log.TokensConsumed);\n" +
+				"      sb.Append(\" characters=\").Append(log.CharactersLexed);\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			// 23 atoms and 7 lists, 3 semicolons and the end of the input.
+			Assert.AreEqual("Input=1 Statement=0 Item=30 List=7 entry points=1 tokens=41 characters=" + LexerInput.Length,
+				RunDriver(driver, LexerInput));
+		}
+
+		[Test]
+		public void GenerateLookaheadProfile() {
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_LOOKAHEAD=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "SimpleParserLookaheadProfile.cs")));
+		}
+
+		[Test]
+		public void ProfileLookahead() {
+			// The empty lists are told from the others by a lookahead scanning a production.
+			string grammar = MakeUpCommentedListGrammar().Replace(
+				"<NUMBER> | <NAME> | <STRING_LITERAL> | List()",
+				"LOOKAHEAD(EmptyList()) EmptyList() | <NUMBER> | <NAME> | <STRING_LITERAL> | List()");
+			grammar += "\nvoid EmptyList() :\n{}\n{\n<LPAREN> <RPAREN>\n}\n";
+			string expected = ParseWithDefaults(grammar, ParserInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_LOOKAHEAD=true");
+			Generate(grammar);
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(ParseListDriver, ParserInput));
+
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      new SimpleParser(new System.IO.StringReader(input)).Input();\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      foreach (SimpleParserLookaheadProfile.Site site in SimpleParserLookaheadProfile.GetSites()) {\n" +
+				"        sb.Append(site.Production).Append(' ').Append(site.Calls).Append(' ').Append(site.Successes);\n" +
+				"        sb.Append(' ').Append(site.TokensScanned).Append(' ').Append(site.Rescans).Append(';');\n" +
+				"      }\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			// Every item tests the lookahead: the 23 atoms fail at their first token,
+			// the 7 lists scan two tokens in EmptyList and the empty one succeeds.
+			Assert.AreEqual("Item 30 1 37 0;", RunDriver(driver, LexerInput));
+		}
+
+		[Test]
+		public void GenerateProfiledTokenManager() {
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_TOKEN_MANAGER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("WriteProfile(debugStream);", tokenManager);
+		}
+
+		[Test]
+		public void ProfileTokenManager() {
+			string expected = LexWithDefaults(MakeUpCommentedListGrammar(), LexerInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_TOKEN_MANAGER=true");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(TokensDriver, TokensDump, LexerInput));
+
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      SimpleParserTokenManager tm = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input), 1, 1));\n" +
+				"      while (tm.GetNextToken().Kind != SimpleParserConstants.EOF) {\n" +
+				"      }\n" +
+				"      System.IO.StringWriter writer = new System.IO.StringWriter();\n" +
+				"      tm.WriteProfile(writer);\n" +
+				"      return writer.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			string profile = Regex.Replace(RunDriver(driver, LexerInput), " +", " ").Replace("\r\n", "\n");
+
+			// The characters of the tokens, and of the "/*" entering the comments;
+			// the comments with their "*/" and the 35 characters matched one by one.
+			StringAssert.Contains("\nDEFAULT 84 ", profile);
+			StringAssert.Contains("\nIN_COMMENT 47 ", profile);
+			StringAssert.Contains("\nToken kind Matches\n" +
+				"\"(\" 7\n\")\" 7\n\";\" 3\n<NUMBER> 3\n<NAME> 15\n<STRING_LITERAL> 5\n" +
+				"\"/*\" 6\n\"*/\" 6\n<token of kind 13> 35\n\n", profile);
+			StringAssert.Contains("Lexical actions: 6 calls", profile);
+		}
+
+		[Test]
+		public void GenerateWithStats() {
+			SetupOptions();
+			Options.SetCmdLineOption("STATS=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(GenerationStats.GetCounter("Productions") > 0);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "SimpleParserStats.json")));
+		}
 
+		[Test]
+		public void ParseWithStats() {
+			string expected = ParseWithDefaults(MakeUpCommentedListGrammar(), ParserInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("STATS=true");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(ParseListDriver, ParserInput));
+			string[] files = Directory.GetFiles(Environment.CurrentDirectory, "*.cs");
+			Assert.AreEqual(files.Length, GenerationStats.GetCounter("Generated files"));
+			Assert.AreEqual(CountLines(files), GenerationStats.GetCounter("Generated lines"));
+
+			// The grammar files are generated again but left unchanged, and the
+			// support files are kept: only the first ones are counted.
+			CSharpCCGlobals.ReInitAll();
+			SetupOptions();
+			Options.SetCmdLineOption("STATS=true");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(3, GenerationStats.GetCounter("Generated files"));
+			Assert.AreEqual(CountLines("SimpleParser.cs", "SimpleParserTokenManager.cs", "SimpleParserConstants.cs"),
+				GenerationStats.GetCounter("Generated lines"));
+		}
+
+		[Test]
+		public void GenerateProfiledParser() {
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_PARSER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.IsTrue(File.Exists(Path.Combine(Environment.CurrentDirectory, "SimpleParserProfile.cs")));
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			StringAssert.Contains("SimpleParserProfile.Enter(0);", parser);
+			StringAssert.Contains("SimpleParserProfile.Consume(kind);", parser);
+		}
+
+		[Test]
+		public void ProfileParser() {
+			string expected = ParseWithDefaults(MakeUpCommentedListGrammar(), ParserInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_PARSER=true");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(ParseListDriver, ParserInput));
+
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      new SimpleParser(new System.IO.StringReader(input)).Input();\n" +
+				"      System.IO.StringWriter writer = new System.IO.StringWriter();\n" +
+				"      SimpleParserProfile.WriteProfile(writer);\n" +
+				"      return writer.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			string profile = RunDriver(driver, LexerInput).Replace("\r\n", "\n");
+			// 18 items and 3 semicolons at the top, 3 numbers, 15 names, 5 strings and 7 lists.
+			Assert.AreEqual("csharpcc-profile 1 SimpleParser\n" +
+				"production 1 Input\nproduction 0 Statement\nproduction 30 Item\nproduction 7 List\n" +
+				"choice Input 0 18 3\nchoice Item 0 3 15 5 7\n" +
+				"token 1 <EOF>\ntoken 7 \"(\"\ntoken 7 \")\"\ntoken 3 \";\"\n" +
+				"token 3 <NUMBER>\ntoken 15 <NAME>\ntoken 5 <STRING_LITERAL>\n", profile);
+
+			// The parser laid out for the profile parses as the default one.
+			string profileFile = Path.Combine(Environment.CurrentDirectory, "SimpleParser.profile");
+			File.WriteAllText(profileFile, profile);
+			CSharpCCGlobals.ReInitAll();
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_FILE=" + profileFile);
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(expected, RunDriver(ParseListDriver, ParserInput));
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			int item = parser.IndexOf("public void Item()");
+			int name = parser.IndexOf("case NAME:", item);
+			int list = parser.IndexOf("case LPAREN:", item);
+			int stringLiteral = parser.IndexOf("case STRING_LITERAL:", item);
+			int number = parser.IndexOf("case NUMBER:", item);
+			Assert.IsTrue(item >= 0 && name < list && list < stringLiteral && stringLiteral < number);
+		}
+
+		[Test]
+		public void GenerateWithProfileFile() {
+			string profile = Path.Combine(Environment.CurrentDirectory, "SimpleParser.profile");
+			File.WriteAllText(profile, "csharpcc-profile 1 SimpleParser\nproduction 9 Item\nchoice Item 0 1 3 5 0\ntoken 5 <STRING_LITERAL>\n");
+
+			SetupOptions();
+			Options.SetCmdLineOption("PROFILE_FILE=" + profile);
+			Generate(MakeUpListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			// The alternatives of Item are tested the most taken first.
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			int item = parser.IndexOf("public void Item()");
+			int stringLiteral = parser.IndexOf("case STRING_LITERAL:", item);
+			int name = parser.IndexOf("case NAME:", item);
+			int number = parser.IndexOf("case NUMBER:", item);
+			int list = parser.IndexOf("case LPAREN:", item);
+			Assert.IsTrue(item >= 0 && stringLiteral < name && name < number && number < list);
+		}
+
+		[Test]
+		public void GenerateWithSplitNfaMoves() {
+			SetupOptions();
+			Options.SetCmdLineOption("MAX_METHOD_SIZE=1");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("kind = ccMoveNfa_0_0(i, startsAt, kind);", tokenManager);
+			StringAssert.Contains("private int ccMoveNfa_0_2(int i, int startsAt, int kind)", tokenManager);
+		}
+
+		[Test]
+		public void LexWithSplitNfaMoves() {
+			string expected = LexWithDefaults(MakeUpCommentedListGrammar(), LexerInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("MAX_METHOD_SIZE=1");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			// Every state of both lexical states is moved in a method of its own.
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("kind = ccMoveNfa_0_0(i, startsAt, kind);", tokenManager);
+			StringAssert.Contains("kind = ccMoveNfa_1_0(i, startsAt, kind);", tokenManager);
+			Assert.AreEqual(expected, RunDriver(TokensDriver, TokensDump, LexerInput));
+		}
+
+		[Test]
+		public void GenerateSpanTables() {
+			SetupOptions();
+			Options.SetCmdLineOption("CLR_VERSION=7.0");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			StringAssert.Contains("static private System.ReadOnlySpan<int> cc_la1_0 => new int[] {", parser);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("static System.ReadOnlySpan<long> ccToToken => new long[] {", tokenManager);
+		}
+
+		[Test]
+		public void ParseWithSpanTables() {
+			string expectedTokens = LexWithDefaults(MakeUpCommentedListGrammar(), LexerInput);
+			string expected = ParseWithDefaults(MakeUpCommentedListGrammar(), ParserInput);
+
+			SetupOptions();
+			Options.SetCmdLineOption("CLR_VERSION=7.0");
+			Generate(MakeUpCommentedListGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string parser = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs"));
+			StringAssert.Contains("System.ReadOnlySpan<int> cc_la1_0 => new int[] {", parser);
+			Assert.AreEqual(expectedTokens, RunDriver(TokensDriver, TokensDump, LexerInput));
+			Assert.AreEqual(expected, RunDriver(ParseListDriver, ParserInput));
+		}
+
+		[Test]
+		public void GenerateUnicodeTables() {
+			SetupOptions();
+			Options.SetCmdLineOption("UNICODE_INPUT=true");
+			Options.SetCmdLineOption("UNICODE_TABLES=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("ccCharClasses0[charSet]", tokenManager);
+			StringAssert.DoesNotContain("ccCanMove_", tokenManager);
+
+			// Characters past the ASCII range go through the class tables.
+			Assert.AreEqual("'h\u00e9llo \u4e16\u754c'", RunDriver(ParseInputDriver, "READ AND PRINT 'h\u00e9llo \u4e16\u754c'").Trim());
+		}
+
+		[Test]
+		public void GenerateKeywordHash() {
+			SetupOptions();
+			Options.SetCmdLineOption("KEYWORD_HASH=true");
+			Generate(MakeUpGrammar()
+				.Replace("< PRINT: \"print\" >", "< PRINT: \"print\" > |\n< IDENTIFIER: [\"a\"-\"z\"] ([\"a\"-\"z\", \"0\"-\"9\"])* >")
+				.Replace("\"READ\" \"AND\" \"PRINT\"", "<READ> <AND> <PRINT>"));
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string tokenManager = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleParserTokenManager.cs"));
+			StringAssert.Contains("ccMatchedKind = ccKeywordKind_0(ccMatchedPos + 1, ccMatchedKind);", tokenManager);
+			string charStream = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleCharStream.cs"));
+			StringAssert.Contains("public uint SuffixHash(int len, bool fold)", charStream);
+
+			// The keywords are still told apart from the identifiers they prefix.
+			Assert.AreEqual("'hello'", RunDriver(ParseInputDriver, "read and print 'hello'").Trim());
+			StringAssert.Contains("ParseException", RunDriver(ParseInputDriver, "read and printer 'hello'"));
+		}
+
+		[Test]
+		public void GenerateMergedNfaStates() {
+			SetupOptions();
+			TextWriter console = Console.Out;
+			StringWriter output = new StringWriter();
+			Console.SetOut(output);
+			try {
+				Generate(MakeUpGrammar().Replace("< PRINT: \"print\" >", "< PRINT: \"print\" > |\n< #DIGIT: [\"0\"-\"9\"] > |\n< NUMBER: (<DIGIT>)+ (\".\" (<DIGIT>)+)? >"));
+			} finally {
+				Console.SetOut(console);
+			}
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			// The merge is only told in the STATS report.
+			Assert.IsTrue(GenerationStats.GetCounter("NFA states after merging") < GenerationStats.GetCounter("NFA states constructed"));
+			StringAssert.DoesNotContain("NFA states", output.ToString());
+
+			// Both references to DIGIT still match after their states are merged.
+			string driver =
+				"namespace Deveel.CSharpCC.Parser {\n" +
+				"  public static class Driver {\n" +
+				"    public static string Run(string input) {\n" +
+				"      SimpleParserTokenManager tokens = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input)));\n" +
+				"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+				"      for (Token t = tokens.GetNextToken(); t.Kind != SimpleParserConstants.EOF; t = tokens.GetNextToken())\n" +
+				"        sb.Append(SimpleParserConstants.TokenImage[t.Kind]).Append('=').Append(t.Image).Append(' ');\n" +
+				"      return sb.ToString();\n" +
+				"    }\n" +
+				"  }\n" +
+				"}\n";
+			Assert.AreEqual("<NUMBER>=12 <NUMBER>=3.45 \"read\"=read <NUMBER>=0.5 ", RunDriver(driver, "12 3.45 read 0.5"));
+		}
+
+		[Test]
+		public void GenerateLeavesUnchangedFiles() {
+			SetupOptions();
+			Generate(MakeUpGrammar());
+
+			string parserFile = Path.Combine(Environment.CurrentDirectory, "SimpleParser.cs");
+			DateTime written = new DateTime(2000, 1, 1);
+			File.SetLastWriteTime(parserFile, written);
+
+			CSharpCCGlobals.ReInitAll();
+			SetupOptions();
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			Assert.AreEqual(written, File.GetLastWriteTime(parserFile));
+		}
+
+		[Test]
+		public void RegenerateWithOtherOptions() {
+			SetupOptions();
+			Generate(MakeUpGrammar());
+
+			// The token kind scanner needs the offsets the first SimpleCharStream.cs lacks.
+			CSharpCCGlobals.ReInitAll();
+			SetupOptions();
+			Options.SetCmdLineOption("TOKEN_KIND_SCANNER=true");
+			Generate(MakeUpGrammar());
+
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+			string charStream = File.ReadAllText(Path.Combine(Environment.CurrentDirectory, "SimpleCharStream.cs"));
+			StringAssert.Contains("TRACK_OFFSETS=True", charStream);
+			Assert.AreEqual("'hello'", RunDriver(ParseInputDriver, "READ AND PRINT 'hello'").Trim());
+		}
+
+		private void Generate(string input) {
 			using (var reader = new StringReader(input)) {
 				var parser = new CSharpCCParser(reader);
 
@@ -65,19 +900,266 @@ namespace Deveel.CSharpCC.Parser {
 				parser.csharpcc_input();
 				CSharpCCGlobals.CreateOutputDir(Options.getOutputDirectory().FullName);
 
+				if (Options.getUnicodeInput())
+					NfaState.unicodeWarningGiven = true;
+
 				Semanticize.start();
 				ParseGen.start();
 				LexGen.start();
 				OtherFilesGen.start();
+				GenerationStats.start();
 			}
+		}
+
+		// Parses the input with the Input production of MakeUpGrammar, and returns
+		// what the parser printed, or the exception that stopped it.
+		private const string ParseInputDriver =
+			"namespace Deveel.CSharpCC.Parser {\n" +
+			"  public static class Driver {\n" +
+			"    public static string Run(string input) {\n" +
+			"      System.IO.TextWriter console = System.Console.Out;\n" +
+			"      System.IO.StringWriter output = new System.IO.StringWriter();\n" +
+			"      System.Console.SetOut(output);\n" +
+			"      try {\n" +
+			"        new SimpleParser(new System.IO.StringReader(input)).Input();\n" +
+			"      } catch (System.Exception e) {\n" +
+			"        return e.ToString();\n" +
+			"      } finally {\n" +
+			"        System.Console.SetOut(console);\n" +
+			"      }\n" +
+			"      return output.ToString();\n" +
+			"    }\n" +
+			"  }\n" +
+			"}\n";
+
+		// The tokens read by a token manager of MakeUpCommentedListGrammar, with their
+		// positions and the comments before them.
+		private const string LexerInput =
+			"a (12 'x y') /* one\n two */ b;\n(c 'multi\nline' 345)\n/* (d */ e\n\n'' f7 ; ()\n" +
+			"/* a\n\n comment ' */ (g (h (i 'j;\n'))) ;\n" +
+			"k l m n\n'o\n\np' 6789 /**/ q\n" +
+			"(r) /* s */ /* t\n*/ u\n";
+
+		// Writes a token, and the special tokens before it, to a string builder.
+		private const string TokensDump =
+			"namespace Deveel.CSharpCC.Parser {\n" +
+			"  public static class Tokens {\n" +
+			"    public static void Dump(System.Text.StringBuilder sb, Token t) {\n" +
+			"      if (t.SpecialToken != null)\n" +
+			"        sb.Append('[').Append(t.SpecialToken.Image).Append(']');\n" +
+			"      sb.Append(t.Kind).Append(' ').Append(t.Image).Append('@').Append(t.BeginLine).Append(':').Append(t.BeginColumn);\n" +
+			"      sb.Append('-').Append(t.EndLine).Append(':').Append(t.EndColumn).Append('\\n');\n" +
+			"    }\n" +
+			"  }\n" +
+			"}\n";
+
+		// Reads all the tokens of the input with the token manager.
+		private const string TokensDriver =
+			"namespace Deveel.CSharpCC.Parser {\n" +
+			"  public static class Driver {\n" +
+			"    public static string Run(string input) {\n" +
+			"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+			"      SimpleParserTokenManager tm = new SimpleParserTokenManager(new SimpleCharStream(new System.IO.StringReader(input), 1, 1));\n" +
+			"      Token t;\n" +
+			"      do {\n" +
+			"        t = tm.GetNextToken();\n" +
+			"        Tokens.Dump(sb, t);\n" +
+			"      } while (t.Kind != SimpleParserConstants.EOF);\n" +
+			"      return sb.ToString();\n" +
+			"    }\n" +
+			"  }\n" +
+			"}\n";
+
+		// Parses each of the inputs separated by '\\0' with the Input production of
+		// MakeUpListGrammar, and returns "parsed" or the message of the error for each.
+		private const string ParseListDriver =
+			"namespace Deveel.CSharpCC.Parser {\n" +
+			"  public static class Driver {\n" +
+			"    public static string Run(string input) {\n" +
+			"      System.Text.StringBuilder sb = new System.Text.StringBuilder();\n" +
+			"      foreach (string part in input.Split('\\0')) {\n" +
+			"        try {\n" +
+			"          new SimpleParser(new System.IO.StringReader(part)).Input();\n" +
+			"          sb.Append(\"parsed\\n\");\n" +
+			"        } catch (ParseException e) {\n" +
+			"          sb.Append(e.Message).Append('\\n');\n" +
+			"        }\n" +
+			"      }\n" +
+			"      return sb.ToString();\n" +
+			"    }\n" +
+			"  }\n" +
+			"}\n";
+
+		// The commented input, and two inputs failing in a list and at the end.
+		private const string ParserInput = LexerInput + "\0a (b ; c)\0(a (b)";
+
+		// Generates the grammar with the default options, and returns what
+		// ParseListDriver returns for the input, to compare another generation with.
+		private string ParseWithDefaults(string grammar, string input) {
+			SetupOptions();
+			Generate(grammar);
+			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+
+			string result = RunDriver(ParseListDriver, input);
+			DeleteFiles();
+			return result;
+		}
 
+		// Generates the grammar with the default options, and returns the tokens read
+		// from the input as TokensDriver writes them, to compare another generation with.
+		private string LexWithDefaults(string grammar, string input) {
+			SetupOptions();
+			Generate(grammar);
 			Assert.AreEqual(0, CSharpCCErrors.ErrorCount);
+
+			string tokens = RunDriver(TokensDriver, TokensDump, input);
+			DeleteFiles();
+			return tokens;
+		}
+
+		// Compiles the files generated in the current directory with the given
+		// driver, and returns what its Driver.Run method returns for the input.
+		private string RunDriver(string driver, string input) {
+			return RunDriver(driver, null, input);
+		}
+
+		private string RunDriver(string driver, string helpers, string input) {
+			Assembly assembly = helpers == null ? CompileOutput(driver) : CompileOutput(driver, helpers);
+			MethodInfo run = assembly.GetType("Deveel.CSharpCC.Parser.Driver").GetMethod("Run");
+			return (string) run.Invoke(null, new object[] { input });
+		}
+
+		// Compiles in the language of the CLR_VERSION the files were generated for:
+		// C# 4 up to 4.5, and a language with the spans of the newer runtimes after.
+		private Assembly CompileOutput(params string[] sources) {
+			CSharpParseOptions parseOptions = new CSharpParseOptions(
+				Options.clrVersionAtLeast(7.0) ? LanguageVersion.CSharp11 : LanguageVersion.CSharp4);
+			List<SyntaxTree> trees = new List<SyntaxTree>();
+			foreach (string file in Directory.GetFiles(Environment.CurrentDirectory, "*.cs"))
+				trees.Add(CSharpSyntaxTree.ParseText(File.ReadAllText(file), parseOptions, file));
+			for (int i = 0; i < sources.Length; i++)
+				trees.Add(CSharpSyntaxTree.ParseText(sources[i], parseOptions, "Driver" + i + ".cs"));
+
+			CSharpCompilation compilation = CSharpCompilation.Create("Generated" + Guid.NewGuid().ToString("N"), trees,
+				GetFrameworkReferences(), new CSharpCompilationOptions(OutputKind.DynamicallyLinkedLibrary));
+			using (MemoryStream image = new MemoryStream()) {
+				EmitResult result = compilation.Emit(image);
+
+				StringBuilder errors = new StringBuilder();
+				foreach (Diagnostic diagnostic in result.Diagnostics) {
+					if (diagnostic.Severity == DiagnosticSeverity.Error)
+						errors.AppendLine(diagnostic.ToString());
+				}
+				if (errors.Length > 0)
+					Assert.Fail("The generated files do not compile:\n" + errors);
+
+				return Assembly.Load(image.ToArray());
+			}
+		}
+
+		// The assemblies of the framework the tests run on, with the spans of System.Memory.
+		private static List<MetadataReference> GetFrameworkReferences() {
+			List<MetadataReference> references = new List<MetadataReference>();
+			string platform = AppContext.GetData("TRUSTED_PLATFORM_ASSEMBLIES") as string;
+			if (platform != null) {
+				foreach (string file in platform.Split(Path.PathSeparator)) {
+					string name = Path.GetFileName(file);
+					if (name.StartsWith("System.") || name == "mscorlib.dll" || name == "netstandard.dll")
+						references.Add(MetadataReference.CreateFromFile(file));
+				}
+			} else {
+				references.Add(MetadataReference.CreateFromFile(typeof(object).Assembly.Location));
+				references.Add(MetadataReference.CreateFromFile(typeof(Uri).Assembly.Location));
+				references.Add(MetadataReference.CreateFromFile(typeof(ReadOnlySpan<>).Assembly.Location));
+				references.Add(MetadataReference.CreateFromFile(Assembly.Load("netstandard, Version=2.0.0.0, Culture=neutral, PublicKeyToken=cc7b13ffcd2ddd51").Location));
+			}
+			return references;
+		}
+
+		private static long CountLines(params string[] files) {
+			long lines = 0;
+			foreach (string file in files)
+				lines += File.ReadAllLines(Path.Combine(Environment.CurrentDirectory, file)).Length;
+			return lines;
 		}
 
 		private void SetupOptions() {
 			Options.SetCmdLineOption("STATIC=false");
 		}
 
+		// A grammar of nested lists, separated by semicolons.
+		private string MakeUpListGrammar() {
+			var sb = new StringBuilder();
+			sb.AppendLine("PARSER_BEGIN(SimpleParser)");
+			sb.AppendLine("namespace Deveel.CSharpCC.Parser;");
+			sb.AppendLine();
+			sb.AppendLine("using System;");
+			sb.AppendLine();
+			sb.AppendLine("public class SimpleParser {");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("PARSER_END(SimpleParser)");
+			sb.AppendLine();
+			sb.AppendLine("SKIP: {");
+			sb.AppendLine("\" \" | \"\\t\" | \"\\n\" | \"\\r\"");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("TOKEN: {");
+			sb.AppendLine("< LPAREN: \"(\" > |");
+			sb.AppendLine("< RPAREN: \")\" > |");
+			sb.AppendLine("< SEMICOLON: \";\" > |");
+			sb.AppendLine("< NUMBER: ([\"0\"-\"9\"])+ > |");
+			sb.AppendLine("< NAME: [\"a\"-\"z\"] ([\"a\"-\"z\", \"0\"-\"9\"])* > |");
+			sb.AppendLine("< STRING_LITERAL: \"'\" (~[\"'\"])* \"'\" >");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("void Input() :");
+			sb.AppendLine("{}");
+			sb.AppendLine("{");
+			sb.AppendLine("( Item() | <SEMICOLON> )* <EOF>");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("int Statement() :");
+			sb.AppendLine("{ int count = 0; }");
+			sb.AppendLine("{");
+			sb.AppendLine("( Item() { count++; } )+ <EOF>");
+			sb.AppendLine("{ return count; }");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("void Item() :");
+			sb.AppendLine("{}");
+			sb.AppendLine("{");
+			sb.AppendLine("<NUMBER> | <NAME> | <STRING_LITERAL> | List()");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("void List() :");
+			sb.AppendLine("{}");
+			sb.AppendLine("{");
+			sb.AppendLine("<LPAREN> ( Item() )* <RPAREN>");
+			sb.AppendLine("}");
+			return sb.ToString();
+		}
+
+		// The grammar of nested lists, with comments lexed in a state of their own.
+		private string MakeUpCommentedListGrammar() {
+			var sb = new StringBuilder(MakeUpListGrammar());
+			sb.AppendLine();
+			sb.AppendLine("MORE: {");
+			sb.AppendLine("\"/*\" : IN_COMMENT");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("<IN_COMMENT>");
+			sb.AppendLine("SPECIAL_TOKEN: {");
+			sb.AppendLine("< COMMENT: \"*/\" > : DEFAULT");
+			sb.AppendLine("}");
+			sb.AppendLine();
+			sb.AppendLine("<IN_COMMENT>");
+			sb.AppendLine("MORE: {");
+			sb.AppendLine("< ~[] >");
+			sb.AppendLine("}");
+			return sb.ToString();
+		}
+
 		private string MakeUpGrammar() {
 			var sb = new StringBuilder();
 			sb.AppendLine("PARSER_BEGIN(SimpleParser)");
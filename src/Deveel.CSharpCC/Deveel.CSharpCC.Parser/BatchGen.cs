@@ -0,0 +1,399 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+using Deveel.CSharpCC.Util;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the batch API of a parser, that splits a large input at the
+	/// statement separator tokens (option <c>STATEMENT_SEPARATOR</c>) and parses
+	/// the resulting chunks in parallel.
+	/// </summary>
+	public class BatchGen {
+		private static TextWriter ostr;
+
+		public static void start() {
+			if (CSharpCCErrors.ErrorCount != 0)
+				throw new MetaParseException();
+
+			IList<RegularExpression> separators = GetSeparators();
+			if (separators.Count == 0 || !CanGenerate())
+				return;
+
+			string className = CSharpCCGlobals.cu_name + "Batch";
+			string parserName = CSharpCCGlobals.cu_name;
+			string tokMgrName = CSharpCCGlobals.cu_name + "TokenManager";
+			string constantsName = CSharpCCGlobals.cu_name + "Constants";
+
+			try {
+				ostr =
+					new StreamWriter(new GeneratedFileStream(Path.Combine(Options.getOutputDirectory().FullName, className + ".cs")));
+			} catch (IOException) {
+				CSharpCCErrors.SemanticError("Could not open file " + className + ".cs for writing.");
+				throw new InvalidOperationException();
+			}
+
+			List<string> tn = new List<string>(CSharpCCGlobals.ToolNames);
+			tn.Add(CSharpCCGlobals.ToolName);
+			ostr.WriteLine("/* " + CSharpCCGlobals.GetIdString(tn, className + ".cs") + " */");
+
+			bool namespaceInserted = false;
+			if (CSharpCCGlobals.cu_to_insertion_point_1.Count != 0 &&
+			    CSharpCCGlobals.cu_to_insertion_point_1[0].kind == CSharpCCParserConstants.NAMESPACE) {
+				Token t = null;
+				for (int i = 1; i < CSharpCCGlobals.cu_to_insertion_point_1.Count; i++) {
+					if (CSharpCCGlobals.cu_to_insertion_point_1[i].kind == CSharpCCParserConstants.SEMICOLON) {
+						CSharpCCGlobals.PrintTokenSetup(CSharpCCGlobals.cu_to_insertion_point_1[0]);
+						for (int j = 0; j <= i; j++) {
+							t = CSharpCCGlobals.cu_to_insertion_point_1[j];
+							if (t.kind != CSharpCCParserConstants.SEMICOLON)
+								CSharpCCGlobals.PrintToken(t, ostr);
+						}
+						CSharpCCGlobals.PrintTrailingComments(t, ostr);
+						namespaceInserted = true;
+						ostr.WriteLine("{");
+						break;
+					}
+				}
+			}
+
+			ostr.WriteLine("");
+			ostr.WriteLine("/// <summary>");
+			ostr.WriteLine("/// Parses a large input made of independent statements in parallel.");
+			ostr.WriteLine("/// </summary>");
+			ostr.WriteLine("/// <remarks>");
+			ostr.WriteLine("/// The input is first scanned with the token manager to find the statement");
+			ostr.WriteLine("/// separators out of any bracket, string or comment; each chunk between two");
+			ostr.WriteLine("/// separators is then parsed by a parser taken from a pool, and the results");
+			ostr.WriteLine("/// are returned in input order.");
+			ostr.WriteLine("/// </remarks>");
+			if (Options.getSupportClassVisibilityPublic()) {
+				ostr.Write("public ");
+			}
+			ostr.WriteLine("class " + className + " {");
+			ostr.Write("  private static readonly int[] separatorKinds = { ");
+			for (int i = 0; i < separators.Count; i++) {
+				if (i > 0)
+					ostr.Write(", ");
+				ostr.Write(constantsName + "." + separators[i].Label);
+			}
+			ostr.WriteLine(" };");
+			ostr.WriteLine("  private static readonly int[] openKinds = { " + GetBracketKinds("([{") + " };");
+			ostr.WriteLine("  private static readonly int[] closeKinds = { " + GetBracketKinds(")]}") + " };");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private readonly int degreeOfParallelism;");
+			ostr.WriteLine("  private readonly System.Collections.Generic.Stack<Worker> pool = new System.Collections.Generic.Stack<Worker>();");
+			ostr.WriteLine("");
+			ostr.WriteLine("  public " + className + "()");
+			ostr.WriteLine("    : this(System.Environment.ProcessorCount) {");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  public " + className + "(int degreeOfParallelism) {");
+			ostr.WriteLine("    if (degreeOfParallelism <= 0)");
+			ostr.WriteLine("      throw new System.ArgumentOutOfRangeException(\"degreeOfParallelism\");");
+			ostr.WriteLine("    this.degreeOfParallelism = degreeOfParallelism;");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>A statement of the input, between two separators.</summary>");
+			ostr.WriteLine("  public sealed class Chunk {");
+			ostr.WriteLine("    internal Chunk(int index, int offset, int length, int beginLine, int beginColumn, int lexicalState) {");
+			ostr.WriteLine("      Index = index;");
+			ostr.WriteLine("      Offset = offset;");
+			ostr.WriteLine("      Length = length;");
+			ostr.WriteLine("      BeginLine = beginLine;");
+			ostr.WriteLine("      BeginColumn = beginColumn;");
+			ostr.WriteLine("      LexicalState = lexicalState;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public int Index { get; private set; }");
+			ostr.WriteLine("    public int Offset { get; private set; }");
+			ostr.WriteLine("    public int Length { get; private set; }");
+			ostr.WriteLine("    public int BeginLine { get; private set; }");
+			ostr.WriteLine("    public int BeginColumn { get; private set; }");
+			ostr.WriteLine("    public int LexicalState { get; private set; }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>The outcome of parsing a chunk: a value or an error.</summary>");
+			ostr.WriteLine("  public sealed class Result<TResult> {");
+			ostr.WriteLine("    internal Result(Chunk chunk) {");
+			ostr.WriteLine("      Chunk = chunk;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public Chunk Chunk { get; private set; }");
+			ostr.WriteLine("    public TResult Value { get; internal set; }");
+			ostr.WriteLine("    public System.Exception Error { get; internal set; }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>");
+			ostr.WriteLine("  /// Scans the input with the token manager and splits it at the statement separators");
+			ostr.WriteLine("  /// out of any bracket: those in a string or a comment are in a token of their own.");
+			ostr.WriteLine("  /// Chunks holding no tokens are dropped.");
+			ostr.WriteLine("  /// </summary>");
+			ostr.WriteLine("  public static System.Collections.Generic.IList<Chunk> Split(string text) {");
+			ostr.WriteLine("    if (text == null)");
+			ostr.WriteLine("      throw new System.ArgumentNullException(\"text\");");
+			ostr.WriteLine("");
+			ostr.WriteLine("    System.Collections.Generic.List<Chunk> chunks = new System.Collections.Generic.List<Chunk>();");
+			ostr.WriteLine("    SimpleCharStream stream = new SimpleCharStream(new System.IO.StringReader(text), 1, 1);");
+			ostr.WriteLine("    " + tokMgrName + " tm = new " + tokMgrName + "(stream);");
+			ostr.WriteLine("    int start = 0, line = 1, column = 1, state = tm.LexicalState, depth = 0;");
+			ostr.WriteLine("    bool empty = true;");
+			ostr.WriteLine("    for (;;) {");
+			ostr.WriteLine("      Token t = tm.GetNextToken();");
+			ostr.WriteLine("      if (t.Kind == " + constantsName + ".EOF) {");
+			ostr.WriteLine("        if (!empty)");
+			ostr.WriteLine("          chunks.Add(new Chunk(chunks.Count, start, text.Length - start, line, column, state));");
+			ostr.WriteLine("        return chunks;");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("      if (System.Array.IndexOf(openKinds, t.Kind) >= 0)");
+			ostr.WriteLine("        depth++;");
+			ostr.WriteLine("      else if (depth > 0 && System.Array.IndexOf(closeKinds, t.Kind) >= 0)");
+			ostr.WriteLine("        depth--;");
+			ostr.WriteLine("      if (depth > 0 || System.Array.IndexOf(separatorKinds, t.Kind) < 0) {");
+			ostr.WriteLine("        empty = false;");
+			ostr.WriteLine("        continue;");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("      if (!empty)");
+			ostr.WriteLine("        chunks.Add(new Chunk(chunks.Count, start, stream.BeginOffset - start, line, column, state));");
+			ostr.WriteLine("");
+			ostr.WriteLine("      // The next chunk starts right after the separator: mirror the way");
+			ostr.WriteLine("      // SimpleCharStream counts lines to find its position.");
+			ostr.WriteLine("      start = stream.EndOffset;");
+			ostr.WriteLine("      char last = text[start - 1];");
+			ostr.WriteLine("      if (last == '\\n' || (last == '\\r' && (start == text.Length || text[start] != '\\n'))) {");
+			ostr.WriteLine("        line = t.EndLine + 1;");
+			ostr.WriteLine("        column = 1;");
+			ostr.WriteLine("      } else {");
+			ostr.WriteLine("        line = t.EndLine;");
+			ostr.WriteLine("        column = t.EndColumn + 1;");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("      state = tm.LexicalState;");
+			ostr.WriteLine("      empty = true;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>");
+			ostr.WriteLine("  /// Splits the input and parses every chunk in parallel, calling <paramref name=\"parse\"/>");
+			ostr.WriteLine("  /// on a parser positioned at the start of the chunk.");
+			ostr.WriteLine("  /// </summary>");
+			ostr.WriteLine("  /// <returns>The results of the chunks, in input order, as soon as they are available.</returns>");
+			ostr.WriteLine("  public System.Collections.Generic.IEnumerable<Result<TResult>> Parse<TResult>(string text, System.Converter<" +
+			               parserName + ", TResult> parse) {");
+			ostr.WriteLine("    return Parse(text, Split(text), parse);");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>");
+			ostr.WriteLine("  /// Parses in parallel the given chunks of the input.");
+			ostr.WriteLine("  /// </summary>");
+			ostr.WriteLine("  public System.Collections.Generic.IEnumerable<Result<TResult>> Parse<TResult>(string text, " +
+			               "System.Collections.Generic.IList<Chunk> chunks, System.Converter<" + parserName + ", TResult> parse) {");
+			ostr.WriteLine("    if (text == null)");
+			ostr.WriteLine("      throw new System.ArgumentNullException(\"text\");");
+			ostr.WriteLine("    if (chunks == null)");
+			ostr.WriteLine("      throw new System.ArgumentNullException(\"chunks\");");
+			ostr.WriteLine("    if (parse == null)");
+			ostr.WriteLine("      throw new System.ArgumentNullException(\"parse\");");
+			ostr.WriteLine("");
+			ostr.WriteLine("    return Deliver(new Run<TResult>(this, text, chunks, parse));");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private static System.Collections.Generic.IEnumerable<Result<TResult>> Deliver<TResult>(Run<TResult> run) {");
+			ostr.WriteLine("    run.Start();");
+			ostr.WriteLine("    try {");
+			ostr.WriteLine("      for (int i = 0; i < run.Count; i++)");
+			ostr.WriteLine("        yield return run.Take(i);");
+			ostr.WriteLine("    } finally {");
+			ostr.WriteLine("      run.Cancel();");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private Worker Rent() {");
+			ostr.WriteLine("    lock (pool) {");
+			ostr.WriteLine("      if (pool.Count > 0)");
+			ostr.WriteLine("        return pool.Pop();");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("    return new Worker();");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private void Return(Worker worker) {");
+			ostr.WriteLine("    lock (pool) {");
+			ostr.WriteLine("      pool.Push(worker);");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private sealed class Worker {");
+			ostr.WriteLine("    private readonly SimpleCharStream stream = new SimpleCharStream(new System.IO.StringReader(\"\"), 1, 1);");
+			ostr.WriteLine("    private readonly " + tokMgrName + " tokenManager;");
+			ostr.WriteLine("    private readonly " + parserName + " parser;");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public Worker() {");
+			ostr.WriteLine("      tokenManager = new " + tokMgrName + "(stream);");
+			ostr.WriteLine("      parser = new " + parserName + "(tokenManager);");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public " + parserName + " Reset(string text, Chunk chunk) {");
+			ostr.WriteLine("      stream.ReInit(new System.IO.StringReader(text.Substring(chunk.Offset, chunk.Length)), chunk.BeginLine, chunk.BeginColumn);");
+			ostr.WriteLine("      tokenManager.ReInit(stream, chunk.LexicalState);");
+			ostr.WriteLine("      parser.ReInit(tokenManager);");
+			ostr.WriteLine("      return parser;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private sealed class Run<TResult> {");
+			ostr.WriteLine("    private readonly " + className + " batch;");
+			ostr.WriteLine("    private readonly string text;");
+			ostr.WriteLine("    private readonly System.Collections.Generic.IList<Chunk> chunks;");
+			ostr.WriteLine("    private readonly System.Converter<" + parserName + ", TResult> parse;");
+			ostr.WriteLine("    private readonly Result<TResult>[] results;");
+			ostr.WriteLine("    private readonly object sync = new object();");
+			ostr.WriteLine("    private readonly int window;");
+			ostr.WriteLine("    private int next;");
+			ostr.WriteLine("    private int delivered;");
+			ostr.WriteLine("    private bool cancelled;");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public Run(" + className + " batch, string text, System.Collections.Generic.IList<Chunk> chunks, " +
+			               "System.Converter<" + parserName + ", TResult> parse) {");
+			ostr.WriteLine("      this.batch = batch;");
+			ostr.WriteLine("      this.text = text;");
+			ostr.WriteLine("      this.chunks = chunks;");
+			ostr.WriteLine("      this.parse = parse;");
+			ostr.WriteLine("      results = new Result<TResult>[chunks.Count];");
+			ostr.WriteLine("      // Bounds the number of results waiting to be delivered.");
+			ostr.WriteLine("      window = batch.degreeOfParallelism * 4;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public int Count {");
+			ostr.WriteLine("      get { return chunks.Count; }");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public void Start() {");
+			ostr.WriteLine("      int threads = System.Math.Min(batch.degreeOfParallelism, chunks.Count);");
+			ostr.WriteLine("      for (int i = 0; i < threads; i++) {");
+			ostr.WriteLine("        System.Threading.Thread thread = new System.Threading.Thread(new System.Threading.ThreadStart(Work));");
+			ostr.WriteLine("        thread.IsBackground = true;");
+			ostr.WriteLine("        thread.Start();");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    private void Work() {");
+			ostr.WriteLine("      Worker worker = batch.Rent();");
+			ostr.WriteLine("      try {");
+			ostr.WriteLine("        for (;;) {");
+			ostr.WriteLine("          int index;");
+			ostr.WriteLine("          lock (sync) {");
+			ostr.WriteLine("            while (!cancelled && next < chunks.Count && next - delivered >= window)");
+			ostr.WriteLine("              System.Threading.Monitor.Wait(sync);");
+			ostr.WriteLine("            if (cancelled || next >= chunks.Count)");
+			ostr.WriteLine("              return;");
+			ostr.WriteLine("            index = next++;");
+			ostr.WriteLine("          }");
+			ostr.WriteLine("");
+			ostr.WriteLine("          Result<TResult> result = new Result<TResult>(chunks[index]);");
+			ostr.WriteLine("          try {");
+			ostr.WriteLine("            result.Value = parse(worker.Reset(text, chunks[index]));");
+			ostr.WriteLine("          } catch (System.Exception e) {");
+			ostr.WriteLine("            result.Error = e;");
+			ostr.WriteLine("          }");
+			ostr.WriteLine("");
+			ostr.WriteLine("          lock (sync) {");
+			ostr.WriteLine("            results[index] = result;");
+			ostr.WriteLine("            System.Threading.Monitor.PulseAll(sync);");
+			ostr.WriteLine("          }");
+			ostr.WriteLine("        }");
+			ostr.WriteLine("      } finally {");
+			ostr.WriteLine("        batch.Return(worker);");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public Result<TResult> Take(int index) {");
+			ostr.WriteLine("      lock (sync) {");
+			ostr.WriteLine("        while (results[index] == null)");
+			ostr.WriteLine("          System.Threading.Monitor.Wait(sync);");
+			ostr.WriteLine("        Result<TResult> result = results[index];");
+			ostr.WriteLine("        results[index] = null;");
+			ostr.WriteLine("        delivered = index + 1;");
+			ostr.WriteLine("        System.Threading.Monitor.PulseAll(sync);");
+			ostr.WriteLine("        return result;");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public void Cancel() {");
+			ostr.WriteLine("      lock (sync) {");
+			ostr.WriteLine("        cancelled = true;");
+			ostr.WriteLine("        System.Threading.Monitor.PulseAll(sync);");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("}");
+			if (namespaceInserted)
+				ostr.WriteLine("}");
+			ostr.Close();
+		}
+
+		private static IList<RegularExpression> GetSeparators() {
+			List<RegularExpression> separators = new List<RegularExpression>();
+			foreach (string name in Options.getStatementSeparator().Split(',')) {
+				string label = name.Trim();
+				if (label.Length == 0)
+					continue;
+
+				RegularExpression re;
+				if (!CSharpCCGlobals.named_tokens_table.TryGetValue(label, out re) || re.IsPrivate) {
+					CSharpCCErrors.Warning("Statement separator \"" + label + "\" is not a token label and will be ignored.");
+				} else if (re.TokenProductionContext.Kind != TokenProduction.TOKEN) {
+					CSharpCCErrors.Warning(re, "Statement separator \"" + label + "\" is not a regular token and will be ignored.");
+				} else {
+					separators.Add(re);
+				}
+			}
+
+			return separators;
+		}
+
+		// The kinds of the regular tokens whose image is one of the given brackets.
+		private static string GetBracketKinds(string brackets) {
+			List<int> kinds = new List<int>();
+			foreach (KeyValuePair<int, RegularExpression> entry in CSharpCCGlobals.rexps_of_tokens) {
+				RStringLiteral literal = entry.Value as RStringLiteral;
+				if (literal != null && literal.Image.Length == 1 && brackets.IndexOf(literal.Image[0]) >= 0 &&
+				    literal.TokenProductionContext.Kind == TokenProduction.TOKEN)
+					kinds.Add(entry.Key);
+			}
+
+			kinds.Sort();
+			string[] values = new string[kinds.Count];
+			for (int i = 0; i < kinds.Count; i++)
+				values[i] = kinds[i].ToString();
+			return String.Join(", ", values);
+		}
+
+		private static bool CanGenerate() {
+			string reason = null;
+			if (Options.getStatic()) {
+				reason = "STATIC is set to true";
+			} else if (!Options.getBuildParser() || !Options.getBuildTokenManager()) {
+				reason = "the parser or the token manager is not generated";
+			} else if (Options.getUserTokenManager() || Options.getUserCharStream() || Options.getUnicodeEscape()) {
+				reason = "the batch API requires the generated token manager and SimpleCharStream";
+			} else if (Options.getTokenManagerUsesParser()) {
+				reason = "TOKEN_MANAGER_USES_PARSER is set to true";
+			} else if (!Options.getKeepLineColumn()) {
+				reason = "KEEP_LINE_COLUMN is set to false";
+			} else if (EventSinkGen.Enabled) {
+				reason = "the parser is generic on its event sink";
+			}
+
+			if (reason != null) {
+				CSharpCCErrors.Warning("Option STATEMENT_SEPARATOR is ignored since " + reason + ".");
+				return false;
+			}
+
+			return true;
+		}
+
+		public static void reInit() {
+			ostr = null;
+		}
+	}
+}
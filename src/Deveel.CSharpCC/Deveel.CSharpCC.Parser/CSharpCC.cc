@@ -36,6 +36,7 @@
 
 options {
   CSHARP_UNICODE_ESCAPE = true;
+  UNICODE_INPUT = true;
   STATIC=false;
 }
 
@@ -85,6 +86,7 @@ public class CSharpCCParser {
      public const int VOLATILE = 0x0200;
 	 public const int VIRTUAL = 0x0400;
 	 public const int SEALED = 0x0800;
+	 public const int CONST = 0x1000;
 
      public bool isPublic(int modifiers)
      {
@@ -369,6 +371,8 @@ TOKEN :
             ( ["n","t","b","r","f","\\","'","\""]
             | ["0"-"7"] ( ["0"-"7"] )?
             | ["0"-"3"] ["0"-"7"] ["0"-"7"]
+            | "u" ["0"-"9","a"-"f","A"-"F"] ["0"-"9","a"-"f","A"-"F"]
+                  ["0"-"9","a"-"f","A"-"F"] ["0"-"9","a"-"f","A"-"F"]
             )
           )
       )
@@ -382,6 +386,8 @@ TOKEN :
             ( ["n","t","b","r","f","\\","'","\""]
             | ["0"-"7"] ( ["0"-"7"] )?
             | ["0"-"3"] ["0"-"7"] ["0"-"7"]
+            | "u" ["0"-"9","a"-"f","A"-"F"] ["0"-"9","a"-"f","A"-"F"]
+                  ["0"-"9","a"-"f","A"-"F"] ["0"-"9","a"-"f","A"-"F"]
             )
           )
       )*
@@ -1414,6 +1420,8 @@ int Modifiers():
 	  "sealed" { modifiers |= ModifierSet.SEALED; }
   |
 	  "override"
+  |
+   "const" { modifiers |= ModifierSet.CONST; }
   |
    Annotation()
   )
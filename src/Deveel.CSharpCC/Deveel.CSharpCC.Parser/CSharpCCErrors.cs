@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Collections.Generic;
 
 namespace Deveel.CSharpCC.Parser {
     public static class CSharpCCErrors {
@@ -6,27 +7,64 @@ namespace Deveel.CSharpCC.Parser {
         private static int parseErrorCount;
         private static int semanticErrorCount;
 
-        private static void PrintLocationInfo(object node) {
+        /// <summary>
+        /// An error or a warning, with the place in the grammar it is about.
+        /// </summary>
+        public sealed class Message {
+            public Message(bool isError, int line, int column, string text) {
+                IsError = isError;
+                Line = line;
+                Column = column;
+                Text = text;
+            }
+
+            public bool IsError { get; private set; }
+
+            /// <summary>
+            /// The line of the grammar, or 0 if the message is about no place in it.
+            /// </summary>
+            public int Line { get; private set; }
+
+            public int Column { get; private set; }
+
+            public string Text { get; private set; }
+        }
+
+        /// <summary>
+        /// When set, the errors and the warnings are also added to this list, for a
+        /// generation that runs inside another process.
+        /// </summary>
+        public static IList<Message> Capture { get; set; }
+
+        private static void Report(bool isError, Object node, String mess) {
+            int line = 0;
+            int column = 0;
             if (node is ILocationInfo) {
                 var locationInfo = (ILocationInfo) node;
-                Console.Error.Write("Line {0}, Column {1}: ", locationInfo.Line, locationInfo.Column);
+                line = locationInfo.Line;
+                column = locationInfo.Column;
             } else if (node is Token) {
                 var t = (Token) node;
-                Console.Error.Write("Line {0}, Column {1}: ", t.beginLine, t.beginColumn);
+                line = t.beginLine;
+                column = t.beginColumn;
             }
-        }
 
+            Console.Error.Write(isError ? "Error: " : "Warning: ");
+            if (node is ILocationInfo || node is Token)
+                Console.Error.Write("Line {0}, Column {1}: ", line, column);
+            Console.Error.WriteLine(mess);
+
+            if (Capture != null)
+                Capture.Add(new Message(isError, line, column, mess));
+        }
 
         public static void ParseError(Object node, String mess) {
-            Console.Error.Write("Error: ");
-            PrintLocationInfo(node);
-            Console.Error.WriteLine(mess);
+            Report(true, node, mess);
             parseErrorCount++;
         }
 
         public static void ParseError(String mess) {
-            Console.Error.Write("Error: ");
-            Console.Error.WriteLine(mess);
+            Report(true, null, mess);
             parseErrorCount++;
         }
 
@@ -35,15 +73,12 @@ namespace Deveel.CSharpCC.Parser {
         }
 
         public static void SemanticError(Object node, String mess) {
-            Console.Error.Write("Error: ");
-            PrintLocationInfo(node);
-            Console.Error.WriteLine(mess);
+            Report(true, node, mess);
             semanticErrorCount++;
         }
 
         public static void SemanticError(String mess) {
-            Console.Error.Write("Error: ");
-            Console.Error.WriteLine(mess);
+            Report(true, null, mess);
             semanticErrorCount++;
         }
 
@@ -52,15 +87,12 @@ namespace Deveel.CSharpCC.Parser {
         }
 
         public static void Warning(Object node, String mess) {
-            Console.Error.Write("Warning: ");
-            PrintLocationInfo(node);
-            Console.Error.WriteLine(mess);
+            Report(false, node, mess);
             warningCount++;
         }
 
         public static void Warning(String mess) {
-            Console.Error.Write("Warning: ");
-            Console.Error.WriteLine(mess);
+            Report(false, null, mess);
             warningCount++;
         }
 
@@ -206,7 +206,7 @@ namespace Deveel.CSharpCC.Parser {
                     retval += "\\\\";
                 } else if (ch < 0x20 || ch > 0x7e) {
                     String s = "0000" + Convert.ToString(ch, 16);
-                    retval += "\\u" + s.Substring(s.Length - 4, s.Length);
+                    retval += "\\u" + s.Substring(s.Length - 4);
                 } else {
                     retval += ch;
                 }
@@ -219,9 +219,9 @@ namespace Deveel.CSharpCC.Parser {
             char ch;
             for (int i = 0; i < str.Length; i++) {
                 ch = str[i];
-                if (ch < 0x20 || ch > 0x7e || ch == '\\') {
+                if (ch < 0x20 || ch > 0x7e) {
                     String s = "0000" + Convert.ToString(ch, 16);
-                    retval += "\\u" + s.Substring(s.Length - 4, s.Length);
+                    retval += "\\u" + s.Substring(s.Length - 4);
                 } else {
                     retval += ch;
                 }
@@ -303,71 +303,7 @@ namespace Deveel.CSharpCC.Parser {
         internal static void PrintTrailingComments(Token t, TextWriter ostr) {
             if (t.next == null)
                 return;
-            PrintLeadingComments(t.next);
-        }
-
-        internal static string PrintTokenOnly(Token t) {
-            String retval = "";
-            for (; cline < t.beginLine; cline++) {
-                retval += "\n";
-                ccol = 1;
-            }
-            for (; ccol < t.beginColumn; ccol++) {
-                retval += " ";
-            }
-            if (t.kind == CSharpCCParserConstants.STRING_LITERAL ||
-                t.kind == CSharpCCParserConstants.CHARACTER_LITERAL)
-                retval += AddUnicodeEscapes(t.image);
-            else
-                retval += t.image;
-            cline = t.endLine;
-            ccol = t.endColumn + 1;
-            char last = t.image[t.image.Length - 1];
-            if (last == '\n' || last == '\r') {
-                cline++;
-                ccol = 1;
-            }
-            return retval;
-        }
-
-        internal static String PrintToken(Token t) {
-            String retval = "";
-            Token tt = t.specialToken;
-            if (tt != null) {
-                while (tt.specialToken != null)
-                    tt = tt.specialToken;
-                while (tt != null) {
-                    retval += PrintTokenOnly(tt);
-                    tt = tt.next;
-                }
-            }
-            retval += PrintTokenOnly(t);
-            return retval;
-        }
-
-        internal static String PrintLeadingComments(Token t) {
-            String retval = "";
-            if (t.specialToken == null)
-                return retval;
-            Token tt = t.specialToken;
-            while (tt.specialToken != null)
-                tt = tt.specialToken;
-            while (tt != null) {
-                retval += PrintTokenOnly(tt);
-                tt = tt.next;
-            }
-            if (ccol != 1 && cline != t.beginLine) {
-                retval += "\n";
-                cline++;
-                ccol = 1;
-            }
-            return retval;
-        }
-
-        internal static String PrintTrailingComments(Token t) {
-            if (t.next == null)
-                return "";
-            return PrintLeadingComments(t.next);
+            PrintLeadingComments(t.next, ostr);
         }
 
         public static void ReInit() {
@@ -400,8 +336,51 @@ namespace Deveel.CSharpCC.Parser {
             nextStateForEof = null;
         }
 
+        /// <summary>
+        /// Resets the static state of the whole generator, before a grammar is
+        /// generated again in the same process.
+        /// </summary>
+        public static void ReInitAll() {
+            Expansion.reInit();
+            CSharpCCErrors.ReInit();
+            ReInit();
+            Options.init();
+            CSharpCCParserInternals.reInit();
+            RStringLiteral.reInit();
+            // CSharpFiles.reInit();
+            LexGen.reInit();
+            NfaState.reInit();
+            MatchInfo.reInit();
+            LookaheadWalk.reInit();
+            Semanticize.reInit();
+            ParseGen.reInit();
+            OtherFilesGen.reInit();
+            BatchGen.reInit();
+            TokenizerGen.reInit();
+            InstrumentGen.reInit();
+            LookaheadProfileGen.reInit();
+            ProfileGen.reInit();
+            KeywordGen.reInit();
+            TreeGen.reInit();
+            EventSinkGen.reInit();
+            GenerationCache.reInit();
+            GenerationStats.reInit();
+            ParseEngine.reInit();
+        }
+
 	    public static string staticOpt() {
 	        return Options.getStatic() ? "static " : "";
 	    }
+
+	    /// <summary>
+	    /// Declares a constant table of the generated code, up to its initializer:
+	    /// from CLR 7.0 the table is a span over data mapped from the assembly
+	    /// image, that costs nothing to initialize.
+	    /// </summary>
+	    public static string TableDeclaration(string modifiers, string elementType, string name) {
+	        if (Options.clrVersionAtLeast(7.0))
+	            return modifiers + " System.ReadOnlySpan<" + elementType + "> " + name + " => new " + elementType + "[] ";
+	        return modifiers + " readonly " + elementType + "[] " + name + " = ";
+	    }
 	}
 }
\ No newline at end of file
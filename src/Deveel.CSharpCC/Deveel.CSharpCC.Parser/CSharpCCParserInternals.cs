@@ -233,6 +233,7 @@ namespace Deveel.CSharpCC.Parser {
 								if (hexchar(ch)) {
 									ordinal = ordinal*16 + hexval(ch);
 									index++;
+									retval += (char) ordinal;
 									continue;
 								}
 							}
@@ -84,10 +84,23 @@ namespace Deveel.CSharpCC.Parser {
 			GenerateFile(fileName, templateName, Options.getOptions(), optionNames);
 		}
 
+		// The option names are those the template branches on, recorded in the header
+		// of the file: an existing file made with other values is rebuilt.
 		private static void GenerateFile(string fileName, string templateName, IDictionary<string, object> options, string[] optionNames) {
+			GenerateFile(fileName, templateName, options, optionNames, false);
+		}
+
+		// The classes made from the grammar, named after the parser, are rebuilt at
+		// every generation as the parser is.
+		private static void GenerateGrammarFile(string fileName, string templateName, IDictionary<string, object> options, string[] optionNames) {
+			GenerateFile(fileName, templateName, options, optionNames, true);
+		}
+
+		private static void GenerateFile(string fileName, string templateName, IDictionary<string, object> options, string[] optionNames, bool rebuild) {
 			try {
 				string file = Path.Combine(Options.getOutputDirectory().FullName, fileName);
-				OutputFile outputFile = new OutputFile(file, typeof(CSharpFiles).Assembly.GetName().Version.ToString(), optionNames);
+				OutputFile outputFile = new OutputFile(file, typeof(CSharpFiles).Assembly.GetName().Version.ToString(), optionNames,
+				                                       options, rebuild);
 
 				if (!outputFile.needToWrite) {
 					return;
@@ -142,19 +155,64 @@ namespace Deveel.CSharpCC.Parser {
 		}
 
 		public static void GenerateToken() {
-			GenerateFile("Token.cs", "Deveel.CSharpCC.Templates.Token-2.0.template", new String[] {"TOKEN_EXTENDS", "KEEP_LINE_COLUMN", "SUPPORT_CLASS_VISIBILITY_PUBLIC"});
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["TYPED_VALUES"] = LexGen.typedValues;
+
+			GenerateFile("Token.cs", "Deveel.CSharpCC.Templates.Token-2.0.template", options,
+			             new String[] { "TOKEN_EXTENDS", "KEEP_LINE_COLUMN", "SUPPORT_CLASS_VISIBILITY_PUBLIC", "TYPED_VALUES" });
 		}
 
 		public static void GenerateITokenManager() {
 			GenerateFile("ITokenManager.cs", "Deveel.CSharpCC.Templates.ITokenManager.template", new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
 		}
 
+		public static void GenerateTokenRing() {
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["DISPATCH_INFO"] = Options.clrVersionAtLeast(4.5);
+
+			GenerateFile("TokenRing.cs", "Deveel.CSharpCC.Templates.TokenRing.template", options,
+			             new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC", "DISPATCH_INFO" });
+		}
+
+		public static void GenerateNameTable() {
+			GenerateFile("NameTable.cs", "Deveel.CSharpCC.Templates.NameTable.template", new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+		}
+
+		public static void GenerateEventSource(string fileName, IDictionary<string, object> options) {
+			GenerateGrammarFile(fileName, "Deveel.CSharpCC.Templates.EventSource.template", options, new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+		}
+
+		public static void GenerateLookaheadProfile(string fileName, IDictionary<string, object> options) {
+			GenerateGrammarFile(fileName, "Deveel.CSharpCC.Templates.LookaheadProfile.template", options, new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+		}
+
+		public static void GenerateParseTree(string fileName, IDictionary<string, object> options) {
+			GenerateGrammarFile(fileName, "Deveel.CSharpCC.Templates.ParseTree.template", options, new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+		}
+
+		public static void GenerateEventSink(string fileName, IDictionary<string, object> options) {
+			GenerateGrammarFile(fileName, "Deveel.CSharpCC.Templates.EventSink.template", options, new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+		}
+
+		public static void GenerateProfile(string fileName, IDictionary<string, object> options) {
+			GenerateGrammarFile(fileName, "Deveel.CSharpCC.Templates.Profile.template", options, new String[] { "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+		}
+
 		public static void GenerateSimpleCharStream() {
 			string prefix = (Options.getStatic() ? "static " : "");
 			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
 			options["PREFIX"] = prefix;
-
-			GenerateFile("SimpleCharStream.cs", "Deveel.CSharpCC.Templates.SimpleCharStream.template", options, new String[] { "STATIC", "SUPPORT_CLASS_VISIBILITY_PUBLIC" });
+			options["TRACK_OFFSETS"] = Options.getStatementSeparator().Length > 0 || Options.getParallelTokenizer() ||
+			                           Options.getTokenKindScanner() || InstrumentGen.Enabled;
+			options["INTERN_IMAGES"] = LexGen.internImages;
+			options["KEYWORD_HASH"] = KeywordGen.HasKeywords;
+			options["TYPED_VALUES"] = LexGen.typedValues;
+
+			GenerateFile("SimpleCharStream.cs", "Deveel.CSharpCC.Templates.SimpleCharStream.template", options,
+			             new String[] {
+			             	"STATIC", "SUPPORT_CLASS_VISIBILITY_PUBLIC", "KEEP_LINE_COLUMN", "GENERATE_ANNOTATIONS",
+			             	"TRACK_OFFSETS", "INTERN_IMAGES", "KEYWORD_HASH", "TYPED_VALUES"
+			             });
 		}
 
 		public static void GenerateUnicodeCharStream() {
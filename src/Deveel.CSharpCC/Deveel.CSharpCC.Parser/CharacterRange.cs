@@ -1,7 +1,7 @@
 ﻿using System;
 
 namespace Deveel.CSharpCC.Parser {
-	public class CharacterRange {
+	public class CharacterRange : ILocationInfo {
 		public CharacterRange(char left, char right) {
 			if (left > right)
 				CSharpCCErrors.SemanticError(this,
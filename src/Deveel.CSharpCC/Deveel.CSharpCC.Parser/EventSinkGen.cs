@@ -0,0 +1,122 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the event sink of a parser (option <c>EVENT_SINK</c>): the parser is
+	/// generic on a structure receiving the entry and the exit of every production and
+	/// every token consumed, and keeps no token the lookahead does not need.
+	/// </summary>
+	public class EventSinkGen {
+		private static bool? enabled;
+
+		/// <summary>
+		/// Whether the parser calls an event sink: warns the first time if the option
+		/// is set but cannot be honored.
+		/// </summary>
+		public static bool Enabled {
+			get {
+				if (enabled == null)
+					enabled = CanCallSink();
+				return enabled.Value;
+			}
+		}
+
+		/// <summary>
+		/// The name of the generated interface of the sinks.
+		/// </summary>
+		public static string InterfaceName {
+			get { return "I" + CSharpCCGlobals.cu_name + "EventSink"; }
+		}
+
+		/// <summary>
+		/// The name of the generated class of the production identifiers.
+		/// </summary>
+		public static string ProductionsClassName {
+			get { return CSharpCCGlobals.cu_name + "Productions"; }
+		}
+
+		/// <summary>
+		/// The type parameter of the parser class, constrained to a structure
+		/// implementing <see cref="InterfaceName"/>.
+		/// </summary>
+		public const string TypeParameter = "TSink";
+
+		/// <summary>
+		/// Whether the parser unlinks a token from the next when it consumes it.
+		/// </summary>
+		/// <remarks>
+		/// The tokens are linked forward only: once unlinked, a consumed token held by
+		/// an action does not hold the rest of the input. The tree of the parser and the
+		/// rescan of the lookaheads for the error messages walk the consumed tokens again,
+		/// and keep them linked.
+		/// </remarks>
+		public static bool ReleasesTokens {
+			get {
+				return Enabled && !TreeGen.Enabled &&
+				       !(Options.getErrorReporting() && CSharpCCGlobals.cc2index != 0);
+			}
+		}
+
+		/// <summary>
+		/// Finds the token of the parser class declaration after which its type parameter
+		/// is written: the name of the class, or the <c>&lt;</c> opening its own type parameters.
+		/// </summary>
+		public static Token FindTypeParameterPosition(IList<Token> tokens) {
+			for (int i = 1; i < tokens.Count; i++) {
+				if (tokens[i - 1].kind == CSharpCCParserConstants.CLASS &&
+				    tokens[i].kind == CSharpCCParserConstants.IDENTIFIER &&
+				    tokens[i].image == CSharpCCGlobals.cu_name) {
+					if (i + 1 < tokens.Count && tokens[i + 1].kind == CSharpCCParserConstants.LT)
+						return tokens[i + 1];
+					return tokens[i];
+				}
+			}
+
+			return null;
+		}
+
+		public static void start() {
+			if (!Enabled)
+				return;
+
+			// The identifiers are those of the tree and of the instrumentation.
+			StringBuilder constants = new StringBuilder();
+			for (int i = 0; i < CSharpCCGlobals.bnfproductions.Count; i++) {
+				if (constants.Length > 0)
+					constants.Append("\n");
+				constants.Append("\tpublic const int ").Append(CSharpCCGlobals.bnfproductions[i].Lhs).Append(" = ").Append(i).Append(";");
+			}
+
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["PARSER_NAME"] = CSharpCCGlobals.cu_name;
+			options["PRODUCTION_CONSTANTS"] = constants.ToString();
+
+			CSharpFiles.GenerateEventSink(InterfaceName + ".cs", options);
+		}
+
+		private static bool CanCallSink() {
+			if (!Options.getEventSink())
+				return false;
+
+			string reason = null;
+			if (CSharpCCGlobals.TreeGenerated) {
+				reason = "the grammar was generated by CSTree";
+			} else if (Options.getTokenManagerUsesParser()) {
+				reason = "TOKEN_MANAGER_USES_PARSER is set to true";
+			}
+
+			if (reason != null) {
+				CSharpCCErrors.Warning("Option EVENT_SINK is ignored since " + reason + ".");
+				return false;
+			}
+
+			return true;
+		}
+
+		public static void reInit() {
+			enabled = null;
+		}
+	}
+}
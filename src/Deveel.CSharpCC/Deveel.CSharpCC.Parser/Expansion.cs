@@ -31,9 +31,13 @@ using System.Collections;
 using System.Text;
 
 namespace Deveel.CSharpCC.Parser {
-    public class Expansion {
+    public class Expansion : ILocationInfo {
         internal static long NextGenerationIndex = 1;
 
+        public Expansion() {
+            InternalName = "";
+        }
+
         public int Line { get; internal set; }
 
         public int Column { get; internal set; }
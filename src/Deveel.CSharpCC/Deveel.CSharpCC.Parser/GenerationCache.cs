@@ -0,0 +1,143 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Remembers the files generated from a grammar, so that a new run with the same
+	/// grammar, options and generator is skipped while these files are as they were written.
+	/// </summary>
+	/// <remarks>
+	/// The record is kept in <c>&lt;parser&gt;Cache.txt</c> in the output directory: the key
+	/// of the generation on the first line, then the digest and the name of every file written.
+	/// It is only kept when the option <c>GENERATION_CACHE</c> is set.
+	/// </remarks>
+	public static class GenerationCache {
+		private static List<string> outputNames = new List<string>();
+		private static Dictionary<string, string> outputDigests = new Dictionary<string, string>();
+
+		public static bool Enabled {
+			get { return Options.getGenerationCache(); }
+		}
+
+		private static string RecordFile {
+			get { return Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + "Cache.txt"); }
+		}
+
+		/// <summary>
+		/// Whether the files generated the last time from the same grammar, options and
+		/// generator are all still there, unchanged.
+		/// </summary>
+		public static bool IsUpToDate() {
+			if (!Enabled || !File.Exists(RecordFile))
+				return false;
+
+			try {
+				using (StreamReader reader = new StreamReader(RecordFile)) {
+					if (reader.ReadLine() != ComputeKey())
+						return false;
+
+					bool any = false;
+					string line;
+					while ((line = reader.ReadLine()) != null) {
+						int space = line.IndexOf(' ');
+						if (space < 0)
+							return false;
+
+						string file = Path.Combine(Options.getOutputDirectory().FullName, line.Substring(space + 1));
+						if (!File.Exists(file) || Digest(File.ReadAllBytes(file)) != line.Substring(0, space))
+							return false;
+
+						any = true;
+					}
+
+					return any;
+				}
+			} catch (IOException) {
+				return false;
+			} catch (UnauthorizedAccessException) {
+				return false;
+			}
+		}
+
+		/// <summary>
+		/// Adds a file written by this run to the record.
+		/// </summary>
+		internal static void AddOutput(string file, byte[] content) {
+			string name = Path.GetFileName(file);
+			if (!outputDigests.ContainsKey(name))
+				outputNames.Add(name);
+			outputDigests[name] = Digest(content);
+		}
+
+		/// <summary>
+		/// Writes the record of this run, after a generation without errors.
+		/// </summary>
+		public static void Save() {
+			if (!Enabled || outputNames.Count == 0)
+				return;
+
+			try {
+				using (StreamWriter writer = new StreamWriter(RecordFile, false, new UTF8Encoding(false))) {
+					writer.WriteLine(ComputeKey());
+					foreach (string name in outputNames)
+						writer.WriteLine(outputDigests[name] + " " + name);
+				}
+			} catch (IOException e) {
+				CSharpCCErrors.Warning("Cannot write the generation cache \"" + RecordFile + "\": " + e.Message);
+			}
+		}
+
+		// The grammar, every option, the generator itself and the profile it lays the
+		// parser out from.
+		private static string ComputeKey() {
+			using (HashAlgorithm hash = MD5.Create()) {
+				Hash(hash, Encoding.UTF8.GetBytes(Path.GetFileName(CSharpCCGlobals.FileName) + "\n"));
+				Hash(hash, File.ReadAllBytes(CSharpCCGlobals.FileName));
+
+				IDictionary<string, object> options = Options.getOptions();
+				List<string> names = new List<string>(options.Keys);
+				names.Sort(StringComparer.Ordinal);
+				foreach (string name in names)
+					Hash(hash, Encoding.UTF8.GetBytes(name + "=" + options[name] + "\n"));
+
+				string generator = typeof(GenerationCache).Assembly.Location;
+				if (generator.Length != 0 && File.Exists(generator))
+					Hash(hash, File.ReadAllBytes(generator));
+				else
+					Hash(hash, Encoding.UTF8.GetBytes(typeof(GenerationCache).Assembly.FullName));
+
+				string profile = Options.getProfileFile();
+				if (profile.Length != 0 && File.Exists(profile))
+					Hash(hash, File.ReadAllBytes(profile));
+
+				hash.TransformFinalBlock(new byte[0], 0, 0);
+				return ToHexString(hash.Hash);
+			}
+		}
+
+		private static void Hash(HashAlgorithm hash, byte[] bytes) {
+			hash.TransformBlock(bytes, 0, bytes.Length, bytes, 0);
+		}
+
+		private static string Digest(byte[] content) {
+			using (HashAlgorithm hash = MD5.Create()) {
+				return ToHexString(hash.ComputeHash(content));
+			}
+		}
+
+		private static string ToHexString(byte[] bytes) {
+			StringBuilder sb = new StringBuilder(bytes.Length * 2);
+			for (int i = 0; i < bytes.Length; i++)
+				sb.Append(bytes[i].ToString("x2"));
+			return sb.ToString();
+		}
+
+		public static void reInit() {
+			outputNames = new List<string>();
+			outputDigests = new Dictionary<string, string>();
+		}
+	}
+}
@@ -0,0 +1,229 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Reflection;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Collects the time and the memory spent in every phase of the generation and
+	/// the sizes of what was generated, reported when the option <c>STATS</c> is set.
+	/// </summary>
+	/// <remarks>
+	/// Phases nest: the figures of a phase include the phases it contains. A phase
+	/// entered several times (like <c>LookaheadCalc</c>) is reported once, with the
+	/// number of calls and the totals of all of them.
+	/// </remarks>
+	public class GenerationStats {
+		private delegate long AllocatedBytesHandler();
+
+		private static readonly AllocatedBytesHandler allocatedBytes = GetAllocatedBytesHandler();
+
+		private static List<PhaseStats> phases = new List<PhaseStats>();
+		private static Dictionary<string, PhaseStats> phasesByName = new Dictionary<string, PhaseStats>();
+		private static List<string> counterNames = new List<string>();
+		private static Dictionary<string, long> counters = new Dictionary<string, long>();
+		private static int depth;
+
+		/// <summary>
+		/// The figures of a phase of the generation.
+		/// </summary>
+		public sealed class PhaseStats {
+			internal PhaseStats(string name, int depth) {
+				Name = name;
+				Depth = depth;
+			}
+
+			public string Name { get; private set; }
+			public int Depth { get; private set; }
+			public int Calls { get; internal set; }
+			public long ElapsedTicks { get; internal set; }
+			public long AllocatedBytes { get; internal set; }
+			public int Collections { get; internal set; }
+
+			/// <summary>
+			/// The size of the managed heap when the phase ended, the largest of all the calls.
+			/// </summary>
+			/// <remarks>
+			/// This is not the peak of the heap during the phase: the runtime gives no
+			/// high-water mark, and what a phase frees before it ends is not counted.
+			/// </remarks>
+			public long HeapBytesAtEnd { get; internal set; }
+
+			public TimeSpan Elapsed {
+				get { return TimeSpan.FromSeconds((double) ElapsedTicks / Stopwatch.Frequency); }
+			}
+		}
+
+		private sealed class Phase : IDisposable {
+			private readonly PhaseStats stats;
+			private readonly long startTicks;
+			private readonly long startBytes;
+			private readonly int startCollections;
+			private bool disposed;
+
+			public Phase(PhaseStats stats) {
+				this.stats = stats;
+				startCollections = GC.CollectionCount(0);
+				startBytes = allocatedBytes();
+				startTicks = Stopwatch.GetTimestamp();
+			}
+
+			public void Dispose() {
+				if (disposed)
+					return;
+
+				disposed = true;
+				stats.ElapsedTicks += Stopwatch.GetTimestamp() - startTicks;
+				// GC.GetTotalMemory is only an estimate when the exact count is not available.
+				stats.AllocatedBytes += Math.Max(0, allocatedBytes() - startBytes);
+				stats.Collections += GC.CollectionCount(0) - startCollections;
+				stats.HeapBytesAtEnd = Math.Max(stats.HeapBytesAtEnd, GC.GetTotalMemory(false));
+				depth--;
+			}
+		}
+
+		/// <summary>
+		/// The phases entered so far, in the order they were first entered.
+		/// </summary>
+		public static IList<PhaseStats> Phases {
+			get { return phases.AsReadOnly(); }
+		}
+
+		/// <summary>
+		/// The names of the sizes added so far.
+		/// </summary>
+		public static IList<string> CounterNames {
+			get { return counterNames.AsReadOnly(); }
+		}
+
+		/// <summary>
+		/// Enters a phase of the generation, that ends when the returned object is disposed.
+		/// </summary>
+		public static IDisposable Begin(string name) {
+			PhaseStats stats;
+			if (!phasesByName.TryGetValue(name, out stats)) {
+				stats = new PhaseStats(name, depth);
+				phasesByName.Add(name, stats);
+				phases.Add(stats);
+			}
+
+			stats.Calls++;
+			depth++;
+			return new Phase(stats);
+		}
+
+		/// <summary>
+		/// Adds the given value to a size of the generated code.
+		/// </summary>
+		public static void Add(string counter, long value) {
+			long current;
+			if (!counters.TryGetValue(counter, out current))
+				counterNames.Add(counter);
+			counters[counter] = current + value;
+		}
+
+		public static long GetCounter(string counter) {
+			long value;
+			counters.TryGetValue(counter, out value);
+			return value;
+		}
+
+		/// <summary>
+		/// Writes the report on the console and in <c>&lt;parser&gt;Stats.json</c>
+		/// if the option <c>STATS</c> is set.
+		/// </summary>
+		public static void start() {
+			if (!Options.getStats())
+				return;
+
+			WriteReport(Console.Out);
+
+			string fileName = Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + "Stats.json");
+			try {
+				using (StreamWriter writer = new StreamWriter(fileName, false, new UTF8Encoding(false))) {
+					WriteJson(writer);
+				}
+			} catch (IOException e) {
+				CSharpCCErrors.Warning("Could not write the generation statistics to " + fileName + ": " + e.Message);
+			}
+		}
+
+		/// <summary>
+		/// Counts the lines of a generated file, whether or not it is written:
+		/// a file left unchanged was still generated.
+		/// </summary>
+		public static void AddGeneratedFile(byte[] content) {
+			if (!Options.getStats())
+				return;
+
+			long lines = 0;
+			for (int i = 0; i < content.Length; i++) {
+				if (content[i] == (byte) '\n')
+					lines++;
+			}
+			if (content.Length > 0 && content[content.Length - 1] != (byte) '\n')
+				lines++;
+
+			Add("Generated files", 1);
+			Add("Generated lines", lines);
+		}
+
+		public static void WriteReport(TextWriter writer) {
+			writer.WriteLine("");
+			writer.WriteLine("{0,-40} {1,8} {2,12} {3,14} {4,6} {5,14}", "Phase", "Calls", "Time (ms)", "Allocated", "GCs", "Heap at end");
+			foreach (PhaseStats stats in phases) {
+				writer.WriteLine(String.Format(CultureInfo.InvariantCulture, "{0,-40} {1,8} {2,12:0.000} {3,14} {4,6} {5,14}",
+					new String(' ', stats.Depth * 2) + stats.Name, stats.Calls, stats.Elapsed.TotalMilliseconds,
+					stats.AllocatedBytes, stats.Collections, stats.HeapBytesAtEnd));
+			}
+
+			writer.WriteLine("");
+			foreach (string name in counterNames)
+				writer.WriteLine(String.Format(CultureInfo.InvariantCulture, "{0,-40} {1,8}", name, counters[name]));
+			writer.Flush();
+		}
+
+		public static void WriteJson(TextWriter writer) {
+			writer.WriteLine("{");
+			writer.WriteLine("  \"grammar\": \"{0}\",", CSharpCCGlobals.AddEscapes(CSharpCCGlobals.FileName ?? ""));
+			writer.WriteLine("  \"phases\": [");
+			for (int i = 0; i < phases.Count; i++) {
+				PhaseStats stats = phases[i];
+				writer.WriteLine(String.Format(CultureInfo.InvariantCulture,
+					"    {{ \"name\": \"{0}\", \"depth\": {1}, \"calls\": {2}, \"milliseconds\": {3:0.000}, \"allocatedBytes\": {4}, \"collections\": {5}, \"heapBytesAtEnd\": {6} }}{7}",
+					CSharpCCGlobals.AddEscapes(stats.Name), stats.Depth, stats.Calls, stats.Elapsed.TotalMilliseconds,
+					stats.AllocatedBytes, stats.Collections, stats.HeapBytesAtEnd, i < phases.Count - 1 ? "," : ""));
+			}
+			writer.WriteLine("  ],");
+			writer.WriteLine("  \"sizes\": {");
+			for (int i = 0; i < counterNames.Count; i++) {
+				writer.WriteLine(String.Format(CultureInfo.InvariantCulture, "    \"{0}\": {1}{2}",
+					CSharpCCGlobals.AddEscapes(counterNames[i]), counters[counterNames[i]], i < counterNames.Count - 1 ? "," : ""));
+			}
+			writer.WriteLine("  }");
+			writer.WriteLine("}");
+			writer.Flush();
+		}
+
+		private static AllocatedBytesHandler GetAllocatedBytesHandler() {
+			// GC.GetAllocatedBytesForCurrentThread only exists on the newer runtimes.
+			MethodInfo method = typeof(GC).GetMethod("GetAllocatedBytesForCurrentThread", BindingFlags.Public | BindingFlags.Static,
+				null, Type.EmptyTypes, null);
+			if (method != null && method.ReturnType == typeof(long))
+				return (AllocatedBytesHandler) Delegate.CreateDelegate(typeof(AllocatedBytesHandler), method);
+
+			return delegate { return GC.GetTotalMemory(false); };
+		}
+
+		public static void reInit() {
+			phases = new List<PhaseStats>();
+			phasesByName = new Dictionary<string, PhaseStats>();
+			counterNames = new List<string>();
+			counters = new Dictionary<string, long>();
+			depth = 0;
+		}
+	}
+}
@@ -0,0 +1,83 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the runtime counters of a parser (option <c>INSTRUMENT</c>):
+	/// an <c>EventSource</c> fed by the parser with the calls of every production,
+	/// the tokens consumed and the time spent in the top-level calls, and by the
+	/// token manager with the characters lexed.
+	/// </summary>
+	public class InstrumentGen {
+		private static bool? enabled;
+
+		/// <summary>
+		/// Whether the parser and the token manager are instrumented: warns
+		/// the first time if the option is set but cannot be honored.
+		/// </summary>
+		public static bool Enabled {
+			get {
+				if (enabled == null)
+					enabled = CanInstrument();
+				return enabled.Value;
+			}
+		}
+
+		/// <summary>
+		/// The name of the generated event source class.
+		/// </summary>
+		public static string ClassName {
+			get { return CSharpCCGlobals.cu_name + "EventSource"; }
+		}
+
+		/// <summary>
+		/// The index of the production in the counters of the event source.
+		/// </summary>
+		public static int ProductionId(NormalProduction p) {
+			return CSharpCCGlobals.bnfproductions.IndexOf(p);
+		}
+
+		public static void start() {
+			if (!Enabled)
+				return;
+
+			StringBuilder names = new StringBuilder();
+			foreach (NormalProduction p in CSharpCCGlobals.bnfproductions) {
+				if (names.Length > 0)
+					names.Append(", ");
+				names.Append('"').Append(p.Lhs).Append('"');
+			}
+
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["PARSER_NAME"] = CSharpCCGlobals.cu_name;
+			options["PRODUCTION_NAMES"] = names.ToString();
+			options["EVENT_COUNTERS"] = Options.clrVersionAtLeast(5.0);
+
+			CSharpFiles.GenerateEventSource(ClassName + ".cs", options);
+		}
+
+		private static bool CanInstrument() {
+			if (!Options.getInstrument())
+				return false;
+
+			string reason = null;
+			if (!Options.clrVersionAtLeast(4.5)) {
+				reason = "EventSource requires CLR_VERSION 4.5 or later";
+			} else if (Options.getStatic()) {
+				reason = "STATIC is set to true";
+			}
+
+			if (reason != null) {
+				CSharpCCErrors.Warning("Option INSTRUMENT is ignored since " + reason + ".");
+				return false;
+			}
+
+			return true;
+		}
+
+		public static void reInit() {
+			enabled = null;
+		}
+	}
+}
@@ -0,0 +1,535 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the classification of the keywords of the token manager through
+	/// a minimal perfect hash (option <c>KEYWORD_HASH</c>): the string literals of
+	/// a lexical state that its identifier token also matches are left out of the
+	/// literal DFA, and the identifiers matched by the NFA are looked up in a
+	/// table of these keywords.
+	/// </summary>
+	/// <remarks>
+	/// A literal is a keyword of an identifier if the identifier is the first
+	/// token of the NFA matching its whole image and comes after the literal in
+	/// the grammar, so that the literal is the token matched either way. The
+	/// identifier of a lexical state is the one having the most keywords.
+	/// </remarks>
+	public class KeywordGen {
+		private sealed class KeywordTable {
+			public int LexState;
+			public int Identifier;
+			public bool Fold;
+			public int MinLength;
+			public int MaxLength;
+			public int[] Displacements;
+			public int[] Kinds;
+			public string[] Images;
+		}
+
+		// Hashes of identical keys never part, so the displacements are bounded.
+		private const int MaxDisplacement = 1 << 16;
+
+		// How a string is matched: as it is, in one of its cases, or in all of
+		// its cases.
+		private const int ExactCase = 0;
+		private const int AnyCase = 1;
+		private const int AllCases = 2;
+
+		private static bool? enabled;
+		private static readonly List<KeywordTable> tables = new List<KeywordTable>();
+		private static KeywordTable current;
+		private static readonly Dictionary<int, string> keywords = new Dictionary<int, string>();
+
+		/// <summary>
+		/// Whether the keywords are classified through a perfect hash: warns the
+		/// first time if the option is set but cannot be honored.
+		/// </summary>
+		public static bool Enabled {
+			get {
+				if (enabled == null)
+					enabled = CanHash();
+				return enabled.Value;
+			}
+		}
+
+		/// <summary>
+		/// Whether a lexical state has keywords, so that the character stream
+		/// must hash and compare its suffixes.
+		/// </summary>
+		public static bool HasKeywords {
+			get { return tables.Count > 0; }
+		}
+
+		private static bool CanHash() {
+			if (!Options.getKeywordHash())
+				return false;
+
+			if (Options.getUserCharStream() || Options.getUnicodeEscape()) {
+				CSharpCCErrors.Warning("Option KEYWORD_HASH is ignored since it requires the generated SimpleCharStream.");
+				return false;
+			}
+
+			return true;
+		}
+
+		/// <summary>
+		/// Chooses the keywords of the current lexical state, before its literals
+		/// are added to the DFA.
+		/// </summary>
+		internal static void SelectKeywords(IList<TokenProduction> allTps) {
+			current = null;
+			keywords.Clear();
+			if (!Enabled)
+				return;
+
+			List<RegularExpression> nfaTokens = new List<RegularExpression>();
+			List<bool> nfaIgnoreCase = new List<bool>();
+			List<RStringLiteral> literals = new List<RStringLiteral>();
+			List<bool> literalIgnoreCase = new List<bool>();
+			foreach (TokenProduction tp in allTps) {
+				bool ignoreCase = Options.getIgnoreCase() || tp.IgnoreCase;
+				foreach (RegExprSpec respec in tp.RegexSpecs) {
+					RegularExpression re = respec.RegularExpression;
+					if (re.IsPrivate)
+						continue;
+
+					// A keyword of one character could also be taken by a token
+					// matching any character.
+					if (re is RStringLiteral) {
+						if (((RStringLiteral) re).Image.Length > 1) {
+							literals.Add((RStringLiteral) re);
+							literalIgnoreCase.Add(ignoreCase);
+						}
+					} else if (!re.CanMatchAnyChar && !(re is REndOfFile)) {
+						int i = 0;
+						while (i < nfaTokens.Count && nfaTokens[i].Ordinal < re.Ordinal)
+							i++;
+						nfaTokens.Insert(i, re);
+						nfaIgnoreCase.Insert(i, ignoreCase);
+					}
+				}
+			}
+
+			// The literals matched first by every token of the NFA.
+			Dictionary<int, List<int>> subsumed = new Dictionary<int, List<int>>();
+			int identifier = -1;
+			for (int i = 0; i < literals.Count; i++) {
+				RStringLiteral literal = literals[i];
+				int cases = literalIgnoreCase[i] ? AnyCase : ExactCase;
+				for (int j = 0; j < nfaTokens.Count; j++) {
+					if (!Matches(nfaTokens[j], literal.Image, nfaIgnoreCase[j], cases))
+						continue;
+
+					if (nfaTokens[j].Ordinal > literal.Ordinal &&
+					    (cases == ExactCase || Matches(nfaTokens[j], literal.Image, nfaIgnoreCase[j], AllCases))) {
+						List<int> list;
+						if (!subsumed.TryGetValue(j, out list))
+							subsumed[j] = list = new List<int>();
+						list.Add(i);
+						if (identifier == -1 || list.Count > subsumed[identifier].Count)
+							identifier = j;
+					}
+					break;
+				}
+			}
+
+			if (identifier == -1)
+				return;
+
+			// The keywords are all compared with or without case.
+			List<int> candidates = subsumed[identifier];
+			bool fold = literalIgnoreCase[candidates[0]];
+			List<int> kinds = new List<int>();
+			List<string> images = new List<string>();
+			foreach (int i in candidates) {
+				string image = literals[i].Image;
+				if (literalIgnoreCase[i] != fold)
+					continue;
+
+				if (fold) {
+					image = FoldCase(image);
+					if (image == null || images.Contains(image))
+						continue;
+				}
+
+				kinds.Add(literals[i].Ordinal);
+				images.Add(image);
+			}
+
+			KeywordTable table = new KeywordTable();
+			table.LexState = LexGen.lexStateIndex;
+			table.Identifier = nfaTokens[identifier].Ordinal;
+			table.Fold = fold;
+			if (!BuildHash(table, kinds, images)) {
+				CSharpCCErrors.Warning(nfaTokens[identifier], "No perfect hash was found for the keywords of lexical state " +
+				                                              LexGen.lexStateName[LexGen.lexStateIndex] + ": they are matched by the DFA.");
+				return;
+			}
+
+			current = table;
+			foreach (RStringLiteral literal in literals) {
+				if (kinds.Contains(literal.Ordinal)) {
+					keywords[literal.Ordinal] = literal.Image;
+					RStringLiteral.allImages[literal.Ordinal] = null;
+				}
+			}
+			GenerationStats.Add("Keywords", kinds.Count);
+		}
+
+		/// <summary>
+		/// Whether the literal of the given kind is a keyword of the current
+		/// lexical state, left out of its DFA.
+		/// </summary>
+		internal static bool IsKeyword(int kind) {
+			return keywords.ContainsKey(kind);
+		}
+
+		// The image with its ASCII letters in lower case, or null if it has
+		// other letters, that the token manager does not fold.
+		private static string FoldCase(string image) {
+			char[] chars = image.ToCharArray();
+			for (int i = 0; i < chars.Length; i++) {
+				char c = chars[i];
+				if (c >= 'A' && c <= 'Z')
+					chars[i] = (char) (c + 32);
+				else if (c > 127 && Char.ToLower(c) != Char.ToUpper(c))
+					return null;
+			}
+			return new string(chars);
+		}
+
+		#region Matching
+
+		// Whether the regular expression matches the whole of s, or of some
+		// or all of its cases. The cases of every character are independent,
+		// so that a character matching in all its cases is enough for all.
+		private static bool Matches(RegularExpression re, string s, bool ignoreCase, int cases) {
+			bool[] starts = new bool[s.Length + 1];
+			starts[0] = true;
+			return Match(re, s, starts, ignoreCase, cases)[s.Length];
+		}
+
+		// The ends of the matches of the regular expression in s, from the
+		// positions set in starts.
+		private static bool[] Match(RegularExpression re, string s, bool[] starts, bool ignoreCase, int cases) {
+			bool[] ends = new bool[s.Length + 1];
+
+			if (re is RStringLiteral) {
+				string image = ((RStringLiteral) re).Image;
+				for (int i = 0; i + image.Length <= s.Length; i++) {
+					if (!starts[i])
+						continue;
+
+					int j = 0;
+					while (j < image.Length && CharMatches(image[j], s[i + j], ignoreCase, cases))
+						j++;
+					if (j == image.Length)
+						ends[i + j] = true;
+				}
+			} else if (re is RCharacterList) {
+				for (int i = 0; i < s.Length; i++) {
+					if (starts[i] && ListMatches((RCharacterList) re, s[i], ignoreCase, cases))
+						ends[i + 1] = true;
+				}
+			} else if (re is RSequence) {
+				ends = starts;
+				foreach (RegularExpression unit in ((RSequence) re).Units)
+					ends = Match(unit, s, ends, ignoreCase, cases);
+			} else if (re is RChoice) {
+				foreach (RegularExpression choice in ((RChoice) re).Choices)
+					Union(ends, Match(choice, s, starts, ignoreCase, cases));
+			} else if (re is RZeroOrMore) {
+				ends = Closure(((RZeroOrMore) re).RegularExpression, s, starts, ignoreCase, cases);
+			} else if (re is ROneOrMore) {
+				RegularExpression unit = ((ROneOrMore) re).RegularExpression;
+				ends = Closure(unit, s, Match(unit, s, starts, ignoreCase, cases), ignoreCase, cases);
+			} else if (re is RZeroOrOne) {
+				Union(ends, starts);
+				Union(ends, Match(((RZeroOrOne) re).RegularExpression, s, starts, ignoreCase, cases));
+			} else if (re is RRepetitionRange) {
+				RRepetitionRange range = (RRepetitionRange) re;
+				bool[] next = starts;
+				for (int i = 0; i < range.Min; i++)
+					next = Match(range.RegularExpression, s, next, ignoreCase, cases);
+
+				if (!range.HasMax)
+					return Closure(range.RegularExpression, s, next, ignoreCase, cases);
+
+				Union(ends, next);
+				for (int i = range.Min; i < range.Max; i++) {
+					next = Match(range.RegularExpression, s, next, ignoreCase, cases);
+					Union(ends, next);
+				}
+			} else if (re is RJustName) {
+				ends = Match(((RJustName) re).RegularExpression, s, starts, ignoreCase, cases);
+			}
+
+			return ends;
+		}
+
+		private static bool[] Closure(RegularExpression re, string s, bool[] starts, bool ignoreCase, int cases) {
+			bool[] ends = new bool[s.Length + 1];
+			Union(ends, starts);
+
+			bool changed = true;
+			while (changed) {
+				changed = false;
+				bool[] next = Match(re, s, ends, ignoreCase, cases);
+				for (int i = 0; i < next.Length; i++) {
+					if (next[i] && !ends[i])
+						changed = ends[i] = true;
+				}
+			}
+
+			return ends;
+		}
+
+		private static void Union(bool[] set, bool[] other) {
+			for (int i = 0; i < set.Length; i++)
+				set[i] |= other[i];
+		}
+
+		private static bool CharMatches(char expected, char c, bool ignoreCase, int cases) {
+			bool same = SameChar(expected, c, ignoreCase);
+			if (cases == AnyCase)
+				return same || SameChar(expected, Char.ToLower(c), ignoreCase) || SameChar(expected, Char.ToUpper(c), ignoreCase);
+			if (cases == AllCases)
+				return same && SameChar(expected, Char.ToLower(c), ignoreCase) && SameChar(expected, Char.ToUpper(c), ignoreCase);
+			return same;
+		}
+
+		private static bool SameChar(char expected, char c, bool ignoreCase) {
+			return c == expected ||
+			       (ignoreCase && (Char.ToLower(c) == Char.ToLower(expected) || Char.ToUpper(c) == Char.ToUpper(expected)));
+		}
+
+		private static bool ListMatches(RCharacterList list, char c, bool ignoreCase, int cases) {
+			bool found = InList(list, c, ignoreCase);
+			if (cases == AnyCase)
+				return found || InList(list, Char.ToLower(c), ignoreCase) || InList(list, Char.ToUpper(c), ignoreCase);
+			if (cases == AllCases)
+				return found && InList(list, Char.ToLower(c), ignoreCase) && InList(list, Char.ToUpper(c), ignoreCase);
+			return found;
+		}
+
+		private static bool InList(RCharacterList list, char c, bool ignoreCase) {
+			bool found = InDescriptors(list, c) ||
+			             (ignoreCase && (InDescriptors(list, Char.ToLower(c)) || InDescriptors(list, Char.ToUpper(c))));
+			if (!list.Negated)
+				return found;
+
+			// Negated lists stop at 0xff, unless the input is unicode.
+			return !found && (c <= 0xff || NfaState.unicodeWarningGiven || Options.getUnicodeEscape());
+		}
+
+		private static bool InDescriptors(RCharacterList list, char c) {
+			foreach (object descriptor in list.Descriptors) {
+				if (descriptor is SingleCharacter) {
+					if (((SingleCharacter) descriptor).Character == c)
+						return true;
+				} else {
+					CharacterRange range = (CharacterRange) descriptor;
+					if (c >= range.Left && c <= range.Right)
+						return true;
+				}
+			}
+			return false;
+		}
+
+		#endregion
+
+		#region Perfect Hash
+
+		// The hash of the token manager: FNV-1a over the characters, computed by
+		// SimpleCharStream.SuffixHash on the characters read.
+		private static uint Hash(string s) {
+			unchecked {
+				uint h = 2166136261;
+				foreach (char c in s)
+					h = (h ^ c) * 16777619;
+				return h;
+			}
+		}
+
+		// The slot of a key in a bucket with the given displacement, as
+		// computed by ccKeywordMix in the token manager.
+		private static int Slot(uint hash, int displacement, int count) {
+			unchecked {
+				uint h = hash + (uint) displacement;
+				h ^= h >> 16;
+				h *= 0x85ebca6b;
+				h ^= h >> 13;
+				h *= 0xc2b2ae35;
+				h ^= h >> 16;
+				return (int) (h % (uint) count);
+			}
+		}
+
+		// Hash and displace: the keys are put in as many buckets as there are
+		// keys; the buckets with more than one key, largest first, get the
+		// first displacement sending their keys to free slots, and those with
+		// one key get a free slot, stored as -(slot + 1).
+		private static bool BuildHash(KeywordTable table, List<int> kinds, List<string> images) {
+			int count = images.Count;
+			uint[] hashes = new uint[count];
+			List<int>[] buckets = new List<int>[count];
+			table.MinLength = Int32.MaxValue;
+			table.MaxLength = 0;
+			for (int i = 0; i < count; i++) {
+				hashes[i] = Hash(images[i]);
+				int b = (int) (hashes[i] % (uint) count);
+				if (buckets[b] == null)
+					buckets[b] = new List<int>();
+				buckets[b].Add(i);
+				table.MinLength = Math.Min(table.MinLength, images[i].Length);
+				table.MaxLength = Math.Max(table.MaxLength, images[i].Length);
+			}
+
+			int[] order = new int[count];
+			int[] sizes = new int[count];
+			for (int b = 0; b < count; b++) {
+				order[b] = b;
+				sizes[b] = buckets[b] == null ? 0 : -buckets[b].Count;
+			}
+			Array.Sort(sizes, order);
+
+			table.Displacements = new int[count];
+			table.Kinds = new int[count];
+			table.Images = new string[count];
+			bool[] used = new bool[count];
+			int[] slots = new int[count];
+			int free = 0;
+
+			foreach (int b in order) {
+				List<int> bucket = buckets[b];
+				if (bucket == null)
+					break;
+
+				if (bucket.Count == 1) {
+					while (used[free])
+						free++;
+					Place(table, used, free, bucket[0], kinds, images);
+					table.Displacements[b] = -(free + 1);
+					continue;
+				}
+
+				int displacement = 1;
+				for (; displacement < MaxDisplacement; displacement++) {
+					int placed = 0;
+					for (; placed < bucket.Count; placed++) {
+						int slot = Slot(hashes[bucket[placed]], displacement, count);
+						if (used[slot] || Array.IndexOf(slots, slot, 0, placed) >= 0)
+							break;
+						slots[placed] = slot;
+					}
+					if (placed == bucket.Count)
+						break;
+				}
+
+				if (displacement == MaxDisplacement)
+					return false;
+
+				for (int i = 0; i < bucket.Count; i++)
+					Place(table, used, slots[i], bucket[i], kinds, images);
+				table.Displacements[b] = displacement;
+			}
+
+			return true;
+		}
+
+		private static void Place(KeywordTable table, bool[] used, int slot, int key, List<int> kinds, List<string> images) {
+			used[slot] = true;
+			table.Kinds[slot] = kinds[key];
+			table.Images[slot] = images[key];
+		}
+
+		#endregion
+
+		/// <summary>
+		/// Generates the lookup of the keywords of the current lexical state,
+		/// after its DFA, and puts their images back among the literals.
+		/// </summary>
+		internal static void DumpKeywordKind(TextWriter ostr) {
+			if (current == null)
+				return;
+
+			foreach (KeyValuePair<int, string> keyword in keywords)
+				RStringLiteral.allImages[keyword.Key] = keyword.Value;
+
+			string staticString = Options.getStatic() ? "static " : "";
+			if (tables.Count == 0) {
+				ostr.WriteLine("private static uint ccKeywordMix(uint h)");
+				ostr.WriteLine("{");
+				ostr.WriteLine("   unchecked {");
+				ostr.WriteLine("      h ^= h >> 16;");
+				ostr.WriteLine("      h *= 0x85ebca6b;");
+				ostr.WriteLine("      h ^= h >> 13;");
+				ostr.WriteLine("      h *= 0xc2b2ae35;");
+				ostr.WriteLine("      return h ^ (h >> 16);");
+				ostr.WriteLine("   }");
+				ostr.WriteLine("}");
+			}
+			tables.Add(current);
+
+			int count = current.Kinds.Length;
+			string suffix = LexGen.lexStateSuffix;
+			DumpTable(ostr, "ccKeywordDisplacements" + suffix, current.Displacements);
+			DumpTable(ostr, "ccKeywordKinds" + suffix, current.Kinds);
+			ostr.Write("static readonly string[] ccKeywordImages" + suffix + " = {");
+			for (int i = 0; i < count; i++) {
+				if (i % 8 == 0)
+					ostr.Write("\n   ");
+				ostr.Write("\"" + CSharpCCGlobals.AddEscapes(current.Images[i]) + "\", ");
+			}
+			ostr.WriteLine("\n};");
+
+			string fold = current.Fold ? "true" : "false";
+			ostr.WriteLine("// The kind of the keyword whose image is the last len characters read, or kind.");
+			ostr.WriteLine("private " + staticString + "int ccKeywordKind" + suffix + "(int len, int kind)");
+			ostr.WriteLine("{");
+			ostr.WriteLine("   if (len < " + current.MinLength + " || len > " + current.MaxLength + ")");
+			ostr.WriteLine("      return kind;");
+			ostr.WriteLine("   uint h = inputStream.SuffixHash(len, " + fold + ");");
+			ostr.WriteLine("   int d = ccKeywordDisplacements" + suffix + "[(int) (h % " + count + ")];");
+			ostr.WriteLine("   int slot = d < 0 ? -d - 1 : (int) (ccKeywordMix(unchecked(h + (uint) d)) % " + count + ");");
+			ostr.WriteLine("   if (inputStream.SuffixEquals(len, ccKeywordImages" + suffix + "[slot], " + fold + "))");
+			ostr.WriteLine("      return ccKeywordKinds" + suffix + "[slot];");
+			ostr.WriteLine("   return kind;");
+			ostr.WriteLine("}");
+		}
+
+		private static void DumpTable(TextWriter ostr, string name, int[] values) {
+			ostr.Write(CSharpCCGlobals.TableDeclaration("static", "int", name) + "{");
+			for (int i = 0; i < values.Length; i++) {
+				if (i % 16 == 0)
+					ostr.Write("\n   ");
+				ostr.Write(values[i] + ", ");
+			}
+			ostr.WriteLine("\n};");
+		}
+
+		/// <summary>
+		/// Generates the lookup of the identifiers just matched, once the input
+		/// stream is back at the end of the match.
+		/// </summary>
+		internal static void DumpClassification(TextWriter ostr, string prefix, bool checkLexState) {
+			for (int i = 0; i < tables.Count; i++) {
+				KeywordTable table = tables[i];
+				ostr.Write(prefix + (i == 0 ? "if" : "else if") + " (ccMatchedKind == " + table.Identifier);
+				if (checkLexState)
+					ostr.Write(" && curLexState == " + table.LexState);
+				ostr.WriteLine(")");
+				ostr.WriteLine(prefix + "   ccMatchedKind = ccKeywordKind_" + table.LexState + "(ccMatchedPos + 1, ccMatchedKind);");
+			}
+		}
+
+		public static void reInit() {
+			enabled = null;
+			tables.Clear();
+			current = null;
+			keywords.Clear();
+		}
+	}
+}
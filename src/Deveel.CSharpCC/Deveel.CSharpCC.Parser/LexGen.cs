@@ -3,6 +3,8 @@ using System.Collections;
 using System.Collections.Generic;
 using System.IO;
 
+using Deveel.CSharpCC.Util;
+
 namespace Deveel.CSharpCC.Parser {
 	public class LexGen {
         private static TextWriter ostr;
@@ -51,6 +53,12 @@ namespace Deveel.CSharpCC.Parser {
         private static bool hasMore = false;
         public static RegularExpression curRE;
         public static bool keepLineCol;
+        private static bool kindScanner;
+        internal static bool internImages;
+        internal static bool profile;
+        private static long[] internKinds;
+        internal static bool typedValues;
+        private static string[] valueKinds;
 
         // Assumes l != 0L
         static int MaxChar(long l)
@@ -72,7 +80,7 @@ namespace Deveel.CSharpCC.Parser {
 
             try {
                 string tmp = Path.Combine(Options.getOutputDirectory().FullName, tokMgrClassName + ".cs");
-                ostr = new StreamWriter(tmp);
+                ostr = new StreamWriter(new GeneratedFileStream(tmp));
                 List<string> tn = new List<string>(CSharpCCGlobals.ToolNames);
                 tn.Add(CSharpCCGlobals.ToolName);
 
@@ -207,7 +215,7 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("     if (vec[i] == -1)");
             ostr.WriteLine("       continue;");
             ostr.WriteLine("     int[] stateSet = statesForState[curLexState][vec[i]];");
-            ostr.WriteLine("     for (int j = 0; j < stateSet.length; j++) {");
+            ostr.WriteLine("     for (int j = 0; j < stateSet.Length; j++) {");
             ostr.WriteLine("       int state = stateSet[j];");
             ostr.WriteLine("       if (!kindDone[kindForState[lexState][state]]) {");
             ostr.WriteLine("          kindDone[kindForState[lexState][state]] = true;");
@@ -305,6 +313,13 @@ namespace Deveel.CSharpCC.Parser {
 				return;
 
 			keepLineCol = Options.getKeepLineColumn();
+			profile = Options.getProfileTokenManager();
+			kindScanner = Options.getTokenKindScanner();
+			if (kindScanner && (Options.getUserCharStream() || Options.getUnicodeEscape())) {
+				CSharpCCErrors.Warning("Option TOKEN_KIND_SCANNER is ignored since it requires the token offsets " +
+				                       "of SimpleCharStream.");
+				kindScanner = false;
+			}
 			List<RegularExpression> choices = new List<RegularExpression>();
 			IEnumerator e;
 			TokenProduction tp;
@@ -316,6 +331,11 @@ namespace Deveel.CSharpCC.Parser {
 			PrintClassHead();
 			BuildLexStatesTable();
 
+			internKinds = GetInternKinds();
+			internImages = internKinds != null;
+			valueKinds = GetValueKinds();
+			typedValues = valueKinds != null;
+
 			e = allTpsForState.Keys.GetEnumerator();
 
 			bool ignoring = false;
@@ -325,152 +345,167 @@ namespace Deveel.CSharpCC.Parser {
 				RStringLiteral.ReInit();
 
 				String key = (String) e.Current;
-
-				lexStateIndex = GetIndex(key);
-				lexStateSuffix = "_" + lexStateIndex;
-				IList<TokenProduction> allTps = allTpsForState[key];
-				initStates[key] = initialState = new NfaState();
-				ignoring = false;
-
-				singlesToSkip[lexStateIndex] = new NfaState();
-				singlesToSkip[lexStateIndex].dummy = true;
-
-				if (key.Equals("DEFAULT"))
-					defaultLexState = lexStateIndex;
-
-				for (i = 0; i < allTps.Count; i++) {
-					tp = allTps[i];
-					int kind = tp.Kind;
-					bool ignore = tp.IgnoreCase;
-					IList<RegExprSpec> rexps = tp.RegexSpecs;
-
-					if (i == 0)
-						ignoring = ignore;
-
-					for (j = 0; j < rexps.Count; j++) {
-						RegExprSpec respec = rexps[j];
-						curRE = respec.RegularExpression;
-
-						rexprs[curKind = curRE.Ordinal] = curRE;
-						lexStates[curRE.Ordinal] = lexStateIndex;
-						ignoreCase[curRE.Ordinal] = ignore;
-
-						if (curRE.IsPrivate) {
-							kinds[curRE.Ordinal] = -1;
-							continue;
-						}
-
-						if (curRE is RStringLiteral &&
-						    !((RStringLiteral) curRE).Image.Equals("")) {
-							((RStringLiteral) curRE).GenerateDfa(ostr, curRE.Ordinal);
-							if (i != 0 && !mixed[lexStateIndex] && ignoring != ignore)
-								mixed[lexStateIndex] = true;
-						} else if (curRE.CanMatchAnyChar) {
-							if (canMatchAnyChar[lexStateIndex] == -1 ||
-							    canMatchAnyChar[lexStateIndex] > curRE.Ordinal)
-								canMatchAnyChar[lexStateIndex] = curRE.Ordinal;
-						} else {
-							Nfa temp;
-
-							if (curRE is RChoice)
-								choices.Add(curRE);
-
-							temp = curRE.GenerateNfa(ignore);
-							temp.End.isFinal = true;
-							temp.End.kind = curRE.Ordinal;
-							initialState.AddMove(temp.Start);
+				using (GenerationStats.Begin("LexGen <" + key + ">")) {
+
+					lexStateIndex = GetIndex(key);
+					lexStateSuffix = "_" + lexStateIndex;
+					IList<TokenProduction> allTps = allTpsForState[key];
+					initStates[key] = initialState = new NfaState();
+					ignoring = false;
+
+					singlesToSkip[lexStateIndex] = new NfaState();
+					singlesToSkip[lexStateIndex].dummy = true;
+					KeywordGen.SelectKeywords(allTps);
+
+					if (key.Equals("DEFAULT"))
+						defaultLexState = lexStateIndex;
+
+					for (i = 0; i < allTps.Count; i++) {
+						tp = allTps[i];
+						int kind = tp.Kind;
+						bool ignore = tp.IgnoreCase;
+						IList<RegExprSpec> rexps = tp.RegexSpecs;
+
+						if (i == 0)
+							ignoring = ignore;
+
+						for (j = 0; j < rexps.Count; j++) {
+							RegExprSpec respec = rexps[j];
+							curRE = respec.RegularExpression;
+
+							rexprs[curKind = curRE.Ordinal] = curRE;
+							lexStates[curRE.Ordinal] = lexStateIndex;
+							ignoreCase[curRE.Ordinal] = ignore;
+
+							if (curRE.IsPrivate) {
+								kinds[curRE.Ordinal] = -1;
+								continue;
+							}
+
+							if (curRE is RStringLiteral &&
+							    !((RStringLiteral) curRE).Image.Equals("")) {
+								if (!KeywordGen.IsKeyword(curRE.Ordinal))
+									((RStringLiteral) curRE).GenerateDfa(ostr, curRE.Ordinal);
+								if (i != 0 && !mixed[lexStateIndex] && ignoring != ignore)
+									mixed[lexStateIndex] = true;
+							} else if (curRE.CanMatchAnyChar) {
+								if (canMatchAnyChar[lexStateIndex] == -1 ||
+								    canMatchAnyChar[lexStateIndex] > curRE.Ordinal)
+									canMatchAnyChar[lexStateIndex] = curRE.Ordinal;
+							} else {
+								Nfa temp;
+
+								if (curRE is RChoice)
+									choices.Add(curRE);
+
+								temp = curRE.GenerateNfa(ignore);
+								temp.End.isFinal = true;
+								temp.End.kind = curRE.Ordinal;
+								initialState.AddMove(temp.Start);
+							}
+
+							if (kinds.Length < curRE.Ordinal) {
+								int[] tmp = new int[curRE.Ordinal + 1];
+
+								Array.Copy(kinds, 0, tmp, 0, kinds.Length);
+								kinds = tmp;
+							}
+							//System.out.println("   ordina : " + curRE.ordinal);
+
+							kinds[curRE.Ordinal] = kind;
+
+							if (respec.NextState != null &&
+							    !respec.NextState.Equals(lexStateName[lexStateIndex]))
+								newLexState[curRE.Ordinal] = respec.NextState;
+
+							if (respec.Action != null && respec.Action.ActionTokens != null &&
+							    respec.Action.ActionTokens.Count > 0)
+								actions[curRE.Ordinal] = respec.Action;
+
+							switch (kind) {
+								case TokenProduction.SPECIAL:
+									hasSkipActions |= (actions[curRE.Ordinal] != null) ||
+									                  (newLexState[curRE.Ordinal] != null);
+									hasSpecial = true;
+									toSpecial[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
+									toSkip[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
+									break;
+								case TokenProduction.SKIP:
+									hasSkipActions |= (actions[curRE.Ordinal] != null);
+									hasSkip = true;
+									toSkip[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
+									break;
+								case TokenProduction.MORE:
+									hasMoreActions |= (actions[curRE.Ordinal] != null);
+									hasMore = true;
+									toMore[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
+
+									if (newLexState[curRE.Ordinal] != null)
+										canReachOnMore[GetIndex(newLexState[curRE.Ordinal])] = true;
+									else
+										canReachOnMore[lexStateIndex] = true;
+
+									break;
+								case TokenProduction.TOKEN:
+									hasTokenActions |= (actions[curRE.Ordinal] != null);
+									toToken[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
+									break;
+							}
 						}
+					}
 
-						if (kinds.Length < curRE.Ordinal) {
-							int[] tmp = new int[curRE.Ordinal + 1];
+					using (GenerationStats.Begin("NfaState.MergeEquivalentStates")) {
+						NfaState.MergeEquivalentStates(initialState, singlesToSkip[lexStateIndex]);
+					}
 
-							Array.Copy(kinds, 0, tmp, 0, kinds.Length);
-							kinds = tmp;
-						}
-						//System.out.println("   ordina : " + curRE.ordinal);
-
-						kinds[curRE.Ordinal] = kind;
-
-						if (respec.NextState != null &&
-						    !respec.NextState.Equals(lexStateName[lexStateIndex]))
-							newLexState[curRE.Ordinal] = respec.NextState;
-
-						if (respec.Action != null && respec.Action.ActionTokens != null &&
-						    respec.Action.ActionTokens.Count > 0)
-							actions[curRE.Ordinal] = respec.Action;
-
-						switch (kind) {
-							case TokenProduction.SPECIAL:
-								hasSkipActions |= (actions[curRE.Ordinal] != null) ||
-								                  (newLexState[curRE.Ordinal] != null);
-								hasSpecial = true;
-								toSpecial[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
-								toSkip[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
-								break;
-							case TokenProduction.SKIP:
-								hasSkipActions |= (actions[curRE.Ordinal] != null);
-								hasSkip = true;
-								toSkip[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
-								break;
-							case TokenProduction.MORE:
-								hasMoreActions |= (actions[curRE.Ordinal] != null);
-								hasMore = true;
-								toMore[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
-
-								if (newLexState[curRE.Ordinal] != null)
-									canReachOnMore[GetIndex(newLexState[curRE.Ordinal])] = true;
-								else
-									canReachOnMore[lexStateIndex] = true;
-
-								break;
-							case TokenProduction.TOKEN:
-								hasTokenActions |= (actions[curRE.Ordinal] != null);
-								toToken[curRE.Ordinal/64] |= 1L << (curRE.Ordinal%64);
-								break;
-						}
+					// Generate a static block for initializing the nfa transitions
+					using (GenerationStats.Begin("NfaState.ComputeClosures")) {
+						NfaState.ComputeClosures();
 					}
-				}
 
-				// Generate a static block for initializing the nfa transitions
-				NfaState.ComputeClosures();
+					for (i = 0; i < initialState.epsilonMoves.Count; i++)
+						initialState.epsilonMoves[i].GenerateCode();
 
-				for (i = 0; i < initialState.epsilonMoves.Count; i++)
-					initialState.epsilonMoves[i].GenerateCode();
+					if (hasNfa[lexStateIndex] = (NfaState.generatedStates != 0)) {
+						initialState.GenerateCode();
+						initialState.GenerateInitMoves(ostr);
+					}
 
-				if (hasNfa[lexStateIndex] = (NfaState.generatedStates != 0)) {
-					initialState.GenerateCode();
-					initialState.GenerateInitMoves(ostr);
-				}
+					if (initialState.kind != Int32.MaxValue && initialState.kind != 0) {
+						if ((toSkip[initialState.kind/64] & (1L << initialState.kind)) != 0L ||
+						    (toSpecial[initialState.kind/64] & (1L << initialState.kind)) != 0L)
+							hasSkipActions = true;
+						else if ((toMore[initialState.kind/64] & (1L << initialState.kind)) != 0L)
+							hasMoreActions = true;
+						else
+							hasTokenActions = true;
+
+						if (initMatch[lexStateIndex] == 0 ||
+						    initMatch[lexStateIndex] > initialState.kind) {
+							initMatch[lexStateIndex] = initialState.kind;
+							hasEmptyMatch = true;
+						}
+					} else if (initMatch[lexStateIndex] == 0)
+						initMatch[lexStateIndex] = Int32.MaxValue;
 
-				if (initialState.kind != Int32.MaxValue && initialState.kind != 0) {
-					if ((toSkip[initialState.kind/64] & (1L << initialState.kind)) != 0L ||
-					    (toSpecial[initialState.kind/64] & (1L << initialState.kind)) != 0L)
-						hasSkipActions = true;
-					else if ((toMore[initialState.kind/64] & (1L << initialState.kind)) != 0L)
-						hasMoreActions = true;
-					else
-						hasTokenActions = true;
-
-					if (initMatch[lexStateIndex] == 0 ||
-					    initMatch[lexStateIndex] > initialState.kind) {
-						initMatch[lexStateIndex] = initialState.kind;
-						hasEmptyMatch = true;
-					}
-				} else if (initMatch[lexStateIndex] == 0)
-					initMatch[lexStateIndex] = Int32.MaxValue;
+					RStringLiteral.FillSubString();
 
-				RStringLiteral.FillSubString();
+					if (hasNfa[lexStateIndex] && !mixed[lexStateIndex])
+						RStringLiteral.GenerateNfaStartStates(ostr, initialState);
 
-				if (hasNfa[lexStateIndex] && !mixed[lexStateIndex])
-					RStringLiteral.GenerateNfaStartStates(ostr, initialState);
+					RStringLiteral.DumpDfaCode(ostr);
 
-				RStringLiteral.DumpDfaCode(ostr);
+					if (hasNfa[lexStateIndex])
+						NfaState.DumpMoveNfa(ostr);
 
-				if (hasNfa[lexStateIndex])
-					NfaState.DumpMoveNfa(ostr);
+					KeywordGen.DumpKeywordKind(ostr);
 
-				if (stateSetSize < NfaState.generatedStates)
-					stateSetSize = NfaState.generatedStates;
+					if (stateSetSize < NfaState.generatedStates)
+						stateSetSize = NfaState.generatedStates;
+
+					GenerationStats.Add("NFA states", NfaState.generatedStates);
+					GenerationStats.Add("Composite state sets", NfaState.CompositeStateSets);
+				}
 			}
 
 			for (i = 0; i < choices.Count; i++)
@@ -482,7 +517,15 @@ namespace Deveel.CSharpCC.Parser {
 			RStringLiteral.DumpStrLiteralImages(ostr);
 			DumpStaticVarDeclarations();
 			DumpFillToken();
-			DumpGetNextToken();
+			DumpGetNextToken(false);
+
+			if (kindScanner) {
+				DumpLexicalActionKinds();
+				DumpGetNextToken(true);
+			}
+
+			if (profile)
+				DumpProfile();
 
 			if (Options.getDebugTokenManager()) {
 				NfaState.DumpStatesForKind(ostr);
@@ -509,6 +552,8 @@ namespace Deveel.CSharpCC.Parser {
 				ostr.WriteLine("}");
 				
 			ostr.Close();
+
+			MethodSize.CheckFile(Path.Combine(Options.getOutputDirectory().FullName, tokMgrClassName + ".cs"));
 		}
 
 		private static void CheckEmptyStringMatch() {
@@ -617,7 +662,7 @@ namespace Deveel.CSharpCC.Parser {
 
             if (hasSkip || hasMore || hasSpecial) {
                 // Bit vector for TOKEN
-                ostr.Write("static readonly long[] ccToToken = {");
+                ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccToToken") + "{");
                 for (i = 0; i < maxOrdinal/64 + 1; i++) {
                     if (i%4 == 0)
                         ostr.WriteLine("   ");
@@ -629,7 +674,7 @@ namespace Deveel.CSharpCC.Parser {
 
             if (hasSkip || hasSpecial) {
                 // Bit vector for SKIP
-                ostr.Write("static readonly long[] ccToSkip = {");
+                ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccToSkip") + "{");
                 for (i = 0; i < maxOrdinal/64 + 1; i++) {
                     if (i%4 == 0)
                         ostr.WriteLine("   ");
@@ -641,7 +686,7 @@ namespace Deveel.CSharpCC.Parser {
 
             if (hasSpecial) {
                 // Bit vector for SPECIAL
-                ostr.Write("static readonly long[] ccToSpecial = {");
+                ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccToSpecial") + "{");
                 for (i = 0; i < maxOrdinal/64 + 1; i++) {
                     if (i%4 == 0)
                         ostr.WriteLine("   ");
@@ -653,7 +698,7 @@ namespace Deveel.CSharpCC.Parser {
 
             if (hasMore) {
                 // Bit vector for MORE
-                ostr.Write("static readonly long[] ccToMore = {");
+                ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccToMore") + "{");
                 for (i = 0; i < maxOrdinal/64 + 1; i++) {
                     if (i%4 == 0)
                         ostr.WriteLine("   ");
@@ -674,6 +719,11 @@ namespace Deveel.CSharpCC.Parser {
             }
 
             ostr.WriteLine("internal {0}{1} inputStream;", staticString, charStreamName);
+            if (hasMoreActions || hasSkipActions || hasTokenActions ||
+                (CSharpCCGlobals.token_mgr_decls != null && CSharpCCGlobals.token_mgr_decls.Count > 0)) {
+                // The name the lexical actions of the grammars written for JavaCC use.
+                ostr.WriteLine("internal {0}{1} input_stream {{ get {{ return inputStream; }} }}", staticString, charStreamName);
+            }
 
             ostr.WriteLine("private {0}readonly int[] ccRounds = new int[{1}];", staticString, stateSetSize);
             ostr.WriteLine("private {0}readonly int[] ccStateSet = new int[{1}];", staticString, (2 * stateSetSize));
@@ -770,16 +820,114 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("      curLexState = lexState;");
             ostr.WriteLine("}");
 
+            ostr.WriteLine("");
+            ostr.WriteLine("// Gets the current lex state.");
+            ostr.WriteLine("public " + staticString + "int LexicalState {");
+            ostr.WriteLine("   get { return curLexState; }");
+            ostr.WriteLine("}");
+
+            if (internImages) {
+                ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccInternKinds") + "{");
+                for (i = 0; i < internKinds.Length; i++) {
+                    if (i%4 == 0)
+                        ostr.Write("\n   ");
+                    ostr.Write("0x" + internKinds[i].ToString("x") + "L, ");
+                }
+                ostr.WriteLine("\n};");
+                ostr.WriteLine(staticString + "NameTable ccNames = new NameTable();");
+                ostr.WriteLine("");
+                ostr.WriteLine("// Gets or sets the table sharing the images of the interned token kinds.");
+                ostr.WriteLine("public " + staticString + "NameTable Names {");
+                ostr.WriteLine("   get { return ccNames; }");
+                ostr.WriteLine("   set {");
+                ostr.WriteLine("      if (value == null)");
+                ostr.WriteLine("         throw new ArgumentNullException(\"value\");");
+                ostr.WriteLine("      ccNames = value;");
+                ostr.WriteLine("   }");
+                ostr.WriteLine("}");
+            }
+
+            if (typedValues) {
+                long[] kindsWithValues = new long[maxOrdinal/64 + 1];
+                for (i = 0; i < maxOrdinal; i++) {
+                    if (valueKinds[i] != null)
+                        kindsWithValues[i/64] |= 1L << (i%64);
+                }
+
+                ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccValueKinds") + "{");
+                for (i = 0; i < kindsWithValues.Length; i++) {
+                    if (i%4 == 0)
+                        ostr.Write("\n   ");
+                    ostr.Write("0x" + kindsWithValues[i].ToString("x") + "L, ");
+                }
+                ostr.WriteLine("\n};");
+            }
+
             ostr.WriteLine();
         }
 
         private static void DumpFillToken() {
             double tokenVersion = CSharpFiles.GetVersion("Token.cs");
             bool hasBinaryNewToken = tokenVersion > 4.09;
+            string getImage = "inputStream.GetImage()";
+            if (internImages)
+                getImage = "((ccInternKinds[ccMatchedKind >> 6] & (1L << (ccMatchedKind & 63))) != 0L ? " +
+                           "inputStream.GetImage(ccNames) : inputStream.GetImage())";
+
+            bool countLexed = InstrumentGen.Enabled && !Options.getUserCharStream() && !Options.getUnicodeEscape();
+            if (countLexed) {
+                ostr.WriteLine("int ccLexedMark;");
+                ostr.WriteLine("long ccLexedCount;");
+                ostr.WriteLine("");
+                ostr.WriteLine("// Counts the characters read since the previous token, in batches.");
+                ostr.WriteLine("void ccCountLexed()");
+                ostr.WriteLine("{");
+                ostr.WriteLine("   int offset = inputStream.EndOffset;");
+                ostr.WriteLine("   if (offset < ccLexedMark)");
+                ostr.WriteLine("      ccLexedMark = 0;");
+                ostr.WriteLine("   ccLexedCount += offset - ccLexedMark;");
+                ostr.WriteLine("   ccLexedMark = offset;");
+                ostr.WriteLine("   if (ccLexedCount >= 4096 || ccMatchedKind == 0) {");
+                ostr.WriteLine("      " + InstrumentGen.ClassName + ".Log.Lexed(ccLexedCount);");
+                ostr.WriteLine("      ccLexedCount = 0;");
+                ostr.WriteLine("   }");
+                ostr.WriteLine("}");
+                ostr.WriteLine("");
+            }
+
+            if (typedValues)
+                DumpNewValueToken();
 
             ostr.Write("internal {0}Token ccFillToken()", staticString);
             ostr.WriteLine("{");
             ostr.WriteLine("   Token t;");
+            if (countLexed)
+                ostr.WriteLine("   ccCountLexed();");
+
+            if (typedValues) {
+                // The value is decoded from the buffer of the stream: the image is only
+                // made if the token is asked for it.
+                ostr.WriteLine("   if (" + (hasEmptyMatch ? "ccMatchedPos >= 0 && " : "") +
+                               "(ccValueKinds[ccMatchedKind >> 6] & (1L << (ccMatchedKind & 63))) != 0L) {");
+                // A number beyond the range of its kind is a lexical error of the input.
+                ostr.WriteLine("      try {");
+                ostr.WriteLine("         t = ccNewValueToken();");
+                ostr.WriteLine("      } catch (System.OverflowException) {");
+                ostr.WriteLine("         throw new TokenManagerError(\"Lexical error at line \" + inputStream.BeginLine + \", column \" + " +
+                               "inputStream.BeginColumn + \".  The value of \\\"\" + TokenManagerError.AddEscapes(inputStream.GetImage()) + " +
+                               "\"\\\" is out of the range of its kind.\", TokenManagerError.LEXICAL_ERROR);");
+                ostr.WriteLine("      }");
+                if (keepLineCol) {
+                    ostr.WriteLine("      t.BeginLine = inputStream.BeginLine;");
+                    ostr.WriteLine("      t.BeginColumn = inputStream.BeginColumn;");
+                    ostr.WriteLine("      t.EndLine = inputStream.EndLine;");
+                    ostr.WriteLine("      t.EndColumn = inputStream.EndColumn;");
+                }
+                ostr.WriteLine("      return t;");
+                ostr.WriteLine("   }");
+                ostr.WriteLine("");
+            }
+
             ostr.WriteLine("   string curTokenImage;");
             if (keepLineCol) {
                 ostr.WriteLine("   int beginLine;");
@@ -802,7 +950,7 @@ namespace Deveel.CSharpCC.Parser {
 
                 ostr.WriteLine("   } else {");
                 ostr.WriteLine("      string im = ccStrLiteralImages[ccMatchedKind];");
-                ostr.WriteLine("      curTokenImage = (im == null) ? inputStream.GetImage() : im;");
+                ostr.WriteLine("      curTokenImage = (im == null) ? " + getImage + " : im;");
 
                 if (keepLineCol) {
                     ostr.WriteLine("      beginLine = inputStream.BeginLine;");
@@ -814,7 +962,7 @@ namespace Deveel.CSharpCC.Parser {
                 ostr.WriteLine("   }");
             } else {
                 ostr.WriteLine("   string im = ccStrLiteralImages[ccMatchedKind];");
-                ostr.WriteLine("   curTokenImage = (im == null) ? inputStream.GetImage() : im;");
+                ostr.WriteLine("   curTokenImage = (im == null) ? " + getImage + " : im;");
                 if (keepLineCol) {
                     ostr.WriteLine("   beginLine = inputStream.BeginLine;");
                     ostr.WriteLine("   beginColumn = inputStream.BeginColumn;");
@@ -846,24 +994,174 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("}");
         }
 
-        private static void DumpGetNextToken() {
-            int i;
+        private static void DumpNewValueToken() {
+            // The image is only kept if the value is not written as it was read.
+            ostr.WriteLine("// Makes the token of a kind listed in TOKEN_VALUES, with its value.");
+            ostr.Write("{0}Token ccNewValueToken()", staticString);
+            ostr.WriteLine("{");
+            ostr.WriteLine("   bool canonical;");
+            ostr.WriteLine("   switch (ccMatchedKind)");
+            ostr.WriteLine("   {");
+            for (int i = 0; i < maxOrdinal; i++) {
+                if (valueKinds[i] == null)
+                    continue;
 
+                ostr.WriteLine("      case " + i + ":");
+                const string image = "canonical ? null : inputStream.GetImage()";
+                switch (valueKinds[i]) {
+                    case "int":
+                        ostr.WriteLine("         return new ValueToken<int>(" + i + ", checked((int) inputStream.DecodeInt64(out canonical)), " +
+                                       image + ");");
+                        break;
+                    case "long":
+                        ostr.WriteLine("         return new ValueToken<long>(" + i + ", inputStream.DecodeInt64(out canonical), " + image + ");");
+                        break;
+                    case "double":
+                        ostr.WriteLine("         return new ValueToken<double>(" + i + ", inputStream.DecodeDouble(out canonical), " + image + ");");
+                        break;
+                    case "decimal":
+                        ostr.WriteLine("         return new ValueToken<decimal>(" + i + ", inputStream.DecodeDecimal(out canonical), " + image + ");");
+                        break;
+                    default:
+                        string backslash = valueKinds[i] == "string" ? "true" : "false";
+                        ostr.WriteLine("         return new QuotedToken(" + i + ", inputStream.DecodeQuoted(" + backslash +
+                                       ", out canonical), inputStream.ImageChar(0), " + image + ");");
+                        break;
+                }
+            }
+            ostr.WriteLine("      default:");
+            ostr.WriteLine("         return null;");
+            ostr.WriteLine("   }");
+            ostr.WriteLine("}");
             ostr.WriteLine("");
-            ostr.WriteLine(staticString + "int curLexState = " + defaultLexState + ";");
-            ostr.WriteLine(staticString + "int defaultLexState = " + defaultLexState + ";");
-            ostr.WriteLine(staticString + "int ccNewStateCnt;");
-            ostr.WriteLine(staticString + "int ccRound;");
-            ostr.WriteLine(staticString + "int ccMatchedPos;");
-            ostr.WriteLine(staticString + "int ccMatchedKind;");
+        }
+
+        // The value kind of the tokens listed in option TOKEN_VALUES, by ordinal,
+        // or null if there is none.
+        private static string[] GetValueKinds() {
+            string[] kindsOfValues = null;
+            foreach (string entry in Options.getTokenValues().Split(',')) {
+                if (entry.Trim().Length == 0)
+                    continue;
+
+                int colon = entry.IndexOf(':');
+                string label = (colon < 0 ? entry : entry.Substring(0, colon)).Trim();
+                string kind = colon < 0 ? "" : entry.Substring(colon + 1).Trim().ToLower();
+
+                RegularExpression re;
+                if (kind != "int" && kind != "long" && kind != "double" && kind != "decimal" &&
+                    kind != "string" && kind != "verbatim") {
+                    CSharpCCErrors.Warning("Token value \"" + entry.Trim() + "\" has no kind among int, long, double, " +
+                                           "decimal, string and verbatim, and will be ignored.");
+                } else if (!CSharpCCGlobals.named_tokens_table.TryGetValue(label, out re) || re.IsPrivate) {
+                    CSharpCCErrors.Warning("Token value \"" + label + "\" is not a token label and will be ignored.");
+                } else if (re.TokenProductionContext.Kind != TokenProduction.TOKEN &&
+                           re.TokenProductionContext.Kind != TokenProduction.SPECIAL) {
+                    CSharpCCErrors.Warning(re, "Token value \"" + label + "\" has no image and will be ignored.");
+                } else if (re is RStringLiteral) {
+                    CSharpCCErrors.Warning(re, "Token value \"" + label + "\" is a string literal and will be ignored.");
+                } else {
+                    if (kindsOfValues == null)
+                        kindsOfValues = new string[maxOrdinal];
+                    kindsOfValues[re.Ordinal] = kind;
+                }
+            }
+
+            if (kindsOfValues != null && (Options.getUserCharStream() || Options.getUnicodeEscape())) {
+                CSharpCCErrors.Warning("Option TOKEN_VALUES is ignored since it requires the generated SimpleCharStream.");
+                return null;
+            }
+
+            return kindsOfValues;
+        }
+
+        // The kinds listed in option INTERN_TOKENS, or null if there is none.
+        private static long[] GetInternKinds() {
+            long[] internKinds = null;
+            foreach (string name in Options.getInternTokens().Split(',')) {
+                string label = name.Trim();
+                if (label.Length == 0)
+                    continue;
+
+                RegularExpression re;
+                if (!CSharpCCGlobals.named_tokens_table.TryGetValue(label, out re) || re.IsPrivate) {
+                    CSharpCCErrors.Warning("Interned token \"" + label + "\" is not a token label and will be ignored.");
+                } else if (re.TokenProductionContext.Kind != TokenProduction.TOKEN &&
+                           re.TokenProductionContext.Kind != TokenProduction.SPECIAL) {
+                    CSharpCCErrors.Warning(re, "Interned token \"" + label + "\" has no image and will be ignored.");
+                } else if (re is RStringLiteral) {
+                    CSharpCCErrors.Warning(re, "Interned token \"" + label + "\" is a string literal: its image is already shared.");
+                } else {
+                    if (internKinds == null)
+                        internKinds = new long[maxOrdinal/64 + 1];
+                    internKinds[re.Ordinal/64] |= 1L << (re.Ordinal%64);
+                }
+            }
+
+            if (internKinds != null && (Options.getUserCharStream() || Options.getUnicodeEscape())) {
+                CSharpCCErrors.Warning("Option INTERN_TOKENS is ignored since it requires the generated SimpleCharStream.");
+                return null;
+            }
+
+            return internKinds;
+        }
+
+        // Kinds having a case in one of the lexical action methods: the kind
+        // scanner only builds a token for those.
+        private static void DumpLexicalActionKinds() {
+            if (!hasSkipActions && !hasTokenActions)
+                return;
+
+            long[] kindsWithActions = new long[maxOrdinal/64 + 1];
+            for (int i = 0; i < maxOrdinal; i++) {
+                if ((actions[i] != null && actions[i].ActionTokens != null && actions[i].ActionTokens.Count > 0) ||
+                    (initMatch[lexStates[i]] == i && canLoop[lexStates[i]]))
+                    kindsWithActions[i/64] |= 1L << (i%64);
+            }
+
+            ostr.Write(CSharpCCGlobals.TableDeclaration("static", "long", "ccLexicalActionKinds") + "{");
+            for (int i = 0; i < kindsWithActions.Length; i++) {
+                if (i%4 == 0)
+                    ostr.Write("\n   ");
+                ostr.Write("0x" + kindsWithActions[i].ToString("x") + "L, ");
+            }
+            ostr.WriteLine("\n};");
+        }
+
+        private static void DumpGetNextToken(bool kindOnly) {
+            int i;
+            // The scanner needs a token only to run the lexical actions on it.
+            bool tokenForActions = kindOnly && hasTokenActions && !Options.getCommonTokenAction();
+            bool tokenForSkipActions = kindOnly && hasSpecial && hasSkipActions;
+            bool tokenForEof = CSharpCCGlobals.nextStateForEof != null ||
+                               CSharpCCGlobals.actForEof != null ||
+                               Options.getCommonTokenAction();
+
             ostr.WriteLine("");
-            ostr.WriteLine("// Get the next Token.");
-            ostr.WriteLine("public " + staticString + "Token GetNextToken() ");
-            ostr.WriteLine("{");
-            if (hasSpecial) {
-                ostr.WriteLine("  Token specialToken = null;");
+            if (kindOnly) {
+                ostr.WriteLine("// Get the kind of the next token, with the offset and the length of its text in the");
+                ostr.WriteLine("// input, without building a Token: special tokens are skipped and a Token is only");
+                ostr.WriteLine("// created for the kinds having a lexical action.");
+                ostr.WriteLine("public " + staticString + "int NextTokenKind(out int start, out int length) ");
+                ostr.WriteLine("{");
+                if (tokenForEof || tokenForActions)
+                    ostr.WriteLine("  Token matchedToken;");
+            } else {
+                ostr.WriteLine(staticString + "int curLexState = " + defaultLexState + ";");
+                ostr.WriteLine(staticString + "int defaultLexState = " + defaultLexState + ";");
+                ostr.WriteLine(staticString + "int ccNewStateCnt;");
+                ostr.WriteLine(staticString + "int ccRound;");
+                ostr.WriteLine(staticString + "int ccMatchedPos;");
+                ostr.WriteLine(staticString + "int ccMatchedKind;");
+                ostr.WriteLine("");
+                ostr.WriteLine("// Get the next Token.");
+                ostr.WriteLine("public " + staticString + "Token GetNextToken() ");
+                ostr.WriteLine("{");
+                if (hasSpecial) {
+                    ostr.WriteLine("  Token specialToken = null;");
+                }
+                ostr.WriteLine("  Token matchedToken;");
             }
-            ostr.WriteLine("  Token matchedToken;");
             ostr.WriteLine("  int curPos = 0;");
             ostr.WriteLine("");
             // OLD: ostr.WriteLine("  EOFLoop :\n  for (;;)");
@@ -876,19 +1174,28 @@ namespace Deveel.CSharpCC.Parser {
                 ostr.WriteLine("      debugStream.WriteLine(\"Returning the <EOF> token.\");");
 
             ostr.WriteLine("      ccMatchedKind = 0;");
-            ostr.WriteLine("      matchedToken = ccFillToken();");
+            if (kindOnly) {
+                ostr.WriteLine("      start = inputStream.BeginOffset;");
+                ostr.WriteLine("      length = 0;");
+            }
 
-            if (hasSpecial)
-                ostr.WriteLine("      matchedToken.SpecialToken = specialToken;");
+            if (!kindOnly || tokenForEof) {
+                ostr.WriteLine("      matchedToken = ccFillToken();");
 
-            if (CSharpCCGlobals.nextStateForEof != null ||
-                CSharpCCGlobals.actForEof != null)
-                ostr.WriteLine("      TokenLexicalActions(matchedToken);");
+                if (hasSpecial && !kindOnly)
+                    ostr.WriteLine("      matchedToken.SpecialToken = specialToken;");
 
-            if (Options.getCommonTokenAction())
-                ostr.WriteLine("      CommonTokenAction(matchedToken);");
+                if (CSharpCCGlobals.nextStateForEof != null ||
+                    CSharpCCGlobals.actForEof != null)
+                    ostr.WriteLine("      TokenLexicalActions(matchedToken);");
 
-            ostr.WriteLine("      return matchedToken;");
+                if (Options.getCommonTokenAction())
+                    ostr.WriteLine("      CommonTokenAction(matchedToken);");
+
+                ostr.WriteLine(kindOnly ? "      return matchedToken.Kind;" : "      return matchedToken;");
+            } else {
+                ostr.WriteLine("      return 0;");
+            }
             ostr.WriteLine("   }");
 
             if (hasMoreActions || hasSkipActions || hasTokenActions) {
@@ -928,14 +1235,14 @@ namespace Deveel.CSharpCC.Parser {
                         singlesToSkip[i].asciiMoves[1] != 0L) {
                         ostr.WriteLine(prefix + "   while ((curChar < 64 && ({0}L & (1L << curChar)) != 0L) ||",
                             (singlesToSkip[i].asciiMoves[0]));
-                        ostr.WriteLine(prefix + "          (curChar >> 6) == 1 && ({0}L & (1L << (curChar & 077))) != 0L)",
+                        ostr.WriteLine(prefix + "          (curChar >> 6) == 1 && ({0}L & (1L << (curChar & 63))) != 0L)",
                             (singlesToSkip[i].asciiMoves[1]));
                     } else if (singlesToSkip[i].asciiMoves[1] == 0L) {
                         ostr.WriteLine(prefix + "   while (curChar <= {0} && ({1}L & (1L << curChar)) != 0L)",
                             MaxChar(singlesToSkip[i].asciiMoves[0]),
                             singlesToSkip[i].asciiMoves[0]);
                     } else if (singlesToSkip[i].asciiMoves[0] == 0L) {
-                        ostr.WriteLine(prefix + "   while (curChar > 63 && curChar <= {0}  && ({1}L & (1L << (curChar & 077))) != 0L)",
+                        ostr.WriteLine(prefix + "   while (curChar > 63 && curChar <= {0}  && ({1}L & (1L << (curChar & 63))) != 0L)",
                             (MaxChar(singlesToSkip[i].asciiMoves[1]) + 64),
                             (singlesToSkip[i].asciiMoves[1]));
                     }
@@ -1014,19 +1321,32 @@ namespace Deveel.CSharpCC.Parser {
             if (maxLexStates > 0) {
                 ostr.WriteLine(prefix + "   if (ccMatchedKind != Int32.MaxValue)");
                 ostr.WriteLine(prefix + "   {");
+                if (profile)
+                    ostr.WriteLine(prefix + "      ccProfileChars[curLexState] += ccMatchedPos + 1;");
                 ostr.WriteLine(prefix + "      if (ccMatchedPos + 1 < curPos)");
 
-                if (Options.getDebugTokenManager()) {
+                if (Options.getDebugTokenManager() || profile)
                     ostr.WriteLine(prefix + "      {");
+
+                if (profile) {
+                    ostr.WriteLine(prefix + "         ccProfileBackups[curLexState]++;");
+                    ostr.WriteLine(prefix + "         ccProfileBackupChars[curLexState] += curPos - ccMatchedPos - 1;");
+                }
+
+                if (Options.getDebugTokenManager()) {
                     ostr.WriteLine(prefix + "         debugStream.WriteLine(" +
                                    "\"   Putting back \" + (curPos - ccMatchedPos - 1) + \" characters into the input stream.\");");
                 }
 
                 ostr.WriteLine(prefix + "         inputStream.Backup(curPos - ccMatchedPos - 1);");
 
-                if (Options.getDebugTokenManager())
+                if (Options.getDebugTokenManager() || profile)
                     ostr.WriteLine(prefix + "      }");
 
+                KeywordGen.DumpClassification(ostr, prefix + "      ", maxLexStates > 1);
+                if (profile)
+                    ostr.WriteLine(prefix + "      ccProfileTokens[ccMatchedKind]++;");
+
                 if (Options.getDebugTokenManager()) {
                     if (Options.getUnicodeEscape() ||
                         Options.getUserCharStream())
@@ -1042,17 +1362,34 @@ namespace Deveel.CSharpCC.Parser {
                 }
 
                 if (hasSkip || hasMore || hasSpecial) {
-                    ostr.WriteLine(prefix + "      if ((ccToToken[ccMatchedKind >> 6] & " + "(1L << (ccMatchedKind & 077))) != 0L)");
+                    ostr.WriteLine(prefix + "      if ((ccToToken[ccMatchedKind >> 6] & " + "(1L << (ccMatchedKind & 63))) != 0L)");
                     ostr.WriteLine(prefix + "      {");
                 }
 
-                ostr.WriteLine(prefix + "         matchedToken = ccFillToken();");
-
-                if (hasSpecial)
-                    ostr.WriteLine(prefix + "         matchedToken.SpecialToken = specialToken;");
+                if (kindOnly) {
+                    ostr.WriteLine(prefix + "         start = inputStream.BeginOffset;");
+                    if (hasEmptyMatch)
+                        ostr.WriteLine(prefix + "         length = ccMatchedPos < 0 ? 0 : inputStream.EndOffset - start;");
+                    else
+                        ostr.WriteLine(prefix + "         length = inputStream.EndOffset - start;");
+                }
 
-                if (hasTokenActions)
-                    ostr.WriteLine(prefix + "         TokenLexicalActions(matchedToken);");
+                if (tokenForActions) {
+                    ostr.WriteLine(prefix + "         matchedToken = null;");
+                    ostr.WriteLine(prefix + "         if ((ccLexicalActionKinds[ccMatchedKind >> 6] & (1L << (ccMatchedKind & 63))) != 0L)");
+                    ostr.WriteLine(prefix + "         {");
+                    ostr.WriteLine(prefix + "            matchedToken = ccFillToken();");
+                    ostr.WriteLine(prefix + "            TokenLexicalActions(matchedToken);");
+                    ostr.WriteLine(prefix + "         }");
+                } else if (!kindOnly || Options.getCommonTokenAction()) {
+                    ostr.WriteLine(prefix + "         matchedToken = ccFillToken();");
+
+                    if (hasSpecial && !kindOnly)
+                        ostr.WriteLine(prefix + "         matchedToken.SpecialToken = specialToken;");
+
+                    if (hasTokenActions)
+                        ostr.WriteLine(prefix + "         TokenLexicalActions(matchedToken);");
+                }
 
                 if (maxLexStates > 1) {
                     ostr.WriteLine("       if (ccNewLexState[ccMatchedKind] != -1)");
@@ -1062,7 +1399,14 @@ namespace Deveel.CSharpCC.Parser {
                 if (Options.getCommonTokenAction())
                     ostr.WriteLine(prefix + "         CommonTokenAction(matchedToken);");
 
-                ostr.WriteLine(prefix + "         return matchedToken;");
+                if (!kindOnly)
+                    ostr.WriteLine(prefix + "         return matchedToken;");
+                else if (tokenForActions)
+                    ostr.WriteLine(prefix + "         return matchedToken == null ? ccMatchedKind : matchedToken.Kind;");
+                else if (Options.getCommonTokenAction())
+                    ostr.WriteLine(prefix + "         return matchedToken.Kind;");
+                else
+                    ostr.WriteLine(prefix + "         return ccMatchedKind;");
 
                 if (hasSkip || hasMore || hasSpecial) {
                     ostr.WriteLine(prefix + "      }");
@@ -1070,15 +1414,19 @@ namespace Deveel.CSharpCC.Parser {
                     if (hasSkip || hasSpecial) {
                         if (hasMore) {
                             ostr.WriteLine(prefix + "      else if ((ccToSkip[ccMatchedKind >> 6] & " +
-                                           "(1L << (ccMatchedKind & 077))) != 0L)");
+                                           "(1L << (ccMatchedKind & 63))) != 0L)");
                         } else
                             ostr.WriteLine(prefix + "      else");
 
                         ostr.WriteLine(prefix + "      {");
 
-                        if (hasSpecial) {
+                        if (tokenForSkipActions) {
+                            ostr.WriteLine(prefix + "         if ((ccLexicalActionKinds[ccMatchedKind >> 6] & (1L << (ccMatchedKind & 63))) != 0L)");
+                            ostr.WriteLine(prefix + "            SkipLexicalActions((ccToSpecial[ccMatchedKind >> 6] & " +
+                                           "(1L << (ccMatchedKind & 63))) != 0L ? ccFillToken() : null);");
+                        } else if (hasSpecial && !kindOnly) {
                             ostr.WriteLine(prefix + "         if ((ccToSpecial[ccMatchedKind >> 6] & " +
-                                           "(1L << (ccMatchedKind & 077))) != 0L)");
+                                           "(1L << (ccMatchedKind & 63))) != 0L)");
                             ostr.WriteLine(prefix + "         {");
 
                             ostr.WriteLine(prefix + "            matchedToken = ccFillToken();");
@@ -1175,11 +1523,69 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("");
         }
 
+        private static void DumpActionProfileStart() {
+            ostr.WriteLine("   long ccActionStart = System.Diagnostics.Stopwatch.GetTimestamp();");
+            ostr.WriteLine("   try {");
+        }
+
+        private static void DumpActionProfileEnd() {
+            ostr.WriteLine("   } finally {");
+            ostr.WriteLine("      ccProfileActions++;");
+            ostr.WriteLine("      ccProfileActionTicks += System.Diagnostics.Stopwatch.GetTimestamp() - ccActionStart;");
+            ostr.WriteLine("   }");
+        }
+
+        private static void DumpProfile() {
+            ostr.WriteLine("");
+            ostr.WriteLine("// Profile counters, by lexical state and by token kind.");
+            ostr.WriteLine("{0}long[] ccProfileChars = new long[{1}];", staticString, maxLexStates);
+            ostr.WriteLine("{0}long[] ccProfileNfaChars = new long[{1}];", staticString, maxLexStates);
+            ostr.WriteLine("{0}long[] ccProfileNfaStates = new long[{1}];", staticString, maxLexStates);
+            ostr.WriteLine("{0}long[] ccProfileBackups = new long[{1}];", staticString, maxLexStates);
+            ostr.WriteLine("{0}long[] ccProfileBackupChars = new long[{1}];", staticString, maxLexStates);
+            ostr.WriteLine("{0}long[] ccProfileTokens = new long[{1}];", staticString, maxOrdinal);
+            ostr.WriteLine("{0}long ccProfileActions;", staticString);
+            ostr.WriteLine("{0}long ccProfileActionTicks;", staticString);
+            ostr.WriteLine("");
+            ostr.WriteLine("// Closes the input stream and writes the profile to the debug output.");
+            ostr.WriteLine("public {0}void Done()", staticString);
+            ostr.WriteLine("{");
+            ostr.WriteLine("   inputStream.Done();");
+            ostr.WriteLine("   WriteProfile(debugStream);");
+            ostr.WriteLine("}");
+            ostr.WriteLine("");
+            ostr.WriteLine("// Writes the characters matched, the NFA states visited per character and the");
+            ostr.WriteLine("// characters put back for every lexical state, the tokens matched for every kind");
+            ostr.WriteLine("// and the time spent in the lexical actions.");
+            ostr.WriteLine("public {0}void WriteProfile(System.IO.TextWriter writer)", staticString);
+            ostr.WriteLine("{");
+            ostr.WriteLine("   System.Globalization.CultureInfo culture = System.Globalization.CultureInfo.InvariantCulture;");
+            ostr.WriteLine("   writer.WriteLine(\"{0,-24} {1,12} {2,12} {3,12} {4,10} {5,12}\",");
+            ostr.WriteLine("      \"Lexical state\", \"Characters\", \"NFA chars\", \"States/char\", \"Backups\", \"Backed up\");");
+            ostr.WriteLine("   for (int i = 0; i < {0}; i++)", maxLexStates);
+            ostr.WriteLine("      writer.WriteLine(String.Format(culture, \"{0,-24} {1,12} {2,12} {3,12:0.00} {4,10} {5,12}\",");
+            ostr.WriteLine("         lexStateNames[i], ccProfileChars[i], ccProfileNfaChars[i],");
+            ostr.WriteLine("         ccProfileNfaChars[i] == 0 ? 0.0 : (double) ccProfileNfaStates[i] / ccProfileNfaChars[i],");
+            ostr.WriteLine("         ccProfileBackups[i], ccProfileBackupChars[i]));");
+            ostr.WriteLine("   writer.WriteLine();");
+            ostr.WriteLine("   writer.WriteLine(\"{0,-37} {1,12}\", \"Token kind\", \"Matches\");");
+            ostr.WriteLine("   for (int i = 0; i < {0}; i++)", maxOrdinal);
+            ostr.WriteLine("      if (ccProfileTokens[i] != 0)");
+            ostr.WriteLine("         writer.WriteLine(String.Format(culture, \"{0,-37} {1,12}\", TokenImage[i], ccProfileTokens[i]));");
+            ostr.WriteLine("   writer.WriteLine();");
+            ostr.WriteLine("   writer.WriteLine(String.Format(culture, \"Lexical actions: {0} calls, {1:0.000} ms\",");
+            ostr.WriteLine("      ccProfileActions, ccProfileActionTicks * 1000.0 / System.Diagnostics.Stopwatch.Frequency));");
+            ostr.WriteLine("   writer.Flush();");
+            ostr.WriteLine("}");
+        }
+
         public static void DumpSkipActions() {
             Action act;
 
             ostr.WriteLine(staticString + "void SkipLexicalActions(Token matchedToken)");
             ostr.WriteLine("{");
+            if (profile)
+                DumpActionProfileStart();
             ostr.WriteLine("   switch(ccMatchedKind)");
             ostr.WriteLine("   {");
 
@@ -1203,9 +1609,9 @@ namespace Deveel.CSharpCC.Parser {
                         ostr.WriteLine("                ccEmptyColNo[" + lexStates[i] + "] == inputStream.BeginColumn)");
                         ostr.WriteLine("               throw new TokenManagerError(" +
                                        "(\"Error: Bailing out of infinite loop caused by repeated empty string matches " +
-                                       "at line \" + input_stream.BeginLine + \", " +
-                                       "column \" + input_stream.BeginColumn + \".\"), TokenManagerError.LOOP_DETECTED);");
-                        ostr.WriteLine("            ccEmptyLineNo[" + lexStates[i] + "] = inpuStream.BeginLine;");
+                                       "at line \" + inputStream.BeginLine + \", " +
+                                       "column \" + inputStream.BeginColumn + \".\"), TokenManagerError.LOOP_DETECTED);");
+                        ostr.WriteLine("            ccEmptyLineNo[" + lexStates[i] + "] = inputStream.BeginLine;");
                         ostr.WriteLine("            ccEmptyColNo[" + lexStates[i] + "] = inputStream.BeginColumn;");
                         ostr.WriteLine("            ccBeenHere[" + lexStates[i] + "] = true;");
                         ostr.WriteLine("         }");
@@ -1241,6 +1647,8 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("      default :");
             ostr.WriteLine("         break;");
             ostr.WriteLine("   }");
+            if (profile)
+                DumpActionProfileEnd();
             ostr.WriteLine("}");
         }
 
@@ -1249,7 +1657,9 @@ namespace Deveel.CSharpCC.Parser {
 
             ostr.WriteLine(staticString + "void MoreLexicalActions()");
             ostr.WriteLine("{");
-            ostr.WriteLine("   jjimageLen += (lengthOfMatch = ccMatchedPos + 1);");
+            if (profile)
+                DumpActionProfileStart();
+            ostr.WriteLine("   ccImageLen += (lengthOfMatch = ccMatchedPos + 1);");
             ostr.WriteLine("   switch(ccMatchedKind)");
             ostr.WriteLine("   {");
 
@@ -1271,7 +1681,7 @@ namespace Deveel.CSharpCC.Parser {
                         ostr.WriteLine("         {");
                         ostr.WriteLine("            if (ccBeenHere[" + lexStates[i] + "] &&");
                         ostr.WriteLine("                ccEmptyLineNo[" + lexStates[i] + "] == inputStream.BeginLine &&");
-                        ostr.WriteLine("                ccEmptyColNo[" + lexStates[i] + "] == input_stream.BeginColumn)");
+                        ostr.WriteLine("                ccEmptyColNo[" + lexStates[i] + "] == inputStream.BeginColumn)");
                         ostr.WriteLine("               throw new TokenManagerError(" +
                                        "(\"Error: Bailing out of infinite loop caused by repeated empty string matches " +
                                        "at line \" + inputStream.BeginLine + \", " +
@@ -1315,6 +1725,8 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("         break;");
 
             ostr.WriteLine("   }");
+            if (profile)
+                DumpActionProfileEnd();
             ostr.WriteLine("}");
         }
 
@@ -1324,6 +1736,8 @@ namespace Deveel.CSharpCC.Parser {
 
             ostr.WriteLine(staticString + "void TokenLexicalActions(Token matchedToken)");
             ostr.WriteLine("{");
+            if (profile)
+                DumpActionProfileStart();
             ostr.WriteLine("   switch(ccMatchedKind)");
             ostr.WriteLine("   {");
 
@@ -1393,6 +1807,8 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("      default :");
             ostr.WriteLine("         break;");
             ostr.WriteLine("   }");
+            if (profile)
+                DumpActionProfileEnd();
             ostr.WriteLine("}");
         }
 
@@ -1403,6 +1819,12 @@ namespace Deveel.CSharpCC.Parser {
             allTpsForState = new Dictionary<string, IList<TokenProduction>>();
             lexStateIndex = 0;
             kinds = null;
+            kindScanner = false;
+            internImages = false;
+            internKinds = null;
+            typedValues = false;
+            valueKinds = null;
+            profile = false;
             maxOrdinal = 1;
             lexStateSuffix = null;
             newLexState = null;
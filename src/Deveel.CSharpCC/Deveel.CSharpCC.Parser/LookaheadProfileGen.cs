@@ -0,0 +1,74 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the lookahead profile of a parser (option <c>PROFILE_LOOKAHEAD</c>),
+	/// that counts for every syntactic lookahead of the grammar the calls, the
+	/// successes and the tokens scanned, and reports them against the location of
+	/// the lookahead in the grammar file.
+	/// </summary>
+	/// <remarks>
+	/// Only the <c>cc_2</c> routines are counted: the scans of the <c>cc_3</c>
+	/// routines they call add to their tokens, and semantic lookaheads are not
+	/// counted.
+	/// </remarks>
+	public class LookaheadProfileGen {
+		private static readonly List<Lookahead> sites = new List<Lookahead>();
+		private static readonly List<string> siteProductions = new List<string>();
+
+		/// <summary>
+		/// The name of the generated profile class.
+		/// </summary>
+		public static string ClassName {
+			get { return CSharpCCGlobals.cu_name + "LookaheadProfile"; }
+		}
+
+		/// <summary>
+		/// Records the lookahead tested by the <c>cc_2</c> routine with the given index,
+		/// in the production with the given name.
+		/// </summary>
+		internal static void AddSite(Lookahead la, string production) {
+			sites.Add(la);
+			siteProductions.Add(production);
+		}
+
+		public static void start() {
+			if (!Options.getProfileLookahead() || !Options.getBuildParser())
+				return;
+
+			StringBuilder productions = new StringBuilder();
+			StringBuilder lines = new StringBuilder();
+			StringBuilder columns = new StringBuilder();
+			for (int i = 0; i < sites.Count; i++) {
+				Lookahead la = sites[i];
+				// Implicit lookaheads have no location of their own.
+				Expansion location = la.Line > 0 ? la : la.Expansion;
+				if (productions.Length > 0) {
+					productions.Append(", ");
+					lines.Append(", ");
+					columns.Append(", ");
+				}
+				productions.Append('"').Append(siteProductions[i]).Append('"');
+				lines.Append(location.Line.ToString(CultureInfo.InvariantCulture));
+				columns.Append(location.Column.ToString(CultureInfo.InvariantCulture));
+			}
+
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["PARSER_NAME"] = CSharpCCGlobals.cu_name;
+			options["GRAMMAR_FILE"] = CSharpCCGlobals.AddEscapes(CSharpCCGlobals.FileName ?? "");
+			options["SITE_PRODUCTIONS"] = productions.ToString();
+			options["SITE_LINES"] = lines.ToString();
+			options["SITE_COLUMNS"] = columns.ToString();
+
+			CSharpFiles.GenerateLookaheadProfile(ClassName + ".cs", options);
+		}
+
+		public static void reInit() {
+			sites.Clear();
+			siteProductions.Clear();
+		}
+	}
+}
@@ -0,0 +1,223 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Estimates the size of the generated methods, so that the generator can
+	/// keep them under the sizes at which the JIT stops optimizing them, and
+	/// warn about the ones it could not split.
+	/// </summary>
+	/// <remarks>
+	/// The estimate is made on the generated C#: about one byte and a half of
+	/// IL for every token, and one basic block for every branch.
+	/// </remarks>
+	public class MethodSize {
+		/// <summary>
+		/// The size in bytes of IL above which the JIT compiles a method without
+		/// optimizations.
+		/// </summary>
+		public const int JitMaxILBytes = 60000;
+
+		/// <summary>
+		/// The number of basic blocks above which the JIT compiles a method
+		/// without optimizations.
+		/// </summary>
+		public const int JitMaxBasicBlocks = 2000;
+
+		private static readonly string[] Branches = { "case", "if", "else", "while", "for", "foreach", "do", "goto", "catch", "return" };
+
+		public MethodSize(string name, string code) {
+			Name = name;
+
+			int tokens = 0;
+			int blocks = 1;
+			Tokenize(code, delegate(string token) {
+				tokens++;
+				if (token == "&&" || token == "||" || token == "?" || Array.IndexOf(Branches, token) >= 0)
+					blocks++;
+			});
+
+			ILBytes = tokens * 3 / 2;
+			BasicBlocks = blocks;
+		}
+
+		public string Name { get; private set; }
+
+		/// <summary>
+		/// The estimated size of the method in bytes of IL.
+		/// </summary>
+		public int ILBytes { get; private set; }
+
+		/// <summary>
+		/// The estimated number of basic blocks of the method.
+		/// </summary>
+		public int BasicBlocks { get; private set; }
+
+		/// <summary>
+		/// Whether the JIT would compile the method without optimizations.
+		/// </summary>
+		public bool OverJitLimits {
+			get { return ILBytes > JitMaxILBytes || BasicBlocks > JitMaxBasicBlocks; }
+		}
+
+		/// <summary>
+		/// Whether generated code is larger than the limit of the option
+		/// <c>MAX_METHOD_SIZE</c>, if any.
+		/// </summary>
+		public static bool ExceedsMaxSize(string code) {
+			int max = Options.getMaxMethodSize();
+			return max > 0 && new MethodSize("", code).ILBytes > max;
+		}
+
+		/// <summary>
+		/// Warns about the methods of a generated file that are still over the
+		/// limits of the JIT.
+		/// </summary>
+		public static void CheckFile(string path) {
+			if (!File.Exists(path))
+				return;
+
+			List<string> over = new List<string>();
+			foreach (MethodSize method in GetMethods(File.ReadAllText(path))) {
+				if (method.OverJitLimits)
+					over.Add(method.Name + " (about " + method.ILBytes + " bytes of IL, " + method.BasicBlocks + " branches)");
+			}
+
+			if (over.Count > 0)
+				CSharpCCErrors.Warning("The JIT will not optimize these methods of " + Path.GetFileName(path) + ": " +
+				                       String.Join(", ", over.ToArray()) + ".");
+		}
+
+		// The methods of a generated file: the blocks whose header ends with a
+		// parameter list and is not a statement, outside of any other method.
+		internal static IList<MethodSize> GetMethods(string code) {
+			List<MethodSize> methods = new List<MethodSize>();
+			StringBuilder header = new StringBuilder();
+			StringBuilder body = null;
+			string name = null;
+			int depth = 0;
+			int bodyDepth = 0;
+
+			Tokenize(code, delegate(string token) {
+				if (body != null) {
+					if (token == "{") {
+						depth++;
+					} else if (token == "}" && --depth == bodyDepth) {
+						methods.Add(new MethodSize(name, body.ToString()));
+						body = null;
+						header.Length = 0;
+						return;
+					}
+					body.Append(token).Append(' ');
+					return;
+				}
+
+				if (token == "{") {
+					name = GetMethodName(header.ToString());
+					if (name != null) {
+						bodyDepth = depth;
+						body = new StringBuilder();
+					}
+					depth++;
+					header.Length = 0;
+				} else if (token == "}" || token == ";") {
+					if (token == "}")
+						depth--;
+					header.Length = 0;
+				} else {
+					header.Append(token).Append(' ');
+				}
+			});
+
+			return methods;
+		}
+
+		private static string GetMethodName(string header) {
+			string[] tokens = header.Trim().Split(' ');
+			if (tokens.Length < 3 || tokens[tokens.Length - 1] != ")")
+				return null;
+
+			// The parameter list, after the arguments of the attributes.
+			int paren = tokens.Length - 1;
+			for (int depth = 0; paren >= 0; paren--) {
+				if (tokens[paren] == ")")
+					depth++;
+				else if (tokens[paren] == "(" && --depth == 0)
+					break;
+			}
+			if (paren < 1 || Array.IndexOf(tokens, "=", 0, paren) >= 0)
+				return null;
+
+			switch (tokens[paren - 1]) {
+				case "if":
+				case "while":
+				case "for":
+				case "foreach":
+				case "switch":
+				case "catch":
+				case "using":
+				case "lock":
+				case "fixed":
+				case "delegate":
+					return null;
+			}
+
+			return tokens[paren - 1];
+		}
+
+		private delegate void TokenHandler(string token);
+
+		// Splits C# code in identifiers, numbers, literals and punctuation,
+		// skipping white space and comments.
+		private static void Tokenize(string code, TokenHandler handler) {
+			int i = 0;
+			while (i < code.Length) {
+				char c = code[i];
+				int start = i;
+
+				if (Char.IsWhiteSpace(c)) {
+					i++;
+					continue;
+				}
+
+				if (c == '/' && i + 1 < code.Length && code[i + 1] == '/') {
+					while (i < code.Length && code[i] != '\n')
+						i++;
+					continue;
+				}
+
+				if (c == '/' && i + 1 < code.Length && code[i + 1] == '*') {
+					int end = code.IndexOf("*/", i + 2, StringComparison.Ordinal);
+					i = end < 0 ? code.Length : end + 2;
+					continue;
+				}
+
+				if (c == '@' && i + 1 < code.Length && code[i + 1] == '"') {
+					i += 2;
+					while (i < code.Length && (code[i] != '"' || i + 1 < code.Length && code[i + 1] == '"'))
+						i += code[i] == '"' ? 2 : 1;
+					i++;
+				} else if (c == '"' || c == '\'') {
+					i++;
+					while (i < code.Length && code[i] != c) {
+						if (code[i] == '\\')
+							i++;
+						i++;
+					}
+					i++;
+				} else if (Char.IsLetterOrDigit(c) || c == '_') {
+					while (i < code.Length && (Char.IsLetterOrDigit(code[i]) || code[i] == '_' || code[i] == '.' && Char.IsDigit(c)))
+						i++;
+				} else if ((c == '&' || c == '|') && i + 1 < code.Length && code[i + 1] == c) {
+					i += 2;
+				} else {
+					i++;
+				}
+
+				handler(code.Substring(start, Math.Min(i, code.Length) - start));
+			}
+		}
+	}
+}
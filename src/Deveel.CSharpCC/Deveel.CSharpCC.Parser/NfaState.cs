@@ -2,6 +2,7 @@
 using System.Collections;
 using System.Collections.Generic;
 using System.IO;
+using System.Text;
 
 using Deveel.CSharpCC.Util;
 
@@ -31,6 +32,13 @@ namespace Deveel.CSharpCC.Parser {
         private static bool jjCheckNAddStatesUnaryNeeded = false;
         private static bool jjCheckNAddStatesDualNeeded = false;
 
+        /// <summary>
+        /// The number of composite state sets of the current lexical state.
+        /// </summary>
+        internal static int CompositeStateSets {
+            get { return compositeStateTable.Count; }
+        }
+
         public static void ReInit() {
             generatedStates = 0;
             idCnt = 0;
@@ -73,6 +81,7 @@ namespace Deveel.CSharpCC.Parser {
         internal bool isFinal;
         private IList<int> loByteVec;
         private int[] nonAsciiMoveIndices;
+        private long[] nonAsciiClass;
         private int round ;
         private int onlyChar;
         private char matchSingleChar;
@@ -431,6 +440,120 @@ namespace Deveel.CSharpCC.Parser {
             }
         }
 
+        /// <summary>
+        /// Merges the states of the current lexical state that cannot be told apart:
+        /// the same moves, kind and token looked for, with the next state and the
+        /// epsilon moves going to states that are merged together as well.
+        /// </summary>
+        /// <remarks>
+        /// Every reference to a private regular expression builds its own copy of the
+        /// states, and the ends of the alternatives of a choice all move to the same
+        /// state: these are folded back into one state before the closures are computed.
+        /// The states given are referenced from outside the automaton and are kept apart.
+        /// </remarks>
+        public static void MergeEquivalentStates(params NfaState[] pinned) {
+            int count = allStates.Count;
+            int[] classOf = new int[count];
+            var keys = new Dictionary<string, int>();
+
+            for (int i = 0; i < count; i++) {
+                NfaState state = allStates[i];
+                string key = Array.IndexOf(pinned, state) >= 0 ? "#" + i : state.LocalKey();
+                if (!keys.TryGetValue(key, out classOf[i]))
+                    keys[key] = classOf[i] = keys.Count;
+            }
+
+            // Splitting a class never joins others: the partition is stable as soon
+            // as a round does not add a class.
+            int classes = keys.Count;
+            while (true) {
+                int[] newClassOf = new int[count];
+                keys.Clear();
+
+                for (int i = 0; i < count; i++) {
+                    string key = classOf[i] + ":" + allStates[i].MovesKey(classOf);
+                    if (!keys.TryGetValue(key, out newClassOf[i]))
+                        keys[key] = newClassOf[i] = keys.Count;
+                }
+
+                if (keys.Count == classes)
+                    break;
+
+                classes = keys.Count;
+                classOf = newClassOf;
+            }
+
+            GenerationStats.Add("NFA states constructed", count);
+            GenerationStats.Add("NFA states after merging", classes);
+
+            if (classes == count)
+                return;
+
+            var representative = new NfaState[classes];
+            for (int i = 0; i < count; i++)
+                if (representative[classOf[i]] == null)
+                    representative[classOf[i]] = allStates[i];
+
+            var merged = new List<NfaState>(classes);
+            for (int i = 0; i < count; i++) {
+                NfaState state = allStates[i];
+                if (representative[classOf[i]] != state)
+                    continue;
+
+                if (state.next != null)
+                    state.next = representative[classOf[state.next.id]];
+
+                IList<NfaState> moves = state.epsilonMoves;
+                state.epsilonMoves = new List<NfaState>();
+                for (int j = 0; j < moves.Count; j++)
+                    InsertInOrder(state.epsilonMoves, representative[classOf[moves[j].id]]);
+
+                merged.Add(state);
+            }
+
+            // The states keep their order, so the epsilon moves stay sorted on the new ids.
+            for (int i = 0; i < merged.Count; i++)
+                merged[i].id = i;
+
+            allStates = merged;
+            idCnt = merged.Count;
+        }
+
+        private string LocalKey() {
+            var key = new StringBuilder();
+            key.Append(isFinal).Append(',').Append(kind).Append(',').Append(lookingFor);
+            key.Append(',').Append(asciiMoves[0]).Append(',').Append(asciiMoves[1]);
+            AppendChars(key.Append(";c"), charMoves);
+            AppendChars(key.Append(";r"), rangeMoves);
+            return key.ToString();
+        }
+
+        private string MovesKey(int[] classOf) {
+            var targets = new List<int>();
+            for (int i = 0; i < epsilonMoves.Count; i++) {
+                int target = classOf[epsilonMoves[i].id];
+                if (!targets.Contains(target))
+                    targets.Add(target);
+            }
+
+            targets.Sort();
+
+            var key = new StringBuilder();
+            key.Append(next == null ? -1 : classOf[next.id]);
+            for (int i = 0; i < targets.Count; i++)
+                key.Append(',').Append(targets[i]);
+
+            return key.ToString();
+        }
+
+        private static void AppendChars(StringBuilder key, char[] chars) {
+            if (chars == null)
+                return;
+
+            for (int i = 0; i < chars.Length && chars[i] != 0; i++)
+                key.Append(',').Append((int) chars[i]);
+        }
+
         public static void ComputeClosures() {
             for (int i = allStates.Count; i-- > 0;) {
                 var tmp = allStates[i];
@@ -754,6 +877,11 @@ namespace Deveel.CSharpCC.Parser {
                 (rangeMoves == null || rangeMoves[0] == 0))
                 return;
 
+            if (Options.getUnicodeTables()) {
+                GenerateNonAsciiClass();
+                return;
+            }
+
             if (charMoves != null) {
                 for (i = 0; i < charMoves.Length; i++) {
                     if (charMoves[i] == 0)
@@ -837,7 +965,7 @@ namespace Deveel.CSharpCC.Parser {
                         allBitVectors.Add(tmp);
 
                         if (!AllBitsSet(tmp))
-                            ostr.WriteLine("static readonly long[] ccBitVec" + lohiByteCnt + " = " + tmp);
+                            ostr.WriteLine(CSharpCCGlobals.TableDeclaration("static", "long", "ccBitVec" + lohiByteCnt) + tmp);
                         lohiByteTab[tmp] = ind = lohiByteCnt++;
                     }
 
@@ -850,7 +978,7 @@ namespace Deveel.CSharpCC.Parser {
                         allBitVectors.Add(tmp);
 
                         if (!AllBitsSet(tmp))
-                            ostr.WriteLine("static readonly long[] ccBitVec" + lohiByteCnt + " = " + tmp);
+                            ostr.WriteLine(CSharpCCGlobals.TableDeclaration("static", "long", "ccBitVec" + lohiByteCnt) + tmp);
                         lohiByteTab[tmp] = ind = lohiByteCnt++;
                     }
 
@@ -881,7 +1009,7 @@ namespace Deveel.CSharpCC.Parser {
                         allBitVectors.Add(tmp);
 
                         if (!AllBitsSet(tmp))
-                            ostr.WriteLine("static readonly long[] ccBitVec" + lohiByteCnt + " = " + tmp);
+                            ostr.WriteLine(CSharpCCGlobals.TableDeclaration("static", "long", "ccBitVec" + lohiByteCnt) + tmp);
                         lohiByteTab[tmp] = ind = lohiByteCnt++;
                     }
 
@@ -897,6 +1025,50 @@ namespace Deveel.CSharpCC.Parser {
             UpdateDuplicateNonAsciiMoves();
         }
 
+        // The characters of the moves as 1024 words of 64 bits, one for every
+        // block of 64 characters, shared by the states with the same class.
+        private void GenerateNonAsciiClass() {
+            long[] words = new long[1024];
+
+            if (charMoves != null) {
+                for (int i = 0; i < charMoves.Length && charMoves[i] != 0; i++)
+                    words[charMoves[i] >> 6] |= 1L << (charMoves[i] & 63);
+            }
+
+            if (rangeMoves != null) {
+                for (int i = 0; i < rangeMoves.Length && rangeMoves[i] != 0; i += 2) {
+                    for (int c = rangeMoves[i]; c <= rangeMoves[i + 1]; c++)
+                        words[c >> 6] |= 1L << (c & 63);
+                }
+            }
+
+            for (int i = 0; i < nonAsciiTableForMethod.Count; i++) {
+                long[] other = nonAsciiTableForMethod[i].nonAsciiClass;
+                int j = 0;
+                while (j < words.Length && words[j] == other[j])
+                    j++;
+
+                if (j == words.Length) {
+                    nonAsciiMethod = i;
+                    return;
+                }
+            }
+
+            nonAsciiClass = words;
+            nonAsciiMethod = nonAsciiTableForMethod.Count;
+            nonAsciiTableForMethod.Add(this);
+        }
+
+        // The condition on curChar of a move on a non-ASCII character class:
+        // a bit of the classes of the character, with UNICODE_TABLES.
+        private String NonAsciiMoveTest(bool moves) {
+            if (Options.getUnicodeTables())
+                return "(ccCharClasses" + (nonAsciiMethod / 64) + "[charSet] & (1L << " + (nonAsciiMethod % 64) + ")) " +
+                       (moves ? "!=" : "==") + " 0L";
+
+            return (moves ? "" : "!") + "ccCanMove_" + nonAsciiMethod + "(hiByte, i1, i2, l1, l2)";
+        }
+
         private void UpdateDuplicateNonAsciiMoves() {
             for (int i = 0; i < nonAsciiTableForMethod.Count; i++) {
                 var tmp = nonAsciiTableForMethod[i];
@@ -1069,7 +1241,7 @@ namespace Deveel.CSharpCC.Parser {
         public static void DumpStateSets(TextWriter ostr) {
             int cnt = 0;
 
-            ostr.Write("static readonly int[] ccNextStates = {");
+            ostr.Write(CSharpCCGlobals.TableDeclaration("static", "int", "ccNextStates") + "{");
             for (int i = 0; i < orderedStateSet.Count; i++) {
                 int[] set = orderedStateSet[i];
 
@@ -1404,7 +1576,10 @@ namespace Deveel.CSharpCC.Parser {
             else if (byteNum == 1)
                 ostr.WriteLine("         long l = 1L << (curChar & 63);");
 
-            else {
+            else if (Options.getUnicodeTables()) {
+                if (HasNonAsciiMoves())
+                    ostr.WriteLine("         int charSet = ccCharSets[ccCharBlocks[curChar >> 6] + (curChar & 63)];");
+            } else {
                 if (Options.getUnicodeEscape() || unicodeWarningGiven) {
                     ostr.WriteLine("         int hiByte = (int)(curChar >> 8);");
                     ostr.WriteLine("         int i1 = hiByte >> 6;");
@@ -1423,6 +1598,14 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("            {");
         }
 
+        private static bool HasNonAsciiMoves() {
+            foreach (NfaState state in allStates) {
+                if (state != null && state.lexState == LexGen.lexStateIndex && state.nonAsciiMethod != -1)
+                    return true;
+            }
+            return false;
+        }
+
         private static IList<IList<NfaState>> PartitionStatesSetForAscii(int[] states, int byteNum) {
             int[] cardinalities = new int[states.Length];
             List<NfaState> original = new List<NfaState>(states.Length);
@@ -1797,9 +1980,8 @@ namespace Deveel.CSharpCC.Parser {
             for (int i = 0; i < allStates.Count; i++) {
                 NfaState temp = allStates[i];
 
-                if (dumped[temp.stateName] || temp.lexState != LexGen.lexStateIndex ||
-                    !temp.HasTransitions() || temp.dummy ||
-                    temp.stateName == -1)
+                if (temp.stateName == -1 || dumped[temp.stateName] || temp.lexState != LexGen.lexStateIndex ||
+                    !temp.HasTransitions() || temp.dummy)
                     continue;
 
                 String toPrint = "";
@@ -1934,11 +2116,11 @@ namespace Deveel.CSharpCC.Parser {
                 }
             }
 
-            if (!Options.getUnicodeEscape() && !unicodeWarningGiven) {
+            if (!Options.getUnicodeTables() && !Options.getUnicodeEscape() && !unicodeWarningGiven) {
                 if (loByteVec != null && loByteVec.Count > 1)
                     ostr.WriteLine("                  if ((ccBitVec" + loByteVec[1] + "[i2" +"] & l2) != 0L)");
             } else {
-                ostr.WriteLine("                  if (ccCanMove_" + nonAsciiMethod + "(hiByte, i1, i2, l1, l2))");
+                ostr.WriteLine("                  if (" + NonAsciiMoveTest(true) + ")");
             }
 
             if (kindToPrint != Int32.MaxValue) {
@@ -2008,11 +2190,11 @@ namespace Deveel.CSharpCC.Parser {
             if (next == null || next.usefulEpsilonMoves <= 0) {
                 String kindCheck = " && kind > " + kindToPrint;
 
-                if (!Options.getUnicodeEscape() && !unicodeWarningGiven) {
+                if (!Options.getUnicodeTables() && !Options.getUnicodeEscape() && !unicodeWarningGiven) {
                     if (loByteVec != null && loByteVec.Count > 1)
                         ostr.WriteLine("                  if ((ccBitVec" + loByteVec[1] + "[i2" + "] & l2) != 0L" + kindCheck + ")");
                 } else {
-                    ostr.WriteLine("                  if (ccCanMove_" + nonAsciiMethod + "(hiByte, i1, i2, l1, l2)" + kindCheck + ")");
+                    ostr.WriteLine("                  if (" + NonAsciiMoveTest(true) + kindCheck + ")");
                 }
                 ostr.WriteLine("                     kind = " + kindToPrint + ";");
                 ostr.WriteLine("                  break;");
@@ -2021,24 +2203,24 @@ namespace Deveel.CSharpCC.Parser {
 
             String prefix = "   ";
             if (kindToPrint != Int32.MaxValue) {
-                if (!Options.getUnicodeEscape() && !unicodeWarningGiven) {
+                if (!Options.getUnicodeTables() && !Options.getUnicodeEscape() && !unicodeWarningGiven) {
                     if (loByteVec != null && loByteVec.Count > 1) {
                         ostr.WriteLine("                  if ((ccBitVec" + loByteVec[1] + "[i2" + "] & l2) == 0L)");
                         ostr.WriteLine("                     break;");
                     }
                 } else {
-                    ostr.WriteLine("                  if (!ccCanMove_" + nonAsciiMethod + "(hiByte, i1, i2, l1, l2))");
+                    ostr.WriteLine("                  if (" + NonAsciiMoveTest(false) + ")");
                     ostr.WriteLine("                     break;");
                 }
 
                 ostr.WriteLine("                  if (kind > " + kindToPrint + ")");
                 ostr.WriteLine("                     kind = " + kindToPrint + ";");
                 prefix = "";
-            } else if (!Options.getUnicodeEscape() && !unicodeWarningGiven) {
+            } else if (!Options.getUnicodeTables() && !Options.getUnicodeEscape() && !unicodeWarningGiven) {
                 if (loByteVec != null && loByteVec.Count > 1)
                     ostr.WriteLine("                  if ((ccBitVec" + loByteVec[1] + "[i2" + "] & l2) != 0L)");
             } else {
-                ostr.WriteLine("                  if (ccCanMove_" + nonAsciiMethod + "(hiByte, i1, i2, l1, l2))");
+                ostr.WriteLine("                  if (" + NonAsciiMoveTest(true) + ")");
             }
 
             if (next != null && next.usefulEpsilonMoves > 0) {
@@ -2125,6 +2307,11 @@ namespace Deveel.CSharpCC.Parser {
         }
 
         public static void DumpNonAsciiMoveMethods(TextWriter ostr) {
+            if (Options.getUnicodeTables()) {
+                DumpCharClassTables(ostr);
+                return;
+            }
+
             if (!Options.getUnicodeEscape() && !unicodeWarningGiven)
                 return;
 
@@ -2137,9 +2324,97 @@ namespace Deveel.CSharpCC.Parser {
             }
         }
 
+        /* With UNICODE_TABLES, the character classes of the non-ASCII moves of
+      all the lexical states are matched with three tables, shared by all the
+      states: ccCharBlocks gives for every block of 64 characters the offset
+      of its 64 entries in ccCharSets, that gives the set of classes of every
+      character, whose bits are in ccCharClassesN (64 classes for each N).
+      Identical blocks and identical sets of classes are stored only once, so
+      that large ranges of letters take a few entries. */
+
+        private static void DumpCharClassTables(TextWriter ostr) {
+            int classes = nonAsciiTableForMethod.Count;
+            if (classes == 0)
+                return;
+
+            int words = (classes + 63) / 64;
+            List<long[]> sets = new List<long[]>();
+            Dictionary<string, int> setIndex = new Dictionary<string, int>();
+            List<long> charSets = new List<long>();
+            Dictionary<string, int> blockOffset = new Dictionary<string, int>();
+            long[] charBlocks = new long[1024];
+
+            // The characters of no class, and the ASCII blocks matched before.
+            sets.Add(new long[words]);
+            setIndex[TableKey(sets[0])] = 0;
+            long[] block = new long[64];
+            blockOffset[TableKey(block)] = 0;
+            charSets.AddRange(block);
+
+            for (int b = 2; b < 1024; b++) {
+                bool any = false;
+                for (int k = 0; k < classes && !any; k++)
+                    any = nonAsciiTableForMethod[k].nonAsciiClass[b] != 0L;
+
+                if (!any)
+                    continue;
+
+                for (int c = 0; c < 64; c++) {
+                    long[] set = new long[words];
+                    for (int k = 0; k < classes; k++) {
+                        if ((nonAsciiTableForMethod[k].nonAsciiClass[b] & (1L << c)) != 0L)
+                            set[k / 64] |= 1L << (k % 64);
+                    }
+
+                    string setKey = TableKey(set);
+                    int index;
+                    if (!setIndex.TryGetValue(setKey, out index)) {
+                        setIndex[setKey] = index = sets.Count;
+                        sets.Add(set);
+                    }
+                    block[c] = index;
+                }
+
+                string blockKey = TableKey(block);
+                int offset;
+                if (!blockOffset.TryGetValue(blockKey, out offset)) {
+                    blockOffset[blockKey] = offset = charSets.Count;
+                    charSets.AddRange(block);
+                }
+                charBlocks[b] = offset;
+            }
+
+            DumpTable(ostr, "ushort", "ccCharBlocks", charBlocks, "");
+            DumpTable(ostr, sets.Count <= 256 ? "byte" : "ushort", "ccCharSets", charSets, "");
+            for (int w = 0; w < words; w++) {
+                long[] bits = new long[sets.Count];
+                for (int i = 0; i < bits.Length; i++)
+                    bits[i] = sets[i][w];
+                DumpTable(ostr, "long", "ccCharClasses" + w, bits, "L");
+            }
+        }
+
+        private static string TableKey(long[] values) {
+            StringBuilder key = new StringBuilder();
+            foreach (long value in values)
+                key.Append(value).Append(',');
+            return key.ToString();
+        }
+
+        private static void DumpTable(TextWriter ostr, string type, string name, IList<long> values, string suffix) {
+            ostr.Write(CSharpCCGlobals.TableDeclaration("static", type, name) + "{");
+            for (int i = 0; i < values.Count; i++) {
+                if (i % 16 == 0)
+                    ostr.Write("\n   ");
+
+                ostr.Write(values[i] + suffix + ", ");
+            }
+            ostr.WriteLine("\n};");
+        }
+
         private void DumpNonAsciiMoveMethod(TextWriter ostr) {
             int j;
-            ostr.WriteLine("private static readonly bool ccCanMove_" + nonAsciiMethod +"(int hiByte, int i1, int i2, long l1, long l2)");
+            ostr.WriteLine("private static bool ccCanMove_" + nonAsciiMethod +"(int hiByte, int i1, int i2, long l1, long l2)");
             ostr.WriteLine("{");
             ostr.WriteLine("   switch(hiByte)");
             ostr.WriteLine("   {");
@@ -2194,6 +2469,11 @@ namespace Deveel.CSharpCC.Parser {
 
         //private static bool boilerPlateDumped = false;
         internal static void PrintBoilerPlate(TextWriter ostr) {
+            // The helpers are called for every state of every character.
+            String inline = Options.clrVersionAtLeast(4.5)
+                ? "[System.Runtime.CompilerServices.MethodImpl(System.Runtime.CompilerServices.MethodImplOptions.AggressiveInlining)]" + Environment.NewLine
+                : "";
+            ostr.Write(inline);
             ostr.WriteLine("private " + (Options.getStatic() ? "static " : "") + "void " +"ccCheckNAdd(int state)");
             ostr.WriteLine("{");
             ostr.WriteLine("   if (ccRounds[state] != ccRound)");
@@ -2203,6 +2483,7 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("   }");
             ostr.WriteLine("}");
 
+            ostr.Write(inline);
             ostr.WriteLine("private " + (Options.getStatic() ? "static " : "") + " void " + "ccAddStates(int start, int end)");
             ostr.WriteLine("{");
             ostr.WriteLine("   do {");
@@ -2210,6 +2491,7 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("   } while (start++ != end);");
             ostr.WriteLine("}");
 
+            ostr.Write(inline);
             ostr.WriteLine("private " + (Options.getStatic() ? "static " : "") + " void " + "ccCheckNAddTwoStates(int state1, int state2)");
             ostr.WriteLine("{");
             ostr.WriteLine("   ccCheckNAdd(state1);");
@@ -2217,6 +2499,7 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("}");
             ostr.WriteLine("");
             if (jjCheckNAddStatesDualNeeded) {
+                ostr.Write(inline);
                 ostr.WriteLine("private " + (Options.getStatic() ? "static " : "") + "void " + "ccCheckNAddStates(int start, int end)");
                 ostr.WriteLine("{");
                 ostr.WriteLine("   do {");
@@ -2227,6 +2510,7 @@ namespace Deveel.CSharpCC.Parser {
             }
 
             if (jjCheckNAddStatesUnaryNeeded) {
+                ostr.Write(inline);
                 ostr.WriteLine("private " + (Options.getStatic() ? "static " : "") + "void " + "ccCheckNAddStates(int start)");
                 ostr.WriteLine("{");
                 ostr.WriteLine("   ccCheckNAdd(ccNextStates[start]);");
@@ -2387,10 +2671,27 @@ namespace Deveel.CSharpCC.Parser {
                 return;
             }
 
+            // The moves on characters below 64, below 128 and above, that are
+            // moved to methods of their own when they make ccMoveNfa too large.
+            String[] moves = new String[3];
+            for (i = 0; i < moves.Length; i++) {
+                StringWriter writer = new StringWriter();
+                if (i < 2)
+                    DumpAsciiMoves(writer, i);
+                else
+                    DumpCharAndRangeMoves(writer);
+                moves[i] = writer.ToString();
+            }
+            bool splitMoves = MethodSize.ExceedsMaxSize(String.Concat(moves));
+
             if (LexGen.mixed[LexGen.lexStateIndex]) {
                 ostr.WriteLine("   int strKind = ccMatchedKind;");
                 ostr.WriteLine("   int strPos = ccMatchedPos;");
                 ostr.WriteLine("   int seenUpto;");
+                if (LexGen.profile) {
+                    ostr.WriteLine("   ccProfileBackups[" + LexGen.lexStateIndex + "]++;");
+                    ostr.WriteLine("   ccProfileBackupChars[" + LexGen.lexStateIndex + "] += curPos + 1;");
+                }
                 ostr.WriteLine("   inputStream.Backup(seenUpto = curPos + 1);");
                 ostr.WriteLine("   try { curChar = inputStream.ReadChar(); }");
                 ostr.WriteLine("   catch(System.IO.IOException) { throw new System.InvalidOperationException(\"Internal Error\"); }");
@@ -2416,12 +2717,16 @@ namespace Deveel.CSharpCC.Parser {
             ostr.WriteLine("   int kind = Int32.MaxValue;");
             ostr.WriteLine("   for (;;)");
             ostr.WriteLine("   {");
+            if (LexGen.profile) {
+                ostr.WriteLine("      ccProfileNfaChars[" + LexGen.lexStateIndex + "]++;");
+                ostr.WriteLine("      ccProfileNfaStates[" + LexGen.lexStateIndex + "] += i - startsAt;");
+            }
             ostr.WriteLine("      if (++ccRound == Int32.MaxValue)");
             ostr.WriteLine("         ReInitRounds();");
             ostr.WriteLine("      if (curChar < 64)");
             ostr.WriteLine("      {");
 
-            DumpAsciiMoves(ostr, 0);
+            DumpMoves(ostr, moves, 0, splitMoves);
 
             ostr.WriteLine("      }");
 
@@ -2429,14 +2734,14 @@ namespace Deveel.CSharpCC.Parser {
 
             ostr.WriteLine("      {");
 
-            DumpAsciiMoves(ostr, 1);
+            DumpMoves(ostr, moves, 1, splitMoves);
 
             ostr.WriteLine("      }");
 
             ostr.WriteLine("      else");
             ostr.WriteLine("      {");
 
-            DumpCharAndRangeMoves(ostr);
+            DumpMoves(ostr, moves, 2, splitMoves);
 
             ostr.WriteLine("      }");
 
@@ -2504,9 +2809,33 @@ namespace Deveel.CSharpCC.Parser {
             }
 
             ostr.WriteLine("}");
+
+            if (splitMoves) {
+                for (i = 0; i < moves.Length; i++) {
+                    ostr.WriteLine("private " + (Options.getStatic() ? "static " : "") + "int " + MovesMethodName(i) + "(int i, int startsAt, int kind)");
+                    ostr.WriteLine("{");
+                    ostr.Write(moves[i]);
+                    ostr.WriteLine("   return kind;");
+                    ostr.WriteLine("}");
+                }
+                GenerationStats.Add("Split NFA methods", 1);
+            }
             allStates.Clear();
         }
 
+        private static String MovesMethodName(int index) {
+            return "ccMoveNfa" + LexGen.lexStateSuffix + "_" + index;
+        }
+
+        // The moves only use the state set, the bounds of the loop over it and
+        // the kind matched so far, that the method of the moves returns.
+        private static void DumpMoves(TextWriter ostr, String[] moves, int index, bool split) {
+            if (split)
+                ostr.WriteLine("         kind = " + MovesMethodName(index) + "(i, startsAt, kind);");
+            else
+                ostr.Write(moves[index]);
+        }
+
         public static void DumpStatesForState(TextWriter ostr) {
             ostr.Write("internal static readonly int[][][] statesForState = ");
 
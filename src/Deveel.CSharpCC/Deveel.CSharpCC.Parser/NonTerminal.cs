@@ -5,6 +5,11 @@ using System.Text;
 
 namespace Deveel.CSharpCC.Parser {
     public class NonTerminal : Expansion {
+        public NonTerminal() {
+            ArgumentTokens = new List<Token>();
+            LhsTokens = new List<Token>();
+        }
+
         public string Name { get; internal set; }
 
         public IList<Token> ArgumentTokens { get; internal set; }
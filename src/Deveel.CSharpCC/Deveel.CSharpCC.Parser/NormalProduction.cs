@@ -4,7 +4,7 @@ using System.Collections.Generic;
 using System.Text;
 
 namespace Deveel.CSharpCC.Parser {
-    public class NormalProduction {
+    public class NormalProduction : ILocationInfo {
         private readonly IList<Token> returnTypeTokens;
         private readonly IList<Token> parameterTokens;
 
@@ -12,6 +12,8 @@ namespace Deveel.CSharpCC.Parser {
             LeIndex = 0;
             returnTypeTokens = new List<Token>();
             parameterTokens = new List<Token>();
+            Parents = new List<NonTerminal>();
+            LeftExpansions = new NormalProduction[10];
         }
 
         public Expansion Expansion { get; internal set; }
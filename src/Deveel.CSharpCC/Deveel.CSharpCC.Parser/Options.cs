@@ -39,6 +39,8 @@ namespace Deveel.CSharpCC.Parser {
             optionValues.Add("LOOKAHEAD", 1);
             optionValues.Add("CHOICE_AMBIGUITY_CHECK", 2);
             optionValues.Add("OTHER_AMBIGUITY_CHECK", 1);
+            optionValues.Add("TOKEN_RING_SIZE", 1024);
+            optionValues.Add("MAX_METHOD_SIZE", 60000);
 
             optionValues.Add("STATIC", true);
             optionValues.Add("DEBUG_PARSER", false);
@@ -58,6 +60,19 @@ namespace Deveel.CSharpCC.Parser {
             optionValues.Add("COMMON_TOKEN_ACTION", false);
             optionValues.Add("CACHE_TOKENS", false);
             optionValues.Add("KEEP_LINE_COLUMN", true);
+            optionValues.Add("PIPELINED_TOKEN_MANAGER", false);
+            optionValues.Add("PARALLEL_TOKENIZER", false);
+            optionValues.Add("TOKEN_KIND_SCANNER", false);
+            optionValues.Add("INSTRUMENT", false);
+            optionValues.Add("PROFILE_LOOKAHEAD", false);
+            optionValues.Add("PROFILE_TOKEN_MANAGER", false);
+            optionValues.Add("STATS", false);
+            optionValues.Add("PROFILE_PARSER", false);
+            optionValues.Add("UNICODE_TABLES", false);
+            optionValues.Add("KEYWORD_HASH", false);
+            optionValues.Add("GENERATION_CACHE", false);
+            optionValues.Add("BUILD_TREE", false);
+            optionValues.Add("EVENT_SINK", false);
 
             optionValues.Add("GENERATE_CHAINED_EXCEPTION", false);
             optionValues.Add("GENERATE_GENERICS", false);
@@ -70,16 +85,30 @@ namespace Deveel.CSharpCC.Parser {
             optionValues.Add("TOKEN_EXTENDS", "");
             optionValues.Add("TOKEN_FACTORY", "");
             optionValues.Add("GRAMMAR_ENCODING", "");
+            optionValues.Add("STATEMENT_SEPARATOR", "");
+            optionValues.Add("INTERN_TOKENS", "");
+            optionValues.Add("TOKEN_VALUES", "");
+            optionValues.Add("PROFILE_FILE", "");
         }
 		
         public static String GetOptionsString(String[] interestingOptions) {
+            return GetOptionsString(optionValues, interestingOptions);
+        }
+
+        /// <summary>
+        /// Gets the given options, read in the given values, as they are recorded in
+        /// the header of a generated file.
+        /// </summary>
+        public static String GetOptionsString(IDictionary<string, object> values, String[] interestingOptions) {
             StringBuilder sb = new StringBuilder();
 
             for (int i = 0; i < interestingOptions.Length; i++) {
                 String key = interestingOptions[i];
                 sb.Append(key);
                 sb.Append('=');
-                sb.Append(optionValues[key]);
+                object value;
+                values.TryGetValue(key, out value);
+                sb.Append(value);
                 if (i != interestingOptions.Length - 1) {
                     sb.Append(',');
                 }
@@ -368,6 +397,175 @@ namespace Deveel.CSharpCC.Parser {
             return BooleanValue("KEEP_LINE_COLUMN");
         }
 
+        /**
+   * Should the generated parser run its token manager on a background
+   * thread feeding a bounded token ring?
+   *
+   * @return The requested pipelined token manager value.
+   */
+
+        public static bool getPipelinedTokenManager() {
+            return BooleanValue("PIPELINED_TOKEN_MANAGER");
+        }
+
+        /**
+   * Find the number of tokens the pipelined token manager may run ahead
+   * of the parser.
+   *
+   * @return The requested token ring size.
+   */
+
+        public static int getTokenRingSize() {
+            return IntValue("TOKEN_RING_SIZE");
+        }
+
+        /**
+   * Find the estimated size in bytes of IL above which the moves of the
+   * NFA of a lexical state are split out of ccMoveNfa, or 0 to never split.
+   *
+   * @return The requested max method size.
+   */
+
+        public static int getMaxMethodSize() {
+            return IntValue("MAX_METHOD_SIZE");
+        }
+
+        /**
+   * Should a tokenizer lexing the whole input in parallel chunks be
+   * generated along with the token manager?
+   *
+   * @return The requested parallel tokenizer value.
+   */
+
+        public static bool getParallelTokenizer() {
+            return BooleanValue("PARALLEL_TOKENIZER");
+        }
+
+        /**
+   * Should the token manager also have a method returning the kind and
+   * the range of the next token without creating it?
+   *
+   * @return The requested token kind scanner value.
+   */
+
+        public static bool getTokenKindScanner() {
+            return BooleanValue("TOKEN_KIND_SCANNER");
+        }
+
+        /**
+   * Should the generated parser and token manager publish runtime
+   * counters through an EventSource?
+   *
+   * @return The requested instrument value.
+   */
+
+        public static bool getInstrument() {
+            return BooleanValue("INSTRUMENT");
+        }
+
+        /**
+   * Should the generated parser count the calls and the tokens scanned
+   * of every syntactic lookahead?  The tokens scanned in the productions
+   * a lookahead calls count for that lookahead.  Semantic lookaheads, and
+   * the choices made on the next token alone, are not counted.
+   *
+   * @return The requested profile lookahead value.
+   */
+
+        public static bool getProfileLookahead() {
+            return BooleanValue("PROFILE_LOOKAHEAD");
+        }
+
+        /**
+   * Should the generated token manager count the characters, tokens,
+   * NFA states and backups of every lexical state, and write them out
+   * when it is done?
+   *
+   * @return The requested profile token manager value.
+   */
+
+        public static bool getProfileTokenManager() {
+            return BooleanValue("PROFILE_TOKEN_MANAGER");
+        }
+
+        /**
+   * Should the time and the memory spent in every phase of the
+   * generation be reported?
+   *
+   * @return The requested stats value.
+   */
+
+        public static bool getStats() {
+            return BooleanValue("STATS");
+        }
+
+        /**
+   * Should the generated parser count the calls of the productions, the
+   * alternatives taken at the choices and the tokens consumed, and write
+   * them as a profile?
+   *
+   * @return The requested profile parser value.
+   */
+
+        public static bool getProfileParser() {
+            return BooleanValue("PROFILE_PARSER");
+        }
+
+        /**
+   * Should the token manager match the non-ASCII characters with shared
+   * lookup tables of the character classes, instead of a method for every
+   * class?
+   *
+   * @return The requested unicode tables value.
+   */
+
+        public static bool getUnicodeTables() {
+            return BooleanValue("UNICODE_TABLES");
+        }
+
+        /**
+   * Should the token manager look the identifiers up in a perfect hash of
+   * the keywords they match, instead of matching the keywords in the DFA
+   * of the string literals?
+   *
+   * @return The requested keyword hash value.
+   */
+
+        public static bool getKeywordHash() {
+            return BooleanValue("KEYWORD_HASH");
+        }
+
+        /**
+   * Should a run be skipped when the files generated the last time from
+   * the same grammar, options and generator are still unchanged?
+   *
+   * @return The requested generation cache value.
+   */
+
+        public static bool getGenerationCache() {
+            return BooleanValue("GENERATION_CACHE");
+        }
+
+        /**
+   * Should the parser build a tree of the calls of its productions?
+   *
+   * @return The requested build tree value.
+   */
+
+        public static bool getBuildTree() {
+            return BooleanValue("BUILD_TREE");
+        }
+
+        /**
+   * Should the parser report its productions and tokens to an event sink?
+   *
+   * @return The requested event sink value.
+   */
+
+        public static bool getEventSink() {
+            return BooleanValue("EVENT_SINK");
+        }
+
         /**
    * Find the JDK version.
    *
@@ -471,6 +669,51 @@ namespace Deveel.CSharpCC.Parser {
             }
         }
 
+        /**
+   * Find the labels of the tokens separating independent statements, at which
+   * the generated batch API splits its input.
+   *
+   * @return The comma-separated token labels, or an empty string.
+   */
+
+        public static String getStatementSeparator() {
+            return StringValue("STATEMENT_SEPARATOR");
+        }
+
+        /**
+   * Find the labels, separated by commas, of the tokens whose images are
+   * shared through a name table.
+   *
+   * @return The requested interned token labels.
+   */
+
+        public static String getInternTokens() {
+            return StringValue("INTERN_TOKENS");
+        }
+
+        /**
+   * Find the tokens, separated by commas, whose value is decoded from the
+   * input when they are read, each as LABEL:kind with kind one of int, long,
+   * double, decimal, string (backslash escapes) or verbatim (doubled quotes).
+   *
+   * @return The requested token values, or an empty string.
+   */
+
+        public static String getTokenValues() {
+            return StringValue("TOKEN_VALUES");
+        }
+
+        /**
+   * Find the profile written by a parser generated with PROFILE_PARSER,
+   * used to lay out the parser and the token manager for its hot paths.
+   *
+   * @return The requested profile file, or an empty string.
+   */
+
+        public static String getProfileFile() {
+            return StringValue("PROFILE_FILE");
+        }
+
         /**
    * Find the output directory.
    *
@@ -2,6 +2,8 @@
 using System.Collections.Generic;
 using System.IO;
 
+using Deveel.CSharpCC.Util;
+
 namespace Deveel.CSharpCC.Parser {
 	public class OtherFilesGen {
 		private static TextWriter ostr;
@@ -28,13 +30,21 @@ namespace Deveel.CSharpCC.Parser {
 					CSharpFiles.GenerateSimpleCharStream();
 				}
 			}
+			if (ParseGen.pipelined) {
+				CSharpFiles.GenerateTokenRing();
+			}
+			if (LexGen.internImages) {
+				CSharpFiles.GenerateNameTable();
+			}
+			InstrumentGen.start();
+			LookaheadProfileGen.start();
+			ProfileGen.start();
+			TreeGen.start();
+			EventSinkGen.start();
 
 			try {
 				ostr =
-					new StreamWriter(
-						new BufferedStream(
-							new FileStream(Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + "Constants.cs"),
-							               FileMode.OpenOrCreate, FileAccess.Write), 8192));
+					new StreamWriter(new GeneratedFileStream(Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + "Constants.cs")));
 			} catch (IOException) {
 				CSharpCCErrors.SemanticError("Could not open file " + CSharpCCGlobals.cu_name + "Constants.cs for writing.");
 				throw new InvalidOperationException();
@@ -117,6 +127,13 @@ namespace Deveel.CSharpCC.Parser {
             if (namespaceInserted)
                 ostr.WriteLine("}");
 			ostr.Close();
+
+			if (Options.getStatementSeparator().Length > 0) {
+				BatchGen.start();
+			}
+			if (Options.getParallelTokenizer()) {
+				TokenizerGen.start();
+			}
 		}
 
 		public static void reInit() {
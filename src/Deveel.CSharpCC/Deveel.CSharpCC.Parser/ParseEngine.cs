@@ -4,6 +4,8 @@ using System.Globalization;
 using System.IO;
 using System.Text;
 
+using Deveel.CSharpCC.Util;
+
 namespace Deveel.CSharpCC.Parser {
     public static class ParseEngine {
         private static TextWriter ostr;
@@ -11,11 +13,14 @@ namespace Deveel.CSharpCC.Parser {
         private static int indentamt;
         private static bool cc2LA;
 
+        // The production being generated and the number of its choices generated
+        // so far, that identify a choice in the profile.
+        private static String choiceProduction;
+        private static int choiceOrdinal;
+
         private static IDictionary<Expansion, Phase3Data> phase3table = new Dictionary<Expansion, Phase3Data>();
         private static IList<Phase3Data> phase3list = new List<Phase3Data>();
 
-        private static IDictionary<string, NormalProduction> productionTable = new Dictionary<string, NormalProduction>();
-
         private static bool CodeCheck(Expansion exp) {
             if (exp is RegularExpression)
                 return false;
@@ -132,13 +137,23 @@ namespace Deveel.CSharpCC.Parser {
         private const int OPENIF = 1;
         private const int OPENSWITCH = 2;
 
-        private static String buildLookaheadChecker(Lookahead[] conds, String[] actions) {
+        private static void buildLookaheadChecker(Lookahead[] conds, CodeWriter[] actions, CodeWriter writer) {
+            buildLookaheadChecker(conds, actions, false, writer);
+        }
+
+        /**
+         * Generates the lookahead that selects one of the actions: the last action is taken when
+         * none of the conditions holds, and lastCompletes tells that it can complete normally,
+         * so that a break must end it in the default of a switch.
+         */
+        private static void buildLookaheadChecker(Lookahead[] conds, CodeWriter[] actions, bool lastCompletes, CodeWriter writer) {
 
             // The state variables.
             int state = NOOPENSTM;
             int indentAmt = 0;
+            // The statements opened in the default of a switch, that a break must follow.
+            IList<int> inDefault = new List<int>();
             bool[] casedValues = new bool[CSharpCCGlobals.tokenCount];
-            String retval = "";
             Lookahead la;
             Token t = null;
             int tokenMaskSize = (CSharpCCGlobals.tokenCount - 1)/32 + 1;
@@ -173,32 +188,37 @@ namespace Deveel.CSharpCC.Parser {
                         // case, an "if" statement is generated.
                         switch (state) {
                             case NOOPENSTM:
-                                retval += "\n" + "if (";
+                                writer.Write("\n" + "if (");
                                 indentAmt++;
                                 break;
                             case OPENIF:
-                                retval += "\u0002\n" + "} else if (";
+                                writer.Outdent();
+                                writer.Write("\n" + "} else if (");
                                 break;
                             case OPENSWITCH:
-                                retval += "\u0002\n" + "default:" + "\u0001";
+                                writer.Outdent();
+                                writer.Write("\n" + "default:");
+                                writer.Indent();
                                 if (Options.getErrorReporting()) {
-                                    retval += "\ncc_la1[" + CSharpCCGlobals.maskindex + "] = cc_gen;";
+                                    writer.Write("\ncc_la1[" + CSharpCCGlobals.maskindex + "] = cc_gen;");
                                     CSharpCCGlobals.maskindex++;
                                 }
                                 CSharpCCGlobals.maskVals.Add(tokenMask);
-                                retval += "\n" + "if (";
-                                indentAmt++;
+                                writer.Write("\n" + "if (");
+                                inDefault.Add(indentAmt++);
                                 break;
                         }
 
                         CSharpCCGlobals.PrintTokenSetup(la.ActionTokens[0]);
                         foreach (var token in la.ActionTokens) {
                             t = token;
-                            retval += CSharpCCGlobals.PrintToken(t);
+                            CSharpCCGlobals.PrintToken(t, writer);
                         }
 
-                        retval += CSharpCCGlobals.PrintTrailingComments(t);
-                        retval += ") {\u0001" + actions[index];
+                        CSharpCCGlobals.PrintTrailingComments(t, writer);
+                        writer.Write(") {");
+                        writer.Indent();
+                        writer.Write(actions[index]);
                         state = OPENIF;
                     }
 
@@ -224,15 +244,19 @@ namespace Deveel.CSharpCC.Parser {
                         // is one (excluding the earlier cases such as JAVACODE, etc.).
                         switch (state) {
                             case OPENIF:
-                                retval += "\u0002\n" + "} else {\u0001";
+                                writer.Outdent();
+                                writer.Write("\n" + "} else {");
+                                writer.Indent();
                                 // Control flows through to next case.
                                 goto case NOOPENSTM;
                             case NOOPENSTM:
-                                retval += "\n" + "switch (";
+                                writer.Write("\n" + "switch (");
                                 if (Options.getCacheTokens()) {
-                                    retval += "cc_nt.Kind) {\u0001";
+                                    writer.Write("cc_nt.Kind) {");
+                                    writer.Indent();
                                 } else {
-                                    retval += "(cc_ntKind==-1)?cc_ntk():cc_ntKind) {\u0001";
+                                    writer.Write("(cc_ntKind==-1)?cc_ntk():cc_ntKind) {");
+                                    writer.Indent();
                                 }
                                 for (int i = 0; i < CSharpCCGlobals.tokenCount; i++) {
                                     casedValues[i] = false;
@@ -249,22 +273,24 @@ namespace Deveel.CSharpCC.Parser {
                             if (firstSet[i]) {
                                 if (!casedValues[i]) {
                                     casedValues[i] = true;
-                                    retval += "\u0002\ncase ";
+                                    writer.Outdent();
+                                    writer.Write("\ncase ");
                                     int j1 = i/32;
                                     int j2 = i%32;
                                     tokenMask[j1] |= 1 << j2;
                                     string s;
                                     if (!CSharpCCGlobals.names_of_tokens.TryGetValue(i, out s)) {
-                                        retval += i;
+                                        writer.Write(i);
                                     } else {
-                                        retval += s;
+                                        writer.Write(s);
                                     }
-                                    retval += ":\u0001";
+                                    writer.Write(":");
+                                    writer.Indent();
                                 }
                             }
                         }
-                        retval += actions[index];
-                        retval += "\nbreak;";
+                        writer.Write(actions[index]);
+                        writer.Write("\nbreak;");
                         state = OPENSWITCH;
                     }
 
@@ -282,43 +308,49 @@ namespace Deveel.CSharpCC.Parser {
 
                     switch (state) {
                         case NOOPENSTM:
-                            retval += "\n" + "if (";
+                            writer.Write("\n" + "if (");
                             indentAmt++;
                             break;
                         case OPENIF:
-                            retval += "\u0002\n" + "} else if (";
+                            writer.Outdent();
+                            writer.Write("\n" + "} else if (");
                             break;
                         case OPENSWITCH:
-                            retval += "\u0002\n" + "default:" + "\u0001";
+                            writer.Outdent();
+                            writer.Write("\n" + "default:");
+                            writer.Indent();
                             if (Options.getErrorReporting()) {
-                                retval += "\ncc_la1[" + CSharpCCGlobals.maskindex + "] = cc_gen;";
+                                writer.Write("\ncc_la1[" + CSharpCCGlobals.maskindex + "] = cc_gen;");
                                 CSharpCCGlobals.maskindex++;
                             }
                             CSharpCCGlobals.maskVals.Add(tokenMask);
-                            retval += "\n" + "if (";
-                            indentAmt++;
+                            writer.Write("\n" + "if (");
+                            inDefault.Add(indentAmt++);
                             break;
                     }
                     CSharpCCGlobals.cc2index++;
                     // At this point, la.la_expansion.InternalName must be "".
                     la.Expansion.InternalName = "_" + CSharpCCGlobals.cc2index;
                     phase2list.Add(la);
-                    retval += "cc_2" + la.Expansion.InternalName + "(" + la.Amount + ")";
+                    LookaheadProfileGen.AddSite(la, choiceProduction);
+                    writer.Write("cc_2" + la.Expansion.InternalName + "(" + la.Amount + ")");
                     if (la.ActionTokens.Count != 0) {
                         // In addition, there is also a semantic lookahead.  So concatenate
                         // the semantic check with the syntactic one.
-                        retval += " && (";
+                        writer.Write(" && (");
                         CSharpCCGlobals.PrintTokenSetup(la.ActionTokens[0]);
                         foreach (var token in la.ActionTokens) {
                             t = token;
-                            retval += CSharpCCGlobals.PrintToken(t);
+                            CSharpCCGlobals.PrintToken(t, writer);
                         }
 
-                        retval += CSharpCCGlobals.PrintTrailingComments(t);
-                        retval += ")";
+                        CSharpCCGlobals.PrintTrailingComments(t, writer);
+                        writer.Write(")");
                     }
 
-                    retval += ") {\u0001" + actions[index];
+                    writer.Write(") {");
+                    writer.Indent();
+                    writer.Write(actions[index]);
                     state = OPENIF;
                 }
 
@@ -331,57 +363,93 @@ namespace Deveel.CSharpCC.Parser {
 
             switch (state) {
                 case NOOPENSTM:
-                    retval += actions[index];
+                    writer.Write(actions[index]);
                     break;
                 case OPENIF:
-                    retval += "\u0002\n" + "} else {\u0001" + actions[index];
+                    writer.Outdent();
+                    writer.Write("\n" + "} else {");
+                    writer.Indent();
+                    writer.Write(actions[index]);
                     break;
                 case OPENSWITCH:
-                    retval += "\u0002\n" + "default:" + "\u0001";
+                    writer.Outdent();
+                    writer.Write("\n" + "default:");
+                    writer.Indent();
                     if (Options.getErrorReporting()) {
-                        retval += "\ncc_la1[" + CSharpCCGlobals.maskindex + "] = cc_gen;";
+                        writer.Write("\ncc_la1[" + CSharpCCGlobals.maskindex + "] = cc_gen;");
                         CSharpCCGlobals.maskVals.Add(tokenMask);
                         CSharpCCGlobals.maskindex++;
                     }
-                    retval += actions[index];
+                    writer.Write(actions[index]);
+                    // C# does not let control fall out of the default of a switch.
+                    if (index < conds.Length || lastCompletes)
+                        writer.Write("\nbreak;");
                     break;
             }
 
-            for (int i = 0; i < indentAmt; i++) {
-                retval += "\u0002\n}";
+            for (int i = indentAmt - 1; i >= 0; i--) {
+                writer.Outdent();
+                writer.Write("\n}");
+                if (inDefault.Contains(i))
+                    writer.Write("\nbreak;");
             }
-
-            return retval;
         }
 
-        internal static void dumpFormattedString(String str) {
-            char ch = ' ';
-            char prevChar;
-            bool indentOn = true;
-            for (int i = 0; i < str.Length; i++) {
-                prevChar = ch;
-                ch = str[i];
-                if (ch == '\n' && prevChar == '\r') {
-                    // do nothing - we've already printed a new line for the '\r'
-                    // during the previous iteration.
-                } else if (ch == '\n' || ch == '\r') {
-                    if (indentOn) {
-                        phase1NewLine();
-                    } else {
-                        ostr.WriteLine();
+        /**
+         * Moves first the alternatives of a choice taken most often in the profile.
+         * This is only done when no alternative has a semantic lookahead and they
+         * all start with different tokens: at most one of them can then match, and
+         * their order does not change what is parsed.
+         */
+
+        private static void OrderByProfile(Lookahead[] conds, CodeWriter[] actions, long[] counts) {
+            if (counts == null || conds.Length < 2)
+                return;
+
+            bool[][] firstSets = new bool[conds.Length][];
+            for (int i = 0; i < conds.Length; i++) {
+                Lookahead la = conds[i];
+                if (la.Amount == 0 || la.ActionTokens.Count != 0 ||
+                    Semanticize.EmptyExpansionExists(la.Expansion) || CodeCheck(la.Expansion))
+                    return;
+
+                firstSet = new bool[CSharpCCGlobals.tokenCount];
+                cc2LA = false;
+                GenFirstSet(la.Expansion);
+                if (cc2LA)
+                    return;
+
+                firstSets[i] = firstSet;
+                for (int j = 0; j < i; j++) {
+                    for (int k = 0; k < CSharpCCGlobals.tokenCount; k++) {
+                        if (firstSets[i][k] && firstSets[j][k])
+                            return;
                     }
-                } else if (ch == '\u0001') {
-                    indentamt += 2;
-                } else if (ch == '\u0002') {
-                    indentamt -= 2;
-                } else if (ch == '\u0003') {
-                    indentOn = false;
-                } else if (ch == '\u0004') {
-                    indentOn = true;
-                } else {
-                    ostr.Write(ch);
                 }
             }
+
+            int[] order = new int[conds.Length];
+            for (int i = 0; i < order.Length; i++)
+                order[i] = i;
+            Array.Sort(order, delegate(int x, int y) {
+                int c = counts[y].CompareTo(counts[x]);
+                return c != 0 ? c : x.CompareTo(y);
+            });
+
+            Lookahead[] orderedConds = new Lookahead[conds.Length];
+            CodeWriter[] orderedActions = new CodeWriter[conds.Length];
+            bool moved = false;
+            for (int i = 0; i < order.Length; i++) {
+                orderedConds[i] = conds[order[i]];
+                orderedActions[i] = actions[order[i]];
+                moved |= order[i] != i;
+            }
+
+            if (moved) {
+                Array.Copy(orderedConds, conds, conds.Length);
+                Array.Copy(orderedActions, actions, conds.Length);
+                GenerationStats.Add("Choices ordered by profile", 1);
+            }
         }
 
         private static void buildPhase1Routine(BnfProduction p) {
@@ -411,12 +479,25 @@ namespace Deveel.CSharpCC.Parser {
             }
             ostr.Write(") {");
             indentamt = 4;
-            if (Options.getDebugParser()) {
+            if (Options.getDebugParser() || InstrumentGen.Enabled || TreeGen.Enabled || EventSinkGen.Enabled) {
                 ostr.WriteLine("");
-                ostr.WriteLine("    trace_call(\"" + p.Lhs + "\");");
+                if (InstrumentGen.Enabled)
+                    ostr.WriteLine("    cc_enter(" + InstrumentGen.ProductionId(p) + ");");
+                if (Options.getDebugParser())
+                    ostr.WriteLine("    trace_call(\"" + p.Lhs + "\");");
+                if (TreeGen.Enabled)
+                    ostr.WriteLine("    int cc_node = cc_tree.Open(" + InstrumentGen.ProductionId(p) + ", token);");
+                if (EventSinkGen.Enabled)
+                    ostr.WriteLine("    cc_sink.Enter(" + InstrumentGen.ProductionId(p) + ");");
                 ostr.Write("    try {");
                 indentamt = 6;
             }
+            if (ProfileGen.Enabled) {
+                ostr.WriteLine("");
+                ostr.Write(new String(' ', indentamt) + ProfileGen.ClassName + ".Enter(" + InstrumentGen.ProductionId(p) + ");");
+            }
+            choiceProduction = p.Lhs;
+            choiceOrdinal = 0;
             if (p.DeclarationTokens.Count != 0) {
                 CSharpCCGlobals.PrintTokenSetup(p.DeclarationTokens[0]);
                 CSharpCCGlobals.cline--;
@@ -426,112 +507,117 @@ namespace Deveel.CSharpCC.Parser {
                 }
                 CSharpCCGlobals.PrintTrailingComments(t, ostr);
             }
-            String code = phase1ExpansionGen(p.Expansion);
-            dumpFormattedString(code);
+            phase1ExpansionGen(p.Expansion, new CodeWriter(ostr, indentamt));
             ostr.WriteLine("");
             if (p.IsJumpPatched && !voidReturn) {
                 ostr.WriteLine("    throw new InvalidOperationException(\"Missing return statement in function\");");
             }
-            if (Options.getDebugParser()) {
+            if (Options.getDebugParser() || InstrumentGen.Enabled || TreeGen.Enabled || EventSinkGen.Enabled) {
                 ostr.WriteLine("    } finally {");
-                ostr.WriteLine("      trace_return(\"" + p.Lhs + "\");");
+                if (EventSinkGen.Enabled)
+                    ostr.WriteLine("      cc_sink.Exit(" + InstrumentGen.ProductionId(p) + ");");
+                if (TreeGen.Enabled)
+                    ostr.WriteLine("      cc_tree.Close(cc_node, token);");
+                if (Options.getDebugParser())
+                    ostr.WriteLine("      trace_return(\"" + p.Lhs + "\");");
+                if (InstrumentGen.Enabled)
+                    ostr.WriteLine("      cc_exit();");
                 ostr.WriteLine("    }");
             }
             ostr.WriteLine("  }");
             ostr.WriteLine("");
         }
 
-        private static void phase1NewLine() {
-            ostr.WriteLine("");
-            for (int i = 0; i < indentamt; i++) {
-                ostr.Write(" ");
-            }
-        }
-
-        private static String phase1ExpansionGen(Expansion e) {
-            String retval = "";
+        private static void phase1ExpansionGen(Expansion e, CodeWriter writer) {
             Token t = null;
             Lookahead[] conds;
-            String[] actions;
+            CodeWriter[] actions;
             if (e is RegularExpression) {
                 RegularExpression e_nrw = (RegularExpression) e;
-                retval += "\n";
+                writer.Write("\n");
                 if (e_nrw.LhsTokens.Count != 0) {
                     CSharpCCGlobals.PrintTokenSetup(e_nrw.LhsTokens[0]);
                     foreach (var token in e_nrw.LhsTokens) {
                         t = token;
-                        retval += CSharpCCGlobals.PrintToken(t);
+                        CSharpCCGlobals.PrintToken(t, writer);
                     }
-                    retval += CSharpCCGlobals.PrintTrailingComments(t);
-                    retval += " = ";
+                    CSharpCCGlobals.PrintTrailingComments(t, writer);
+                    writer.Write(" = ");
                 }
                 String tail = e_nrw.RhsToken == null ? ");" : ")." + e_nrw.RhsToken.image + ";";
                 if (e_nrw.Label.Equals("")) {
                     string label;
                     if (CSharpCCGlobals.names_of_tokens.TryGetValue(e_nrw.Ordinal, out label)) {
-                        retval += "cc_consume_token(" + label + tail;
+                        writer.Write("cc_consume_token(" + label + tail);
                     } else {
-                        retval += "cc_consume_token(" + e_nrw.Ordinal + tail;
+                        writer.Write("cc_consume_token(" + e_nrw.Ordinal + tail);
                     }
                 } else {
-                    retval += "cc_consume_token(" + e_nrw.Label + tail;
+                    writer.Write("cc_consume_token(" + e_nrw.Label + tail);
                 }
             } else if (e is NonTerminal) {
                 NonTerminal e_nrw = (NonTerminal) e;
-                retval += "\n";
+                writer.Write("\n");
                 if (e_nrw.LhsTokens.Count != 0) {
                     CSharpCCGlobals.PrintTokenSetup(e_nrw.LhsTokens[0]);
                     foreach (var token in e_nrw.LhsTokens) {
                         t = token;
-                        retval += CSharpCCGlobals.PrintToken(t);
+                        CSharpCCGlobals.PrintToken(t, writer);
                     }
-                    retval += CSharpCCGlobals.PrintTrailingComments(t);
-                    retval += " = ";
+                    CSharpCCGlobals.PrintTrailingComments(t, writer);
+                    writer.Write(" = ");
                 }
-                retval += e_nrw.Name + "(";
+                writer.Write(e_nrw.Name + "(");
                 if (e_nrw.ArgumentTokens.Count != 0) {
                     CSharpCCGlobals.PrintTokenSetup(e_nrw.ArgumentTokens[0]);
                     foreach (var token in e_nrw.ArgumentTokens) {
                         t = token;
-                        retval += CSharpCCGlobals.PrintToken(t);
+                        CSharpCCGlobals.PrintToken(t, writer);
                     }
-                    retval += CSharpCCGlobals.PrintTrailingComments(t);
+                    CSharpCCGlobals.PrintTrailingComments(t, writer);
                 }
-                retval += ");";
+                writer.Write(");");
             } else if (e is Action) {
                 Action e_nrw = (Action) e;
-                retval += "\u0003\n";
+                writer.Verbatim = true;
+                writer.Write("\n");
                 if (e_nrw.ActionTokens.Count != 0) {
                     CSharpCCGlobals.PrintTokenSetup(e_nrw.ActionTokens[0]);
                     CSharpCCGlobals.ccol = 1;
                     foreach (var token in e_nrw.ActionTokens) {
                         t = token;
-                        retval += CSharpCCGlobals.PrintToken(t);
+                        CSharpCCGlobals.PrintToken(t, writer);
                     }
-                    retval += CSharpCCGlobals.PrintTrailingComments(t);
+                    CSharpCCGlobals.PrintTrailingComments(t, writer);
                 }
-                retval += "\u0004";
+                writer.Verbatim = false;
             } else if (e is Choice) {
                 Choice e_nrw = (Choice) e;
+                int ordinal = choiceOrdinal++;
+                int profileOffset = ProfileGen.AddChoice(choiceProduction, ordinal, e_nrw.Choices.Count);
                 conds = new Lookahead[e_nrw.Choices.Count];
-                actions = new String[e_nrw.Choices.Count + 1];
-                actions[e_nrw.Choices.Count] = "\n" + "cc_consume_token(-1);\n" + "throw new ParseException();";
+                actions = new CodeWriter[e_nrw.Choices.Count + 1];
+                actions[e_nrw.Choices.Count] = new CodeWriter("\n" + "cc_consume_token(-1);\n" + "throw new ParseException();");
                 // In previous line, the "throw" never throws an exception since the
                 // evaluation of cc_consume_token(-1) causes ParseException to be
                 // thrown first.
                 Sequence nestedSeq;
                 for (int i = 0; i < e_nrw.Choices.Count; i++) {
                     nestedSeq = (Sequence) (e_nrw.Choices[i]);
-                    actions[i] = phase1ExpansionGen(nestedSeq);
+                    actions[i] = new CodeWriter();
+                    if (profileOffset >= 0)
+                        actions[i].Write("\n" + ProfileGen.ClassName + ".Choice(" + (profileOffset + i) + ");");
+                    phase1ExpansionGen(nestedSeq, actions[i]);
                     conds[i] = (Lookahead) (nestedSeq.Units[0]);
                 }
-                retval = buildLookaheadChecker(conds, actions);
+                OrderByProfile(conds, actions, ProfileGen.GetChoiceCounts(choiceProduction, ordinal, e_nrw.Choices.Count));
+                buildLookaheadChecker(conds, actions, writer);
             } else if (e is Sequence) {
                 Sequence e_nrw = (Sequence) e;
                 // We skip the first element in the following iteration since it is the
                 // Lookahead object.
                 foreach (var unit in e_nrw.Units) {
-                    retval += phase1ExpansionGen(unit);
+                    phase1ExpansionGen(unit, writer);
                 }
             } else if (e is OneOrMore) {
                 OneOrMore e_nrw = (OneOrMore) e;
@@ -544,18 +630,20 @@ namespace Deveel.CSharpCC.Parser {
                     la.Amount = Options.getLookahead();
                     la.Expansion = nested_e;
                 }
-                retval += "\n";
+                writer.Write("\n");
                 int labelIndex = ++gensymindex;
-                retval += "while (true) {\u0001";
-                retval += phase1ExpansionGen(nested_e);
+                writer.Write("while (true) {");
+                writer.Indent();
+                phase1ExpansionGen(nested_e, writer);
                 conds = new Lookahead[1];
                 conds[0] = la;
-                actions = new String[2];
-                actions[0] = "\n;";
-                actions[1] = "\ngoto label_" + labelIndex + ";";
-                retval += buildLookaheadChecker(conds, actions);
-                retval += "\u0002\n" + "}";
-                retval += "label_" + labelIndex + ":;\n";
+                actions = new CodeWriter[2];
+                actions[0] = new CodeWriter("\n;");
+                actions[1] = new CodeWriter("\ngoto label_" + labelIndex + ";");
+                buildLookaheadChecker(conds, actions, writer);
+                writer.Outdent();
+                writer.Write("\n" + "}");
+                writer.Write("label_" + labelIndex + ":;\n");
             } else if (e is ZeroOrMore) {
                 ZeroOrMore e_nrw = (ZeroOrMore) e;
                 Expansion nested_e = e_nrw.Expansion;
@@ -567,18 +655,20 @@ namespace Deveel.CSharpCC.Parser {
                     la.Amount = Options.getLookahead();
                     la.Expansion = nested_e;
                 }
-                retval += "\n";
+                writer.Write("\n");
                 int labelIndex = ++gensymindex;
-                retval += "while (true) {\u0001";
+                writer.Write("while (true) {");
+                writer.Indent();
                 conds = new Lookahead[1];
                 conds[0] = la;
-                actions = new String[2];
-                actions[0] = "\n;";
-                actions[1] = "\ngoto label_" + labelIndex + ";";
-                retval += buildLookaheadChecker(conds, actions);
-                retval += phase1ExpansionGen(nested_e);
-                retval += "\u0002\n" + "}";
-                retval += "label_" + labelIndex + ":;\n";
+                actions = new CodeWriter[2];
+                actions[0] = new CodeWriter("\n;");
+                actions[1] = new CodeWriter("\ngoto label_" + labelIndex + ";");
+                buildLookaheadChecker(conds, actions, writer);
+                phase1ExpansionGen(nested_e, writer);
+                writer.Outdent();
+                writer.Write("\n" + "}");
+                writer.Write("label_" + labelIndex + ":;\n");
             } else if (e is ZeroOrOne) {
                 ZeroOrOne e_nrw = (ZeroOrOne) e;
                 Expansion nested_e = e_nrw.Expansion;
@@ -592,72 +682,93 @@ namespace Deveel.CSharpCC.Parser {
                 }
                 conds = new Lookahead[1];
                 conds[0] = la;
-                actions = new String[2];
-                actions[0] = phase1ExpansionGen(nested_e);
-                actions[1] = "\n;";
-                retval += buildLookaheadChecker(conds, actions);
+                actions = new CodeWriter[2];
+                actions[0] = new CodeWriter();
+                phase1ExpansionGen(nested_e, actions[0]);
+                actions[1] = new CodeWriter("\n;");
+                buildLookaheadChecker(conds, actions, true, writer);
             } else if (e is TryBlock) {
                 TryBlock e_nrw = (TryBlock) e;
                 Expansion nested_e = e_nrw.Expansion;
                 IList<Token> list;
-                retval += "\n";
-                retval += "try {\u0001";
-                retval += phase1ExpansionGen(nested_e);
-                retval += "\u0002\n" + "}";
+                writer.Write("\n");
+                writer.Write("try {");
+                writer.Indent();
+                phase1ExpansionGen(nested_e, writer);
+                writer.Outdent();
+                writer.Write("\n" + "}");
                 for (int i = 0; i < e_nrw.CatchBlocks.Count; i++) {
-                    retval += " catch (";
+                    writer.Write(" catch (");
                     list = e_nrw.Types[i];
                     if (list.Count != 0) {
                         CSharpCCGlobals.PrintTokenSetup(list[0]);
                         foreach (var token in list) {
                             t = token;
-                            retval += CSharpCCGlobals.PrintToken(t);
+                            CSharpCCGlobals.PrintToken(t, writer);
                         }
-                        retval += CSharpCCGlobals.PrintTrailingComments(t);
+                        CSharpCCGlobals.PrintTrailingComments(t, writer);
                     }
-                    retval += " ";
+                    writer.Write(" ");
                     t = e_nrw.Ids[i];
                     CSharpCCGlobals.PrintTokenSetup(t);
-                    retval += CSharpCCGlobals.PrintToken(t);
-                    retval += CSharpCCGlobals.PrintTrailingComments(t);
-                    retval += ") {\u0003\n";
+                    CSharpCCGlobals.PrintToken(t, writer);
+                    CSharpCCGlobals.PrintTrailingComments(t, writer);
+                    writer.Write(") {");
+                    writer.Verbatim = true;
+                    writer.Write("\n");
                     list = e_nrw.CatchBlocks[i];
                     if (list.Count != 0) {
                         CSharpCCGlobals.PrintTokenSetup(list[0]);
                         CSharpCCGlobals.ccol = 1;
                         foreach (var token in list) {
                             t = token;
-                            retval += CSharpCCGlobals.PrintToken(t);
+                            CSharpCCGlobals.PrintToken(t, writer);
                         }
-                        retval += CSharpCCGlobals.PrintTrailingComments(t);
+                        CSharpCCGlobals.PrintTrailingComments(t, writer);
                     }
-                    retval += "\u0004\n" + "}";
+                    writer.Verbatim = false;
+                    writer.Write("\n" + "}");
                 }
                 if (e_nrw.FinallyBlocks != null) {
-                    retval += " finally {\u0003\n";
+                    writer.Write(" finally {");
+                    writer.Verbatim = true;
+                    writer.Write("\n");
                     if (e_nrw.FinallyBlocks.Count != 0) {
                         CSharpCCGlobals.PrintTokenSetup(e_nrw.FinallyBlocks[0]);
                         CSharpCCGlobals.ccol = 1;
                         foreach (var token in e_nrw.FinallyBlocks) {
                             t = token;
-                            retval += CSharpCCGlobals.PrintToken(t);
+                            CSharpCCGlobals.PrintToken(t, writer);
                         }
-                        retval += CSharpCCGlobals.PrintTrailingComments(t);
+                        CSharpCCGlobals.PrintTrailingComments(t, writer);
                     }
-                    retval += "\u0004\n" + "}";
+                    writer.Verbatim = false;
+                    writer.Write("\n" + "}");
                 }
             }
-            return retval;
         }
 
         private static void buildPhase2Routine(Lookahead la) {
             Expansion e = la.Expansion;
             ostr.WriteLine("  private " + CSharpCCGlobals.staticOpt() + " bool cc_2" + e.InternalName + "(int xla) {");
             ostr.WriteLine("    cc_la = xla; cc_lastpos = cc_scanpos = token;");
-            ostr.WriteLine("    try { return !cc_3" + e.InternalName + "(); }");
-            ostr.WriteLine("    catch(LookaheadSuccess) { return true; }");
-            if (Options.getErrorReporting())
-                ostr.WriteLine("    finally { cc_save(" + (Int32.Parse(e.InternalName.Substring(1), CultureInfo.InvariantCulture) - 1) + ", xla); }");
+            int site = Int32.Parse(e.InternalName.Substring(1), CultureInfo.InvariantCulture) - 1;
+            if (Options.getProfileLookahead()) {
+                ostr.WriteLine("    long cc_scanned_before = cc_scanned;");
+                ostr.WriteLine("    bool cc_found = false;");
+                ostr.WriteLine("    try { return cc_found = !cc_3" + e.InternalName + "(); }");
+                ostr.WriteLine("    catch(LookaheadSuccess) { return cc_found = true; }");
+                ostr.WriteLine("    finally {");
+                if (Options.getErrorReporting())
+                    ostr.WriteLine("      cc_save(" + site + ", xla);");
+                ostr.WriteLine("      " + LookaheadProfileGen.ClassName + ".Record(" + site + ", cc_found, cc_scanned - cc_scanned_before);");
+                ostr.WriteLine("    }");
+            } else {
+                ostr.WriteLine("    try { return !cc_3" + e.InternalName + "(); }");
+                ostr.WriteLine("    catch(LookaheadSuccess) { return true; }");
+                if (Options.getErrorReporting())
+                    ostr.WriteLine("    finally { cc_save(" + site + ", xla); }");
+            }
             ostr.WriteLine("  }");
             ostr.WriteLine("");
             Phase3Data p3d = new Phase3Data(e, la.Amount);
@@ -691,7 +802,7 @@ namespace Deveel.CSharpCC.Parser {
                         seq = ((Sequence) seq).Units[1];
                     } else if (seq is NonTerminal) {
                         NonTerminal e_nrw = (NonTerminal) seq;
-                        NormalProduction ntprod = productionTable[e_nrw.Name];
+                        NormalProduction ntprod = CSharpCCGlobals.production_table[e_nrw.Name];
                         if (ntprod is CodeProduction) {
                             break; // nothing to do here
                         } else {
@@ -702,7 +813,7 @@ namespace Deveel.CSharpCC.Parser {
                 }
 
                 if (seq is RegularExpression) {
-                    e.InternalName = "cc_scan_token(" + seq.Ordinal + ")";
+                    e.InternalName = "cc_scan_token(" + ((RegularExpression) seq).Ordinal + ")";
                     return;
                 }
 
@@ -728,7 +839,7 @@ namespace Deveel.CSharpCC.Parser {
                 // fact, we rely here on the fact that the "name" fields of both these
                 // variables are the same.
                 NonTerminal e_nrw = (NonTerminal) e;
-                NormalProduction ntprod = productionTable[e_nrw.Name];
+                NormalProduction ntprod = CSharpCCGlobals.production_table[e_nrw.Name];
                 if (ntprod is CodeProduction) {
                     ; // nothing to do here
                 } else {
@@ -808,7 +919,7 @@ namespace Deveel.CSharpCC.Parser {
                 // fact, we rely here on the fact that the "name" fields of both these
                 // variables are the same.
                 NonTerminal e_nrw = (NonTerminal) e;
-                NormalProduction ntprod = productionTable[e_nrw.Name];
+                NormalProduction ntprod = CSharpCCGlobals.production_table[e_nrw.Name];
                 if (ntprod is CodeProduction) {
                     ostr.WriteLine("    if (true) { cc_la = 0; cc_scanpos = cc_lastpos; " + genReturn(false) + "}");
                 } else {
@@ -928,7 +1039,7 @@ namespace Deveel.CSharpCC.Parser {
                 retval = 1;
             } else if (e is NonTerminal) {
                 NonTerminal e_nrw = (NonTerminal) e;
-                NormalProduction ntprod = productionTable[e_nrw.Name];
+                NormalProduction ntprod = CSharpCCGlobals.production_table[e_nrw.Name];
                 if (ntprod is CodeProduction) {
                     retval = Int32.MaxValue;
                     // Make caller think this is unending (for we do not go beyond JAVACODE during
@@ -1017,9 +1128,14 @@ namespace Deveel.CSharpCC.Parser {
                         CSharpCCGlobals.PrintTrailingComments(t, ostr);
                     }
                     ostr.Write(") {");
-                    if (Options.getDebugParser()) {
+                    if (Options.getDebugParser() || InstrumentGen.Enabled || EventSinkGen.Enabled) {
                         ostr.WriteLine("");
-                        ostr.WriteLine("    trace_call(\"" + jp.Lhs + "\");");
+                        if (InstrumentGen.Enabled)
+                            ostr.WriteLine("    cc_enter(" + InstrumentGen.ProductionId(jp) + ");");
+                        if (Options.getDebugParser())
+                            ostr.WriteLine("    trace_call(\"" + jp.Lhs + "\");");
+                        if (EventSinkGen.Enabled)
+                            ostr.WriteLine("    cc_sink.Enter(" + InstrumentGen.ProductionId(jp) + ");");
                         ostr.Write("    try {");
                     }
                     if (jp.CodeTokens.Count != 0) {
@@ -1028,9 +1144,14 @@ namespace Deveel.CSharpCC.Parser {
                         CSharpCCGlobals.PrintTokenList(jp.CodeTokens, ostr);
                     }
                     ostr.WriteLine("");
-                    if (Options.getDebugParser()) {
+                    if (Options.getDebugParser() || InstrumentGen.Enabled || EventSinkGen.Enabled) {
                         ostr.WriteLine("    } finally {");
-                        ostr.WriteLine("      trace_return(\"" + jp.Lhs + "\");");
+                        if (EventSinkGen.Enabled)
+                            ostr.WriteLine("      cc_sink.Exit(" + InstrumentGen.ProductionId(jp) + ");");
+                        if (Options.getDebugParser())
+                            ostr.WriteLine("      trace_return(\"" + jp.Lhs + "\");");
+                        if (InstrumentGen.Enabled)
+                            ostr.WriteLine("      cc_exit();");
                         ostr.WriteLine("    }");
                     }
                     ostr.WriteLine("  }");
@@ -1044,13 +1165,18 @@ namespace Deveel.CSharpCC.Parser {
                 buildPhase2Routine(lookahead);
             }
 
-            foreach (var phase3Data in phase3list) {
-                setupPhase3Builds(phase3Data);
+            // The set up of a routine can add more to the list.
+            for (int i = 0; i < phase3list.Count; i++) {
+                setupPhase3Builds(phase3list[i]);
             }
 
             foreach (var phase3Data in phase3table) {
                 buildPhase3Routine(phase3Data.Value, false);
             }
+
+            GenerationStats.Add("Productions", CSharpCCGlobals.bnfproductions.Count);
+            GenerationStats.Add("Phase-2 routines", phase2list.Count);
+            GenerationStats.Add("Phase-3 routines", phase3table.Count);
         }
 
         public static void reInit() {
@@ -1058,6 +1184,8 @@ namespace Deveel.CSharpCC.Parser {
             gensymindex = 0;
             indentamt = 0;
             cc2LA = false;
+            choiceProduction = null;
+            choiceOrdinal = 0;
             phase2list = new List<Lookahead>();
             phase3list = new List<Phase3Data>();
             phase3table = new Dictionary<Expansion, Phase3Data>();
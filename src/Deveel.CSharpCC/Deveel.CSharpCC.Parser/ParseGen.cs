@@ -2,23 +2,31 @@
 using System.Collections.Generic;
 using System.IO;
 
+using Deveel.CSharpCC.Util;
+
 namespace Deveel.CSharpCC.Parser {
 	public class ParseGen {
 		private static TextWriter ostr;
 
+		/// <summary>
+		/// Whether the generated parser reads its tokens from a <c>TokenRing</c>
+		/// filled by the token manager on a background thread.
+		/// </summary>
+		internal static bool pipelined;
+
 		public static void start() {
 			Token t = null;
 
 			if (CSharpCCErrors.ErrorCount != 0) throw new MetaParseException();
 
+			pipelined = Options.getBuildParser() && Options.getPipelinedTokenManager() && CanPipeline();
+			string nextToken = pipelined ? "cc_next_token()" : "tokenSource.GetNextToken()";
+
 			if (Options.getBuildParser()) {
 
 				try {
 					ostr =
-						new StreamWriter(
-							new BufferedStream(
-								new FileStream(Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + ".cs"),
-								               FileMode.OpenOrCreate, FileAccess.Write), 8192));
+						new StreamWriter(new GeneratedFileStream(Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + ".cs")));
 				} catch (IOException e) {
 					CSharpCCErrors.SemanticError("Could not open file " + CSharpCCGlobals.cu_name + ".cs for writing.");
 					throw new InvalidOperationException();
@@ -31,6 +39,10 @@ namespace Deveel.CSharpCC.Parser {
 				bool implementsExists = false;
                 bool namespaceInserted = false, namespaceFound = false;
 
+			    Token sinkParameterPosition = EventSinkGen.Enabled
+			        ? EventSinkGen.FindTypeParameterPosition(CSharpCCGlobals.cu_to_insertion_point_1)
+			        : null;
+
 			    if (CSharpCCGlobals.cu_to_insertion_point_1.Count != 0) {
 			        CSharpCCGlobals.PrintTokenSetup(CSharpCCGlobals.cu_to_insertion_point_1[0]);
 			        CSharpCCGlobals.ccol = 1;
@@ -57,6 +69,13 @@ namespace Deveel.CSharpCC.Parser {
 			                CSharpCCGlobals.PrintToken(t, ostr);
 
 			            }
+
+			            if (t == sinkParameterPosition) {
+			                if (t.kind == CSharpCCParserConstants.LT)
+			                    ostr.Write(EventSinkGen.TypeParameter + ", ");
+			                else
+			                    ostr.Write("<" + EventSinkGen.TypeParameter + ">");
+			            }
 			        }
 			    }
 
@@ -66,6 +85,10 @@ namespace Deveel.CSharpCC.Parser {
 				if (implementsExists) {
 					ostr.Write(", ");
 				}
+
+				if (EventSinkGen.Enabled) {
+					ostr.Write("where " + EventSinkGen.TypeParameter + " : struct, " + EventSinkGen.InterfaceName + " ");
+				}
 				
 				if (CSharpCCGlobals.cu_to_insertion_point_2.Count != 0) {
 					CSharpCCGlobals.PrintTokenSetup(CSharpCCGlobals.cu_to_insertion_point_2[0]);
@@ -78,7 +101,9 @@ namespace Deveel.CSharpCC.Parser {
 				ostr.WriteLine("");
 				ostr.WriteLine("");
 
-				ParseEngine.build(ostr);
+				using (GenerationStats.Begin("ParseEngine.build")) {
+					ParseEngine.build(ostr);
+				}
 
 				if (Options.getStatic()) {
 					ostr.WriteLine("  private static bool cc_initialized_once = false;");
@@ -97,6 +122,9 @@ namespace Deveel.CSharpCC.Parser {
 						}
 					}
 				}
+				if (pipelined) {
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private TokenRing cc_ring;");
+				}
 				ostr.WriteLine("  /// <summary>Current token.</summary>");
 				ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public Token token;");
 				ostr.WriteLine("  /// <summary> Next token.</summary>");
@@ -117,20 +145,30 @@ namespace Deveel.CSharpCC.Parser {
 					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private int cc_gen;");
 					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + " private readonly int[] cc_la1 = new int[" + CSharpCCGlobals.maskindex + "];");
 					int tokenMaskSize = (CSharpCCGlobals.tokenCount - 1) / 32 + 1;
-					for (int i = 0; i < tokenMaskSize; i++)
-						ostr.WriteLine("  static private int[] cc_la1_" + i + ";");
-					ostr.WriteLine("  static " + CSharpCCGlobals.cu_name + "() { ");
-					for (int i = 0; i < tokenMaskSize; i++)
-						ostr.WriteLine("      cc_la1_init_" + i + "();");
-					ostr.WriteLine("   }");
-					for (int i = 0; i < tokenMaskSize; i++) {
-						ostr.WriteLine("   private static void cc_la1_init_" + i + "() {");
-						ostr.Write("      cc_la1_" + i + " = new int[] {");
-						foreach (int[] tokenMask in CSharpCCGlobals.maskVals) {
-							ostr.Write(tokenMask[i] + ",");
-						}
-						ostr.WriteLine("};");
+					if (Options.clrVersionAtLeast(7.0)) {
+						for (int i = 0; i < tokenMaskSize; i++) {
+							ostr.Write("  " + CSharpCCGlobals.TableDeclaration("static private", "int", "cc_la1_" + i) + "{");
+							foreach (int[] tokenMask in CSharpCCGlobals.maskVals) {
+								ostr.Write(tokenMask[i] + ",");
+							}
+							ostr.WriteLine("};");
+						}
+					} else {
+						for (int i = 0; i < tokenMaskSize; i++)
+							ostr.WriteLine("  static private int[] cc_la1_" + i + ";");
+						ostr.WriteLine("  static " + CSharpCCGlobals.cu_name + "() { ");
+						for (int i = 0; i < tokenMaskSize; i++)
+							ostr.WriteLine("      cc_la1_init_" + i + "();");
 						ostr.WriteLine("   }");
+						for (int i = 0; i < tokenMaskSize; i++) {
+							ostr.WriteLine("   private static void cc_la1_init_" + i + "() {");
+							ostr.Write("      cc_la1_" + i + " = new int[] {");
+							foreach (int[] tokenMask in CSharpCCGlobals.maskVals) {
+								ostr.Write(tokenMask[i] + ",");
+							}
+							ostr.WriteLine("};");
+							ostr.WriteLine("   }");
+						}
 					}
 				}
 				if (CSharpCCGlobals.cc2index != 0 && Options.getErrorReporting()) {
@@ -159,9 +197,10 @@ namespace Deveel.CSharpCC.Parser {
 						} else {
 							ostr.WriteLine("    tokenSource = new " + CSharpCCGlobals.cu_name + "TokenManager(stream);");
 						}
+						printRingStart();
 						ostr.WriteLine("    token = new Token();");
 						if (Options.getCacheTokens()) {
-							ostr.WriteLine("    token.Next = cc_nt = tokenSource.GetNextToken();");
+							ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 						} else {
 							ostr.WriteLine("    cc_ntKind = -1;");
 						}
@@ -176,10 +215,12 @@ namespace Deveel.CSharpCC.Parser {
 						ostr.WriteLine("");
 						ostr.WriteLine("  /** Reinitialise. */");
 						ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public void ReInit(ICharStream stream) {");
+						printRingStop();
 						ostr.WriteLine("    tokenSource.ReInit(stream);");
+						printRingStart();
 						ostr.WriteLine("    token = new Token();");
 						if (Options.getCacheTokens()) {
-							ostr.WriteLine("    token.Next = cc_nt = tokenSource.GetNextToken();");
+							ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 						} else {
 							ostr.WriteLine("    cc_ntKind = -1;");
 						}
@@ -189,6 +230,9 @@ namespace Deveel.CSharpCC.Parser {
 						if (CSharpCCGlobals.TreeGenerated) {
 							ostr.WriteLine("    ccTree.Reset();");
 						}
+						if (TreeGen.Enabled) {
+							ostr.WriteLine("    cc_tree.Reset();");
+						}
 						if (Options.getErrorReporting()) {
 							ostr.WriteLine("    cc_gen = 0;");
 							ostr.WriteLine("    for (int i = 0; i < " + CSharpCCGlobals.maskindex + "; i++) cc_la1[i] = -1;");
@@ -225,9 +269,10 @@ namespace Deveel.CSharpCC.Parser {
 						} else {
 							ostr.WriteLine("    tokenSource = new " +CSharpCCGlobals.cu_name + "TokenManager(cc_inputStream);");
 						}
+						printRingStart();
 						ostr.WriteLine("    token = new Token();");
 						if (Options.getCacheTokens()) {
-							ostr.WriteLine("    token.Next = cc_nt = tokenSource.GetNextToken();");
+							ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 						} else {
 							ostr.WriteLine("    cc_ntKind = -1;");
 						}
@@ -246,17 +291,22 @@ namespace Deveel.CSharpCC.Parser {
 						ostr.WriteLine("  }");
 						ostr.WriteLine("  /// Reinitialise.");
 						ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public void ReInit(System.IO.Stream stream, System.Text.Encoding encoding) {");
+						printRingStop();
 							ostr.WriteLine("   cc_inputStream.ReInit(stream, encoding, 1, 1);");
 						ostr.WriteLine("    tokenSource.ReInit(cc_inputStream);");
+						printRingStart();
 						ostr.WriteLine("    token = new Token();");
 						if (Options.getCacheTokens()) {
-							ostr.WriteLine("    token.Next = cc_nt = tokenSource.GetNextToken();");
+							ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 						} else {
 							ostr.WriteLine("    cc_ntKind = -1;");
 						}
 						if (CSharpCCGlobals.TreeGenerated) {
 							ostr.WriteLine("    ccTree.Reset();");
 						}
+						if (TreeGen.Enabled) {
+							ostr.WriteLine("    cc_tree.Reset();");
+						}
 						if (Options.getErrorReporting()) {
 							ostr.WriteLine("    cc_gen = 0;");
 							ostr.WriteLine("    for (int i = 0; i < " + CSharpCCGlobals.maskindex + "; i++) cc_la1[i] = -1;");
@@ -288,9 +338,10 @@ namespace Deveel.CSharpCC.Parser {
 						} else {
 							ostr.WriteLine("    tokenSource = new " + CSharpCCGlobals.cu_name + "TokenManager(cc_inputStream);");
 						}
+						printRingStart();
 						ostr.WriteLine("    token = new Token();");
 						if (Options.getCacheTokens()) {
-							ostr.WriteLine("    token.Next = cc_nt = tokenSource.GetNextToken();");
+							ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 						} else {
 							ostr.WriteLine("    cc_ntKind = -1;");
 						}
@@ -305,21 +356,26 @@ namespace Deveel.CSharpCC.Parser {
 						ostr.WriteLine("");
 						ostr.WriteLine("  /// Reinitialise.");
 						ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public void ReInit(System.IO.TextReader reader) {");
+						printRingStop();
 						if (Options.getUnicodeEscape()) {
 							ostr.WriteLine("    cc_inputStream.ReInit(reader, 1, 1);");
 						} else {
 							ostr.WriteLine("    cc_inputStream.ReInit(reader, 1, 1);");
 						}
 						ostr.WriteLine("    tokenSource.ReInit(cc_inputStream);");
+						printRingStart();
 						ostr.WriteLine("    token = new Token();");
 						if (Options.getCacheTokens()) {
-							ostr.WriteLine("    token.next = cc_nt = tokenSource.GetNextToken();");
+							ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 						} else {
 							ostr.WriteLine("    cc_ntKind = -1;");
 						}
 						if (CSharpCCGlobals.TreeGenerated) {
 							ostr.WriteLine("    ccTree.Reset();");
 						}
+						if (TreeGen.Enabled) {
+							ostr.WriteLine("    cc_tree.Reset();");
+						}
 						if (Options.getErrorReporting()) {
 							ostr.WriteLine("    cc_gen = 0;");
 							ostr.WriteLine("    for (int i = 0; i < " + CSharpCCGlobals.maskindex + "; i++) cc_la1[i] = -1;");
@@ -349,9 +405,10 @@ namespace Deveel.CSharpCC.Parser {
 					ostr.WriteLine("    cc_initialized_once = true;");
 				}
 				ostr.WriteLine("    tokenSource = tm;");
+				printRingStart();
 				ostr.WriteLine("    token = new Token();");
 				if (Options.getCacheTokens()) {
-					ostr.WriteLine("    token.Next = cc_nt = tokenSource.GetNextToken();");
+					ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 				} else {
 					ostr.WriteLine("    cc_ntKind = -1;");
 				}
@@ -371,34 +428,50 @@ namespace Deveel.CSharpCC.Parser {
 					ostr.WriteLine("  /** Reinitialise. */");
 					ostr.WriteLine("  public void ReInit(" + CSharpCCGlobals.cu_name + "TokenManager tm) {");
 				}
+				printRingStop();
 				ostr.WriteLine("    tokenSource = tm;");
+				printRingStart();
 				ostr.WriteLine("    token = new Token();");
 				if (Options.getCacheTokens()) {
-					ostr.WriteLine("    token.next = cc_nt = tokenSource.GetNextToken();");
+					ostr.WriteLine("    token.Next = cc_nt = " + nextToken + ";");
 				} else {
 					ostr.WriteLine("    cc_ntKind = -1;");
 				}
 				if (CSharpCCGlobals.TreeGenerated) {
 					ostr.WriteLine("    ccTree.reset();");
 				}
+				if (TreeGen.Enabled) {
+					ostr.WriteLine("    cc_tree.Reset();");
+				}
 				if (Options.getErrorReporting()) {
 					ostr.WriteLine("    cc_gen = 0;");
 					ostr.WriteLine("    for (int i = 0; i < " + CSharpCCGlobals.maskindex + "; i++) cc_la1[i] = -1;");
 					if (CSharpCCGlobals.cc2index != 0) {
-						ostr.WriteLine("    for (int i = 0; i < cc_2_rtns.length; i++) cc_2_rtns[i] = new CCCalls();");
+						ostr.WriteLine("    for (int i = 0; i < cc_2_rtns.Length; i++) cc_2_rtns[i] = new CCCalls();");
 					}
 				}
 				ostr.WriteLine("  }");
 				ostr.WriteLine("");
+				if (pipelined) {
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private Token cc_next_token() {");
+					ostr.WriteLine("    return cc_ring.Take();");
+					ostr.WriteLine("  }");
+					ostr.WriteLine("");
+					ostr.WriteLine("  /** Stops the background thread running the token manager. */");
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public void StopTokenPipeline() {");
+					ostr.WriteLine("    if (cc_ring != null) cc_ring.Stop();");
+					ostr.WriteLine("  }");
+					ostr.WriteLine("");
+				}
 				ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private Token cc_consume_token(int kind) {");
 				if (Options.getCacheTokens()) {
 					ostr.WriteLine("    Token oldToken = token;");
 					ostr.WriteLine("    if ((token = cc_nt).Next != null) cc_nt = cc_nt.Next;");
-					ostr.WriteLine("    else cc_nt = cc_nt.Next = tokenSource.GetNextToken();");
+					ostr.WriteLine("    else cc_nt = cc_nt.Next = " + nextToken + ";");
 				} else {
 					ostr.WriteLine("    Token oldToken;");
 					ostr.WriteLine("    if ((oldToken = token).Next != null) token = token.Next;");
-					ostr.WriteLine("    else token = token.Next = tokenSource.GetNextToken();");
+					ostr.WriteLine("    else token = token.Next = " + nextToken + ";");
 					ostr.WriteLine("    cc_ntKind = -1;");
 				}
 				ostr.WriteLine("    if (token.Kind == kind) {");
@@ -407,7 +480,7 @@ namespace Deveel.CSharpCC.Parser {
 					if (CSharpCCGlobals.cc2index != 0) {
 						ostr.WriteLine("      if (++cc_gc > 100) {");
 						ostr.WriteLine("        cc_gc = 0;");
-						ostr.WriteLine("        for (int i = 0; i < cc_2_rtns.length; i++) {");
+						ostr.WriteLine("        for (int i = 0; i < cc_2_rtns.Length; i++) {");
 						ostr.WriteLine("          CCCalls c = cc_2_rtns[i];");
 						ostr.WriteLine("          while (c != null) {");
 						ostr.WriteLine("            if (c.gen < cc_gen) c.first = null;");
@@ -420,8 +493,27 @@ namespace Deveel.CSharpCC.Parser {
 				if (Options.getDebugParser()) {
 					ostr.WriteLine("      trace_token(token, \"\");");
 				}
+				if (InstrumentGen.Enabled) {
+					ostr.WriteLine("      cc_consumed++;");
+				}
+				if (ProfileGen.Enabled) {
+					ostr.WriteLine("      " + ProfileGen.ClassName + ".Consume(kind);");
+				}
+				if (EventSinkGen.Enabled) {
+					ostr.WriteLine("      cc_sink.Token(token);");
+				}
+				if (EventSinkGen.ReleasesTokens) {
+					ostr.WriteLine("      oldToken.Next = null;");
+				}
 				ostr.WriteLine("      return token;");
 				ostr.WriteLine("    }");
+				ostr.WriteLine("    return cc_consume_token_failed(oldToken, kind);");
+				ostr.WriteLine("  }");
+				ostr.WriteLine("");
+				// The error path is out of line, so that cc_consume_token stays
+				// small enough to be inlined.
+				ostr.WriteLine("  [System.Runtime.CompilerServices.MethodImpl(System.Runtime.CompilerServices.MethodImplOptions.NoInlining)]");
+				ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private Token cc_consume_token_failed(Token oldToken, int kind) {");
 				if (Options.getCacheTokens()) {
 					ostr.WriteLine("    cc_nt = token;");
 				}
@@ -435,11 +527,17 @@ namespace Deveel.CSharpCC.Parser {
 				if (CSharpCCGlobals.cc2index != 0) {
 					ostr.WriteLine("  private sealed class LookaheadSuccess : System.Exception { }");
 					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "readonly private LookaheadSuccess cc_ls = new LookaheadSuccess();");
+					if (Options.getProfileLookahead()) {
+						ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private long cc_scanned;");
+					}
 					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private bool cc_scan_token(int kind) {");
+					if (Options.getProfileLookahead()) {
+						ostr.WriteLine("    cc_scanned++;");
+					}
 					ostr.WriteLine("    if (cc_scanpos == cc_lastpos) {");
 					ostr.WriteLine("      cc_la--;");
 					ostr.WriteLine("      if (cc_scanpos.Next == null) {");
-					ostr.WriteLine("        cc_lastpos = cc_scanpos = cc_scanpos.Next = tokenSource.GetNextToken();");
+					ostr.WriteLine("        cc_lastpos = cc_scanpos = cc_scanpos.Next = " + nextToken + ";");
 					ostr.WriteLine("      } else {");
 					ostr.WriteLine("        cc_lastpos = cc_scanpos = cc_scanpos.Next;");
 					ostr.WriteLine("      }");
@@ -449,7 +547,7 @@ namespace Deveel.CSharpCC.Parser {
 					if (Options.getErrorReporting()) {
 						ostr.WriteLine("    if (cc_rescan) {");
 						ostr.WriteLine("      int i = 0; Token tok = token;");
-						ostr.WriteLine("      while (tok != null && tok != cc_scanpos) { i++; tok = tok.next; }");
+						ostr.WriteLine("      while (tok != null && tok != cc_scanpos) { i++; tok = tok.Next; }");
 						ostr.WriteLine("      if (tok != null) cc_add_error_token(kind, i);");
 						if (Options.getDebugLookahead()) {
 							ostr.WriteLine("    } else {");
@@ -459,7 +557,7 @@ namespace Deveel.CSharpCC.Parser {
 					} else if (Options.getDebugLookahead()) {
 						ostr.WriteLine("    trace_scan(cc_scanpos, kind);");
 					}
-					ostr.WriteLine("    if (cc_scanpos.kind != kind) return true;");
+					ostr.WriteLine("    if (cc_scanpos.Kind != kind) return true;");
 					ostr.WriteLine("    if (cc_la == 0 && cc_scanpos == cc_lastpos) throw cc_ls;");
 					ostr.WriteLine("    return false;");
 					ostr.WriteLine("  }");
@@ -469,11 +567,11 @@ namespace Deveel.CSharpCC.Parser {
 				ostr.WriteLine("/** Get the next Token. */");
 				ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + " public Token GetNextToken() {");
 				if (Options.getCacheTokens()) {
-					ostr.WriteLine("    if ((token = cc_nt).Next != null) cc_nt = cc_nt.next;");
-					ostr.WriteLine("    else cc_nt = cc_nt.Next = tokenSource.GetNextToken();");
+					ostr.WriteLine("    if ((token = cc_nt).Next != null) cc_nt = cc_nt.Next;");
+					ostr.WriteLine("    else cc_nt = cc_nt.Next = " + nextToken + ";");
 				} else {
 					ostr.WriteLine("    if (token.Next != null) token = token.Next;");
-					ostr.WriteLine("    else token = token.Next = tokenSource.GetNextToken();");
+					ostr.WriteLine("    else token = token.Next = " + nextToken + ";");
 					ostr.WriteLine("    cc_ntKind = -1;");
 				}
 				if (Options.getErrorReporting()) {
@@ -494,7 +592,7 @@ namespace Deveel.CSharpCC.Parser {
 				}
 				ostr.WriteLine("    for (int i = 0; i < index; i++) {");
 				ostr.WriteLine("      if (t.Next != null) t = t.Next;");
-				ostr.WriteLine("      else t = t.Next = tokenSource.GetNextToken();");
+				ostr.WriteLine("      else t = t.Next = " + nextToken + ";");
 				ostr.WriteLine("    }");
 				ostr.WriteLine("    return t;");
 				ostr.WriteLine("  }");
@@ -502,7 +600,7 @@ namespace Deveel.CSharpCC.Parser {
 				if (!Options.getCacheTokens()) {
 					ostr.WriteLine("  private " + CSharpCCGlobals.staticOpt() + "int cc_ntk() {");
 					ostr.WriteLine("    if ((cc_nt=token.Next) == null)");
-					ostr.WriteLine("      return (cc_ntKind = (token.Next = tokenSource.GetNextToken()).Kind);");
+					ostr.WriteLine("      return (cc_ntKind = (token.Next = " + nextToken + ").Kind);");
 					ostr.WriteLine("    else");
 					ostr.WriteLine("      return (cc_ntKind = cc_nt.Kind);");
 					ostr.WriteLine("  }");
@@ -529,17 +627,16 @@ namespace Deveel.CSharpCC.Parser {
 						ostr.WriteLine("        cc_expentry[i] = cc_lasttokens[i];");
 						ostr.WriteLine("      }");
 						ostr.WriteLine("      foreach (int[] oldentry in cc_expentries) {");
-						ostr.WriteLine("        if (oldentry.length == cc_expentry.length) {");
-						ostr.WriteLine("          for (int i = 0; i < cc_expentry.length; i++) {");
-						ostr.WriteLine("            if (oldentry[i] != cc_expentry[i]) {");
-						ostr.WriteLine("              goto cc_entries_loop;");
-						ostr.WriteLine("            }");
-						ostr.WriteLine("          }");
-						ostr.WriteLine("          cc_expentries.add(cc_expentry);");
-						ostr.WriteLine("          goto cc_entries_loop;");
+						ostr.WriteLine("        if (oldentry.Length == cc_expentry.Length) {");
+						ostr.WriteLine("          int i = 0;");
+						ostr.WriteLine("          while (i < cc_expentry.Length && oldentry[i] == cc_expentry[i])");
+						ostr.WriteLine("            i++;");
+						ostr.WriteLine("          if (i < cc_expentry.Length)");
+						ostr.WriteLine("            continue;");
+						ostr.WriteLine("          cc_expentries.Add(cc_expentry);");
+						ostr.WriteLine("          break;");
 						ostr.WriteLine("        }");
 						ostr.WriteLine("      }");
-						ostr.WriteLine("      cc_entries_loop:;");
 						ostr.WriteLine("      if (pos != 0) cc_lasttokens[(cc_endpos = pos) - 1] = kind;");
 						ostr.WriteLine("    }");
 						ostr.WriteLine("  }");
@@ -652,7 +749,7 @@ namespace Deveel.CSharpCC.Parser {
 					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private void trace_scan(Token t1, int t2) {");
 					ostr.WriteLine("    if (trace_enabled) {");
 					ostr.WriteLine("      for (int i = 0; i < trace_indent; i++) { Console.Out.Write(\" \"); }");
-					ostr.WriteLine("      Console.Out.Write(\"Visited token: <\" + tokenImage[t1.kind]);");
+					ostr.WriteLine("      Console.Out.Write(\"Visited token: <\" + tokenImage[t1.Kind]);");
 					ostr.WriteLine("      if (t1.Kind != 0 && !tokenImage[t1.Kind].Equals(\"\\\"\" + t1.Image + \"\\\"\")) {");
 					ostr.WriteLine("        Console.Out.Write(\": \\\"\" + t1.Image + \"\\\"\");");
 					ostr.WriteLine("      }");
@@ -672,10 +769,56 @@ namespace Deveel.CSharpCC.Parser {
 					ostr.WriteLine("");
 				}
 
+				if (InstrumentGen.Enabled) {
+					ostr.WriteLine("  private readonly long[] cc_calls = new long[" + CSharpCCGlobals.bnfproductions.Count + "];");
+					ostr.WriteLine("  private int cc_depth;");
+					ostr.WriteLine("  private long cc_entry_start;");
+					ostr.WriteLine("  private long cc_consumed;");
+					ostr.WriteLine("");
+					ostr.WriteLine("  private void cc_enter(int production) {");
+					ostr.WriteLine("    cc_calls[production]++;");
+					ostr.WriteLine("    if (cc_depth++ == 0) cc_entry_start = System.Diagnostics.Stopwatch.GetTimestamp();");
+					ostr.WriteLine("  }");
+					ostr.WriteLine("");
+					ostr.WriteLine("  private void cc_exit() {");
+					ostr.WriteLine("    if (--cc_depth == 0) {");
+					ostr.WriteLine("      " + InstrumentGen.ClassName + ".Log.EntryPointCompleted(" +
+					               "System.Diagnostics.Stopwatch.GetTimestamp() - cc_entry_start, cc_calls, cc_consumed);");
+					ostr.WriteLine("      Array.Clear(cc_calls, 0, cc_calls.Length);");
+					ostr.WriteLine("      cc_consumed = 0;");
+					ostr.WriteLine("    }");
+					ostr.WriteLine("  }");
+					ostr.WriteLine("");
+				}
+
+				if (TreeGen.Enabled) {
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private readonly " + TreeGen.ClassName + " cc_tree = new " + TreeGen.ClassName + "();");
+					ostr.WriteLine("");
+					ostr.WriteLine("  /** The tree of the productions called since the parser was created or reinitialised. */");
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public " + TreeGen.ClassName + " Tree {");
+					ostr.WriteLine("    get { return cc_tree; }");
+					ostr.WriteLine("  }");
+					ostr.WriteLine("");
+				}
+
+				if (EventSinkGen.Enabled) {
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private " + EventSinkGen.TypeParameter + " cc_sink;");
+					ostr.WriteLine("");
+					ostr.WriteLine("  /** The sink of the events of the parser: the parser calls its own copy. */");
+					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "public " + EventSinkGen.TypeParameter + " Sink {");
+					ostr.WriteLine("    get { return cc_sink; }");
+					ostr.WriteLine("    set { cc_sink = value; }");
+					ostr.WriteLine("  }");
+					ostr.WriteLine("");
+				}
+
 				if (CSharpCCGlobals.cc2index != 0 && Options.getErrorReporting()) {
 					ostr.WriteLine("  " + CSharpCCGlobals.staticOpt() + "private void cc_rescan_token() {");
 					ostr.WriteLine("    cc_rescan = true;");
 					ostr.WriteLine("    for (int i = 0; i < " + CSharpCCGlobals.cc2index + "; i++) {");
+					if (Options.getProfileLookahead()) {
+						ostr.WriteLine("    long cc_scanned_before = cc_scanned;");
+					}
 					ostr.WriteLine("    try {");
 					ostr.WriteLine("      CCCalls p = cc_2_rtns[i];");
 					ostr.WriteLine("      do {");
@@ -690,6 +833,10 @@ namespace Deveel.CSharpCC.Parser {
 					ostr.WriteLine("        p = p.next;");
 					ostr.WriteLine("      } while (p != null);");
 					ostr.WriteLine("      } catch(LookaheadSuccess) { }");
+					if (Options.getProfileLookahead()) {
+						ostr.WriteLine("    if (cc_scanned != cc_scanned_before)");
+						ostr.WriteLine("      " + LookaheadProfileGen.ClassName + ".RecordRescan(i, cc_scanned - cc_scanned_before);");
+					}
 					ostr.WriteLine("    }");
 					ostr.WriteLine("    cc_rescan = false;");
 					ostr.WriteLine("  }");
@@ -731,12 +878,93 @@ namespace Deveel.CSharpCC.Parser {
 
 			    ostr.Close();
 
+			    MethodSize.CheckFile(Path.Combine(Options.getOutputDirectory().FullName, CSharpCCGlobals.cu_name + ".cs"));
+
 			} // matches "if (Options.getBuildParser())"
 
 		}
 
+		private static void printRingStart() {
+			if (pipelined) {
+				ostr.WriteLine("    cc_ring = new TokenRing(new TokenRing.TokenSource(tokenSource.GetNextToken), " +
+				               Options.getTokenRingSize() + ");");
+			}
+		}
+
+		private static void printRingStop() {
+			if (pipelined) {
+				ostr.WriteLine("    if (cc_ring != null) cc_ring.Stop();");
+			}
+		}
+
+		/// <summary>
+		/// Checks whether the token manager can run ahead of the parser: this is not
+		/// the case when the parser changes the lexical state (<c>SwitchTo</c>) or
+		/// when the token manager calls back into the parser.
+		/// </summary>
+		private static bool CanPipeline() {
+			if (Options.getTokenManagerUsesParser()) {
+				CSharpCCErrors.Warning("Option PIPELINED_TOKEN_MANAGER is ignored since option " +
+				                       "TOKEN_MANAGER_USES_PARSER has been set to true.");
+				return false;
+			}
+
+			Token switchTo = FindSwitchTo(CSharpCCGlobals.cu_to_insertion_point_2) ??
+			                 FindSwitchTo(CSharpCCGlobals.cu_from_insertion_point_2);
+
+			if (switchTo == null) {
+				SwitchToFinder finder = new SwitchToFinder();
+				foreach (NormalProduction p in CSharpCCGlobals.bnfproductions) {
+					if (p is CodeProduction) {
+						finder.Found = finder.Found ?? FindSwitchTo(((CodeProduction) p).CodeTokens);
+					} else if (p is BnfProduction) {
+						finder.Found = finder.Found ?? FindSwitchTo(((BnfProduction) p).DeclarationTokens);
+						ExpansionTreeWalker.PreOrderWalk(p.Expansion, finder);
+					}
+				}
+				switchTo = finder.Found;
+			}
+
+			if (switchTo != null) {
+				CSharpCCErrors.Warning(switchTo, "The parser changes the lexical state: " +
+				                                 "option PIPELINED_TOKEN_MANAGER is ignored and tokens are read synchronously.");
+				return false;
+			}
+
+			return true;
+		}
+
+		private static Token FindSwitchTo(IEnumerable<Token> tokens) {
+			foreach (Token t in tokens) {
+				if (t.image == "SwitchTo")
+					return t;
+			}
+
+			return null;
+		}
+
+		private class SwitchToFinder : ITreeWalkerOp {
+			public Token Found;
+
+			public bool GoDeeper(Expansion e) {
+				return Found == null;
+			}
+
+			public void Action(Expansion e) {
+				if (Found != null)
+					return;
+
+				if (e is Action) {
+					Found = FindSwitchTo(((Action) e).ActionTokens);
+				} else if (e is Lookahead) {
+					Found = FindSwitchTo(((Lookahead) e).ActionTokens);
+				}
+			}
+		}
+
 		public static void reInit() {
 			ostr = null;
+			pipelined = false;
 			CSharpCCGlobals.lookaheadNeeded = false;
 		}
 	}
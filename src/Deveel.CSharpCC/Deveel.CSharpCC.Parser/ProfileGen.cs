@@ -0,0 +1,226 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the profile of a parser (option <c>PROFILE_PARSER</c>), that
+	/// counts the calls of every production, the alternatives taken at every
+	/// choice and the tokens consumed, and reads back the file it writes
+	/// (option <c>PROFILE_FILE</c>) to lay out the generated code for the paths
+	/// that are hot in the profile.
+	/// </summary>
+	/// <remarks>
+	/// Choices are identified by their production and their position in it, and
+	/// tokens by their image in the constants class, so that a profile can still
+	/// be used after the grammar changed: the choices whose number of alternatives
+	/// changed are left in the order of the grammar.
+	/// </remarks>
+	public class ProfileGen {
+		private sealed class ChoiceSite {
+			public string Production;
+			public int Ordinal;
+			public int Offset;
+		}
+
+		private const string Header = "csharpcc-profile";
+
+		private static readonly List<ChoiceSite> sites = new List<ChoiceSite>();
+		private static int alternatives;
+
+		private static bool loaded;
+		private static readonly Dictionary<string, long[]> choiceCounts = new Dictionary<string, long[]>();
+		private static readonly Dictionary<string, long> tokenCounts = new Dictionary<string, long>();
+
+		/// <summary>
+		/// Whether the parser counts its productions, choices and tokens.
+		/// </summary>
+		public static bool Enabled {
+			get { return Options.getProfileParser() && Options.getBuildParser(); }
+		}
+
+		/// <summary>
+		/// The name of the generated profile class.
+		/// </summary>
+		public static string ClassName {
+			get { return CSharpCCGlobals.cu_name + "Profile"; }
+		}
+
+		/// <summary>
+		/// Records a choice of the parser and gets the index of the counter of
+		/// its first alternative, or -1 if the parser is not profiled.
+		/// </summary>
+		internal static int AddChoice(string production, int ordinal, int count) {
+			if (!Enabled)
+				return -1;
+
+			ChoiceSite site = new ChoiceSite();
+			site.Production = production;
+			site.Ordinal = ordinal;
+			site.Offset = alternatives;
+			sites.Add(site);
+			alternatives += count;
+			return site.Offset;
+		}
+
+		/// <summary>
+		/// Gets how many times the profile took each alternative of a choice, or
+		/// <c>null</c> if the choice is not in the profile.
+		/// </summary>
+		internal static long[] GetChoiceCounts(string production, int ordinal, int count) {
+			Load();
+
+			long[] counts;
+			if (!choiceCounts.TryGetValue(ChoiceKey(production, ordinal), out counts) || counts.Length != count)
+				return null;
+
+			long total = 0;
+			foreach (long n in counts)
+				total += n;
+			return total == 0 ? null : counts;
+		}
+
+		/// <summary>
+		/// Whether the profile counted any token.
+		/// </summary>
+		internal static bool HasTokenCounts {
+			get {
+				Load();
+				return tokenCounts.Count > 0;
+			}
+		}
+
+		/// <summary>
+		/// Gets how many tokens of the given kind the profile consumed.
+		/// </summary>
+		internal static long GetTokenCount(int kind) {
+			Load();
+
+			long count;
+			return tokenCounts.TryGetValue(TokenImage(kind), out count) ? count : 0;
+		}
+
+		// The value of TokenImage[kind] in the constants class.
+		private static string TokenImage(int kind) {
+			if (kind == 0)
+				return "<EOF>";
+
+			RegularExpression re;
+			if (!CSharpCCGlobals.rexps_of_tokens.TryGetValue(kind, out re))
+				return "<token of kind " + kind + ">";
+			if (re is RStringLiteral)
+				return "\"" + CSharpCCGlobals.AddEscapes(((RStringLiteral) re).Image) + "\"";
+			if (!re.Label.Equals(""))
+				return "<" + re.Label + ">";
+			return "<token of kind " + kind + ">";
+		}
+
+		private static string ChoiceKey(string production, int ordinal) {
+			return production + "#" + ordinal.ToString(CultureInfo.InvariantCulture);
+		}
+
+		public static void start() {
+			if (!Enabled)
+				return;
+
+			StringBuilder productions = new StringBuilder();
+			foreach (NormalProduction p in CSharpCCGlobals.bnfproductions) {
+				if (productions.Length > 0)
+					productions.Append(", ");
+				productions.Append('"').Append(p.Lhs).Append('"');
+			}
+
+			StringBuilder choiceProductions = new StringBuilder();
+			StringBuilder choiceOrdinals = new StringBuilder();
+			StringBuilder choiceOffsets = new StringBuilder();
+			foreach (ChoiceSite site in sites) {
+				if (choiceProductions.Length > 0) {
+					choiceProductions.Append(", ");
+					choiceOrdinals.Append(", ");
+					choiceOffsets.Append(", ");
+				}
+				choiceProductions.Append('"').Append(site.Production).Append('"');
+				choiceOrdinals.Append(site.Ordinal.ToString(CultureInfo.InvariantCulture));
+				choiceOffsets.Append(site.Offset.ToString(CultureInfo.InvariantCulture));
+			}
+
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["PARSER_NAME"] = CSharpCCGlobals.cu_name;
+			options["PRODUCTION_NAMES"] = productions.ToString();
+			options["CHOICE_PRODUCTIONS"] = choiceProductions.ToString();
+			options["CHOICE_ORDINALS"] = choiceOrdinals.ToString();
+			options["CHOICE_OFFSETS"] = choiceOffsets.ToString();
+			options["ALTERNATIVES"] = alternatives.ToString(CultureInfo.InvariantCulture);
+
+			CSharpFiles.GenerateProfile(ClassName + ".cs", options);
+		}
+
+		private static void Load() {
+			if (loaded)
+				return;
+
+			loaded = true;
+			string path = Options.getProfileFile();
+			if (path.Equals(""))
+				return;
+
+			try {
+				using (StreamReader reader = new StreamReader(path)) {
+					string line = reader.ReadLine();
+					if (line == null || !line.StartsWith(Header + " ")) {
+						CSharpCCErrors.Warning("\"" + path + "\" is not a profile written by a parser. Option PROFILE_FILE is ignored.");
+						return;
+					}
+
+					string[] header = line.Split(' ');
+					if (header.Length > 2 && !header[2].Equals(CSharpCCGlobals.cu_name))
+						CSharpCCErrors.Warning("The profile \"" + path + "\" was written by the parser " + header[2] + ".");
+
+					while ((line = reader.ReadLine()) != null)
+						ReadLine(line);
+				}
+			} catch (IOException e) {
+				CSharpCCErrors.Warning("Cannot read the profile \"" + path + "\": " + e.Message + " Option PROFILE_FILE is ignored.");
+			} catch (UnauthorizedAccessException e) {
+				CSharpCCErrors.Warning("Cannot read the profile \"" + path + "\": " + e.Message + " Option PROFILE_FILE is ignored.");
+			}
+		}
+
+		// choice <production> <ordinal> <count>...
+		// token <count> <image>
+		// The "production <calls> <name>" lines are only there to be read.
+		private static void ReadLine(string line) {
+			string[] parts = line.Split(new char[] { ' ' }, 3);
+			if (parts.Length < 3)
+				return;
+
+			if (parts[0].Equals("choice")) {
+				string[] values = parts[2].Split(' ');
+				int ordinal;
+				if (!Int32.TryParse(values[0], NumberStyles.None, CultureInfo.InvariantCulture, out ordinal))
+					return;
+
+				long[] counts = new long[values.Length - 1];
+				for (int i = 0; i < counts.Length; i++) {
+					if (!Int64.TryParse(values[i + 1], NumberStyles.None, CultureInfo.InvariantCulture, out counts[i]))
+						return;
+				}
+				choiceCounts[ChoiceKey(parts[1], ordinal)] = counts;
+			} else if (parts[0].Equals("token")) {
+				long count;
+				if (Int64.TryParse(parts[1], NumberStyles.None, CultureInfo.InvariantCulture, out count))
+					tokenCounts[parts[2]] = count;
+			}
+		}
+
+		public static void reInit() {
+			sites.Clear();
+			alternatives = 0;
+			loaded = false;
+			choiceCounts.Clear();
+			tokenCounts.Clear();
+		}
+	}
+}
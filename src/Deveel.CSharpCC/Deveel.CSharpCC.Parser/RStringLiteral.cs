@@ -410,6 +410,35 @@ namespace Deveel.CSharpCC.Parser {
 			return ret;
 		}
 
+		// The kinds of the literals ending at a position of the DFA, the ones most
+		// consumed in the profile first. Two of them can only be both active when
+		// their images differ just by the case, and then the lowest kind must win.
+		private static List<int> GetFinalKinds(long[] finalKinds, int maxLongsReqd) {
+			List<int> kinds = new List<int>();
+			for (int j = 0; j < maxLongsReqd; j++) {
+				for (int k = 0; k < 64; k++) {
+					if ((finalKinds[j] & (1L << k)) != 0L)
+						kinds.Add(j * 64 + k);
+				}
+			}
+
+			if (kinds.Count < 2 || !ProfileGen.HasTokenCounts)
+				return kinds;
+
+			for (int a = 0; a < kinds.Count; a++) {
+				for (int b = a + 1; b < kinds.Count; b++) {
+					if (String.Equals(allImages[kinds[a]], allImages[kinds[b]], StringComparison.OrdinalIgnoreCase))
+						return kinds;
+				}
+			}
+
+			kinds.Sort(delegate(int x, int y) {
+				int c = ProfileGen.GetTokenCount(y).CompareTo(ProfileGen.GetTokenCount(x));
+				return c != 0 ? c : x.CompareTo(y);
+			});
+			return kinds;
+		}
+
 	    internal static void DumpDfaCode(TextWriter ostr) {
 			IDictionary<string, KindInfo> tab;
 			String key;
@@ -630,78 +659,72 @@ namespace Deveel.CSharpCC.Parser {
 
 					ostr.WriteLine("      case " + (int) c + ":");
 
-					long matchedKind;
 					String prefix = (i == 0) ? "         " : "            ";
 
 					if (info.finalKindCnt != 0) {
-						for (j = 0; j < maxLongsReqd; j++) {
-							if ((matchedKind = info.finalKinds[j]) == 0L)
-								continue;
+						foreach (int finalKind in GetFinalKinds(info.finalKinds, maxLongsReqd)) {
+							j = finalKind / 64;
+							k = finalKind % 64;
 
-							for (k = 0; k < 64; k++) {
-								if ((matchedKind & (1L << k)) == 0L)
-									continue;
+							if (ifGenerated) {
+								ostr.Write("         else if ");
+							} else if (i != 0)
+								ostr.Write("         if ");
 
-								if (ifGenerated) {
-									ostr.Write("         else if ");
-								} else if (i != 0)
-									ostr.Write("         if ");
+							ifGenerated = true;
 
-								ifGenerated = true;
-
-								int kindToPrint;
-								if (i != 0) {
-									ostr.WriteLine("((active" + j + " & " + (1L << k) + "L) != 0L)");
-								}
+							int kindToPrint;
+							if (i != 0) {
+								ostr.WriteLine("((active" + j + " & " + (1L << k) + "L) != 0L)");
+							}
 
-								if (intermediateKinds != null &&
-								    intermediateKinds[(j*64 + k)] != null &&
-								    intermediateKinds[(j*64 + k)][i] < (j*64 + k) &&
-								    intermediateMatchedPos != null &&
-								    intermediateMatchedPos[(j*64 + k)][i] == i) {
-									CSharpCCErrors.Warning(" \"" +
-									                     CSharpCCGlobals.AddEscapes(allImages[j*64 + k]) +
-									                     "\" cannot be matched as a string literal token " +
-									                     "at line " + GetLine(j*64 + k) + ", column " + GetColumn(j*64 + k) +
-									                     ". It will be matched as " +
-									                     GetLabel(intermediateKinds[(j*64 + k)][i]) + ".");
-									kindToPrint = intermediateKinds[(j*64 + k)][i];
-								} else if (i == 0 &&
-								           LexGen.canMatchAnyChar[LexGen.lexStateIndex] >= 0 &&
-								           LexGen.canMatchAnyChar[LexGen.lexStateIndex] < (j*64 + k)) {
-									CSharpCCErrors.Warning(" \"" +
-									                     CSharpCCGlobals.AddEscapes(allImages[j*64 + k]) +
-									                     "\" cannot be matched as a string literal token " +
-									                     "at line " + GetLine(j*64 + k) + ", column " + GetColumn(j*64 + k) +
-									                     ". It will be matched as " +
-									                     GetLabel(LexGen.canMatchAnyChar[LexGen.lexStateIndex]) + ".");
-									kindToPrint = LexGen.canMatchAnyChar[LexGen.lexStateIndex];
+							if (intermediateKinds != null &&
+							    intermediateKinds[(j*64 + k)] != null &&
+							    intermediateKinds[(j*64 + k)][i] < (j*64 + k) &&
+							    intermediateMatchedPos != null &&
+							    intermediateMatchedPos[(j*64 + k)][i] == i) {
+								CSharpCCErrors.Warning(" \"" +
+								                     CSharpCCGlobals.AddEscapes(allImages[j*64 + k]) +
+								                     "\" cannot be matched as a string literal token " +
+								                     "at line " + GetLine(j*64 + k) + ", column " + GetColumn(j*64 + k) +
+								                     ". It will be matched as " +
+								                     GetLabel(intermediateKinds[(j*64 + k)][i]) + ".");
+								kindToPrint = intermediateKinds[(j*64 + k)][i];
+							} else if (i == 0 &&
+							           LexGen.canMatchAnyChar[LexGen.lexStateIndex] >= 0 &&
+							           LexGen.canMatchAnyChar[LexGen.lexStateIndex] < (j*64 + k)) {
+								CSharpCCErrors.Warning(" \"" +
+								                     CSharpCCGlobals.AddEscapes(allImages[j*64 + k]) +
+								                     "\" cannot be matched as a string literal token " +
+								                     "at line " + GetLine(j*64 + k) + ", column " + GetColumn(j*64 + k) +
+								                     ". It will be matched as " +
+								                     GetLabel(LexGen.canMatchAnyChar[LexGen.lexStateIndex]) + ".");
+								kindToPrint = LexGen.canMatchAnyChar[LexGen.lexStateIndex];
+							} else
+								kindToPrint = j*64 + k;
+
+							if (!subString[(j*64 + k)]) {
+								int stateSetName = GetStateSetForKind(i, j*64 + k);
+
+								if (stateSetName != -1) {
+									createStartNfa = true;
+									ostr.WriteLine(prefix + "return ccStartNfaWithStates" +
+									             LexGen.lexStateSuffix + "(" + i +
+									             ", " + kindToPrint + ", " + stateSetName + ");");
 								} else
-									kindToPrint = j*64 + k;
-
-								if (!subString[(j*64 + k)]) {
-									int stateSetName = GetStateSetForKind(i, j*64 + k);
-
-									if (stateSetName != -1) {
-										createStartNfa = true;
-										ostr.WriteLine(prefix + "return ccStartNfaWithStates" +
-										             LexGen.lexStateSuffix + "(" + i +
-										             ", " + kindToPrint + ", " + stateSetName + ");");
-									} else
-										ostr.WriteLine(prefix + "return ccStopAtPos" + "(" + i + ", " + kindToPrint + ");");
-								} else {
-									if ((LexGen.initMatch[LexGen.lexStateIndex] != 0 &&
-									     LexGen.initMatch[LexGen.lexStateIndex] != Int32.MaxValue) ||
-									    i != 0) {
-										ostr.WriteLine("         {");
-										ostr.WriteLine(prefix + "ccMatchedKind = " +
-										             kindToPrint + ";");
-										ostr.WriteLine(prefix + "ccMatchedPos = " + i + ";");
-										ostr.WriteLine("         }");
-									} else
-										ostr.WriteLine(prefix + "ccMatchedKind = " +
-										             kindToPrint + ";");
-								}
+									ostr.WriteLine(prefix + "return ccStopAtPos" + "(" + i + ", " + kindToPrint + ");");
+							} else {
+								if ((LexGen.initMatch[LexGen.lexStateIndex] != 0 &&
+								     LexGen.initMatch[LexGen.lexStateIndex] != Int32.MaxValue) ||
+								    i != 0) {
+									ostr.WriteLine("         {");
+									ostr.WriteLine(prefix + "ccMatchedKind = " +
+									             kindToPrint + ";");
+									ostr.WriteLine(prefix + "ccMatchedPos = " + i + ";");
+									ostr.WriteLine("         }");
+								} else
+									ostr.WriteLine(prefix + "ccMatchedKind = " +
+									             kindToPrint + ";");
 							}
 						}
 					}
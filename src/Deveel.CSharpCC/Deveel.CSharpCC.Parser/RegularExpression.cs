@@ -14,6 +14,10 @@ namespace Deveel.CSharpCC.Parser {
 
         public string Label { get; internal set; }
 
+        // The kind of the token, apart from the position of the expansion in
+        // its sequence: a string literal of a production is both.
+        internal new int Ordinal { get; set; }
+
         public Token RhsToken { get; internal set; }
 
         public IList<Token> LhsTokens {
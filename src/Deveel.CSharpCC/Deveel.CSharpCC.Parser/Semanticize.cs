@@ -421,8 +421,10 @@ namespace Deveel.CSharpCC.Parser {
        * The following code performs the lookahead ambiguity checking.
        */
                 if (CSharpCCErrors.ErrorCount == 0) {
-                    foreach (var prod in CSharpCCGlobals.bnfproductions)
-                        ExpansionTreeWalker.PreOrderWalk(prod.Expansion, new LookaheadChecker());
+                    using (GenerationStats.Begin("LookaheadCalc")) {
+                        foreach (var prod in CSharpCCGlobals.bnfproductions)
+                            ExpansionTreeWalker.PreOrderWalk(prod.Expansion, new LookaheadChecker());
+                    }
                 }
             } // matches "if (Options.getSanityCheck()) {"
 
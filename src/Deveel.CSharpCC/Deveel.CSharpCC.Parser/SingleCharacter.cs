@@ -1,7 +1,7 @@
 ﻿using System;
 
 namespace Deveel.CSharpCC.Parser {
-	public class SingleCharacter {
+	public class SingleCharacter : ILocationInfo {
 		public SingleCharacter(char c) {
 			Character = c;
 		}
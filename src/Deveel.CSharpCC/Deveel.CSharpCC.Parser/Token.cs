@@ -53,6 +53,50 @@ public  class Token {
    */
   public Token specialToken;
 
+  /**
+   * The fields above, under the names a token manager or parser generated by the
+   * csharpcc of this project uses: a meta-parser generated by it keeps this token.
+   */
+  public int Kind {
+	  get { return kind; }
+	  set { kind = value; }
+  }
+
+  public int BeginLine {
+	  get { return beginLine; }
+	  set { beginLine = value; }
+  }
+
+  public int BeginColumn {
+	  get { return beginColumn; }
+	  set { beginColumn = value; }
+  }
+
+  public int EndLine {
+	  get { return endLine; }
+	  set { endLine = value; }
+  }
+
+  public int EndColumn {
+	  get { return endColumn; }
+	  set { endColumn = value; }
+  }
+
+  public string Image {
+	  get { return image; }
+	  set { image = value; }
+  }
+
+  public Token Next {
+	  get { return next; }
+	  set { next = value; }
+  }
+
+  public Token SpecialToken {
+	  get { return specialToken; }
+	  set { specialToken = value; }
+  }
+
   public Token(int kind)
 	  : this(kind, null) {
   }
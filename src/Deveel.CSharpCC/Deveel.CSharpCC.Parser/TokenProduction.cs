@@ -2,7 +2,7 @@
 using System.Collections.Generic;
 
 namespace Deveel.CSharpCC.Parser {
-    public class TokenProduction {
+    public class TokenProduction : ILocationInfo {
         private readonly IList<RegExprSpec> respecs;
 
 		  public const int TOKEN  = 0,
@@ -16,6 +16,7 @@ namespace Deveel.CSharpCC.Parser {
 
         public TokenProduction() {
             respecs = new List<RegExprSpec>();
+            IsExplicit = true;
         }
 
         public int Column { get; internal set; }
@@ -0,0 +1,390 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+using Deveel.CSharpCC.Util;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates a tokenizer that lexes a whole buffer in parallel (option
+	/// <c>PARALLEL_TOKENIZER</c>): the input is split at line boundaries, every
+	/// chunk is lexed speculatively from a guessed lexical state and the chunks
+	/// are then stitched together, re-lexing only where a guess was wrong.
+	/// </summary>
+	public class TokenizerGen {
+		private static TextWriter ostr;
+
+		public static void start() {
+			if (CSharpCCErrors.ErrorCount != 0)
+				throw new MetaParseException();
+
+			if (!CanGenerate())
+				return;
+
+			string className = CSharpCCGlobals.cu_name + "Tokenizer";
+			string tokMgrName = CSharpCCGlobals.cu_name + "TokenManager";
+			string constantsName = CSharpCCGlobals.cu_name + "Constants";
+
+			try {
+				ostr =
+					new StreamWriter(new GeneratedFileStream(Path.Combine(Options.getOutputDirectory().FullName, className + ".cs")));
+			} catch (IOException) {
+				CSharpCCErrors.SemanticError("Could not open file " + className + ".cs for writing.");
+				throw new InvalidOperationException();
+			}
+
+			List<string> tn = new List<string>(CSharpCCGlobals.ToolNames);
+			tn.Add(CSharpCCGlobals.ToolName);
+			ostr.WriteLine("/* " + CSharpCCGlobals.GetIdString(tn, className + ".cs") + " */");
+
+			bool namespaceInserted = false;
+			if (CSharpCCGlobals.cu_to_insertion_point_1.Count != 0 &&
+			    CSharpCCGlobals.cu_to_insertion_point_1[0].kind == CSharpCCParserConstants.NAMESPACE) {
+				Token t = null;
+				for (int i = 1; i < CSharpCCGlobals.cu_to_insertion_point_1.Count; i++) {
+					if (CSharpCCGlobals.cu_to_insertion_point_1[i].kind == CSharpCCParserConstants.SEMICOLON) {
+						CSharpCCGlobals.PrintTokenSetup(CSharpCCGlobals.cu_to_insertion_point_1[0]);
+						for (int j = 0; j <= i; j++) {
+							t = CSharpCCGlobals.cu_to_insertion_point_1[j];
+							if (t.kind != CSharpCCParserConstants.SEMICOLON)
+								CSharpCCGlobals.PrintToken(t, ostr);
+						}
+						CSharpCCGlobals.PrintTrailingComments(t, ostr);
+						namespaceInserted = true;
+						ostr.WriteLine("{");
+						break;
+					}
+				}
+			}
+
+			ostr.WriteLine("");
+			ostr.WriteLine("/// <summary>");
+			ostr.WriteLine("/// Lexes a whole input in parallel.");
+			ostr.WriteLine("/// </summary>");
+			ostr.WriteLine("/// <remarks>");
+			ostr.WriteLine("/// The input is split into chunks starting at the beginning of a line, and every");
+			ostr.WriteLine("/// chunk is lexed on its own from one or more guessed lexical states. The chunks");
+			ostr.WriteLine("/// are then stitched in order: the lexing of a chunk is kept from the first token");
+			ostr.WriteLine("/// on which it agrees with the previous chunk (same position, kind and lexical");
+			ostr.WriteLine("/// state), and the chunk is lexed again sequentially where no guess agrees.");
+			ostr.WriteLine("/// </remarks>");
+			if (Options.getSupportClassVisibilityPublic()) {
+				ostr.Write("public ");
+			}
+			ostr.WriteLine("static class " + className + " {");
+			ostr.WriteLine("  private const int DefaultLexState = " + LexGen.defaultLexState + ";");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private delegate void Job(int index);");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>");
+			ostr.WriteLine("  /// Lexes the input with one chunk per processor, guessing the default lexical");
+			ostr.WriteLine("  /// state at the start of every chunk.");
+			ostr.WriteLine("  /// </summary>");
+			ostr.WriteLine("  public static System.Collections.Generic.List<Token> Tokenize(string text) {");
+			ostr.WriteLine("    return Tokenize(text, System.Environment.ProcessorCount, new int[] { DefaultLexState });");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  /// <summary>");
+			ostr.WriteLine("  /// Lexes the input split in (at most) <paramref name=\"chunkCount\"/> chunks, lexing");
+			ostr.WriteLine("  /// every chunk from each of the <paramref name=\"candidateStates\"/> (see");
+			ostr.WriteLine("  /// " + tokMgrName + ".lexStateNames).");
+			ostr.WriteLine("  /// </summary>");
+			ostr.WriteLine("  /// <returns>The tokens of the input, the last one being the EOF token.</returns>");
+			if (Options.clrVersionAtLeast(4.5)) {
+				ostr.WriteLine("  /// <exception cref=\"TokenManagerError\">The input has a lexical error, thrown with the stack trace of the worker.</exception>");
+			} else {
+				ostr.WriteLine("  /// <exception cref=\"System.InvalidOperationException\">The input has a lexical error, kept as the inner exception.</exception>");
+			}
+			ostr.WriteLine("  public static System.Collections.Generic.List<Token> Tokenize(string text, int chunkCount, int[] candidateStates) {");
+			ostr.WriteLine("    if (text == null)");
+			ostr.WriteLine("      throw new System.ArgumentNullException(\"text\");");
+			ostr.WriteLine("    if (chunkCount <= 0)");
+			ostr.WriteLine("      throw new System.ArgumentOutOfRangeException(\"chunkCount\");");
+			ostr.WriteLine("    if (candidateStates == null || candidateStates.Length == 0)");
+			ostr.WriteLine("      throw new System.ArgumentException(\"At least one candidate state is required.\", \"candidateStates\");");
+			ostr.WriteLine("    foreach (int state in candidateStates) {");
+			ostr.WriteLine("      if (state < 0 || state >= " + tokMgrName + ".lexStateNames.Length)");
+			ostr.WriteLine("        throw new System.ArgumentOutOfRangeException(\"candidateStates\");");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    int[] starts = Split(text, chunkCount);");
+			ostr.WriteLine("    int count = starts.Length;");
+			ostr.WriteLine("    int guesses = candidateStates.Length;");
+			ostr.WriteLine("");
+			ostr.WriteLine("    // The chunks start on a new line, so counting the line terminators in");
+			ostr.WriteLine("    // the previous chunks is enough to know where they begin.");
+			ostr.WriteLine("    int[] lines = new int[count];");
+			ostr.WriteLine("    ForEach(count, delegate(int i) {");
+			ostr.WriteLine("      lines[i] = CountLines(text, starts[i], i + 1 < count ? starts[i + 1] : text.Length);");
+			ostr.WriteLine("    });");
+			ostr.WriteLine("    int line = 1;");
+			ostr.WriteLine("    for (int i = 0; i < count; i++) {");
+			ostr.WriteLine("      int n = lines[i];");
+			ostr.WriteLine("      lines[i] = line;");
+			ostr.WriteLine("      line += n;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    Run[,] runs = new Run[count, guesses];");
+			ostr.WriteLine("    ForEach(count * guesses, delegate(int job) {");
+			ostr.WriteLine("      int i = job / guesses, guess = job % guesses;");
+			ostr.WriteLine("      // The first chunk starts in the default state: no guess needed.");
+			ostr.WriteLine("      if (i == 0 && guess > 0)");
+			ostr.WriteLine("        return;");
+			ostr.WriteLine("      int state = i == 0 ? DefaultLexState : candidateStates[guess];");
+			ostr.WriteLine("      runs[i, guess] = Lex(text, starts[i], lines[i], 1, state, Limit(starts, i), null);");
+			ostr.WriteLine("    });");
+			ostr.WriteLine("");
+			ostr.WriteLine("    System.Collections.Generic.List<Token> tokens = new System.Collections.Generic.List<Token>();");
+			ostr.WriteLine("    Run run = runs[0, 0];");
+			ostr.WriteLine("    int from = 0;");
+			ostr.WriteLine("    for (int i = 1; ; i++) {");
+			ostr.WriteLine("      for (int j = from; j < run.Tokens.Count; j++)");
+			ostr.WriteLine("        tokens.Add(run.Tokens[j]);");
+			ostr.WriteLine("      if (run.Error != null)");
+			// The error was caught on a worker thread: keep its stack trace.
+			if (Options.clrVersionAtLeast(4.5)) {
+				ostr.WriteLine("        System.Runtime.ExceptionServices.ExceptionDispatchInfo.Capture(run.Error).Throw();");
+			} else {
+				ostr.WriteLine("        throw new System.InvalidOperationException(\"The input failed to lex on a worker thread.\", run.Error);");
+			}
+			ostr.WriteLine("");
+			ostr.WriteLine("      int last = run.Tokens.Count - 1;");
+			ostr.WriteLine("      Token t = run.Tokens[last];");
+			ostr.WriteLine("      if (t.Kind == " + constantsName + ".EOF || i >= count)");
+			ostr.WriteLine("        return tokens;");
+			ostr.WriteLine("");
+			ostr.WriteLine("      // 't' is the first token at or after the start of chunk i: look for it in");
+			ostr.WriteLine("      // the speculative runs of the chunk.");
+			ostr.WriteLine("      Run[] candidates = new Run[guesses];");
+			ostr.WriteLine("      for (int guess = 0; guess < guesses; guess++)");
+			ostr.WriteLine("        candidates[guess] = runs[i, guess];");
+			ostr.WriteLine("");
+			ostr.WriteLine("      Run next = null;");
+			ostr.WriteLine("      from = -1;");
+			ostr.WriteLine("      foreach (Run candidate in candidates) {");
+			ostr.WriteLine("        from = candidate.Find(t.Kind, run.Begins[last], run.Ends[last], run.States[last]);");
+			ostr.WriteLine("        if (from >= 0) {");
+			ostr.WriteLine("          next = candidate;");
+			ostr.WriteLine("          break;");
+			ostr.WriteLine("        }");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("");
+			ostr.WriteLine("      if (next == null) {");
+			ostr.WriteLine("        // No guess agrees: lex the chunk again from the end of 't', in the");
+			ostr.WriteLine("        // state the lexer is really in, until it meets one of the guesses.");
+			ostr.WriteLine("        int end = run.Ends[last];");
+			ostr.WriteLine("        int beginLine, beginColumn;");
+			ostr.WriteLine("        if (end == run.Begins[last]) {");
+			ostr.WriteLine("          beginLine = t.BeginLine;");
+			ostr.WriteLine("          beginColumn = t.BeginColumn;");
+			ostr.WriteLine("        } else {");
+			ostr.WriteLine("          char c = text[end - 1];");
+			ostr.WriteLine("          if (c == '\\n' || (c == '\\r' && (end == text.Length || text[end] != '\\n'))) {");
+			ostr.WriteLine("            beginLine = t.EndLine + 1;");
+			ostr.WriteLine("            beginColumn = 1;");
+			ostr.WriteLine("          } else {");
+			ostr.WriteLine("            beginLine = t.EndLine;");
+			ostr.WriteLine("            beginColumn = t.EndColumn + 1;");
+			ostr.WriteLine("          }");
+			ostr.WriteLine("        }");
+			ostr.WriteLine("        next = Lex(text, end, beginLine, beginColumn, run.States[last], Limit(starts, i), candidates);");
+			ostr.WriteLine("        from = 0;");
+			ostr.WriteLine("      } else {");
+			ostr.WriteLine("        from++;");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("      run = next;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private static int Limit(int[] starts, int i) {");
+			ostr.WriteLine("    return i + 1 < starts.Length ? starts[i + 1] : System.Int32.MaxValue;");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private static int[] Split(string text, int chunkCount) {");
+			ostr.WriteLine("    System.Collections.Generic.List<int> starts = new System.Collections.Generic.List<int>();");
+			ostr.WriteLine("    starts.Add(0);");
+			ostr.WriteLine("    for (int k = 1; k < chunkCount; k++) {");
+			ostr.WriteLine("      int p = (int) ((long) text.Length * k / chunkCount);");
+			ostr.WriteLine("      int eol = text.IndexOfAny(new char[] { '\\r', '\\n' }, System.Math.Max(p, starts[starts.Count - 1]));");
+			ostr.WriteLine("      if (eol < 0)");
+			ostr.WriteLine("        break;");
+			ostr.WriteLine("      int start = eol + 1;");
+			ostr.WriteLine("      if (text[eol] == '\\r' && start < text.Length && text[start] == '\\n')");
+			ostr.WriteLine("        start++;");
+			ostr.WriteLine("      if (start >= text.Length)");
+			ostr.WriteLine("        break;");
+			ostr.WriteLine("      if (start > starts[starts.Count - 1])");
+			ostr.WriteLine("        starts.Add(start);");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("    return starts.ToArray();");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  // Counts the line terminators the way SimpleCharStream does.");
+			ostr.WriteLine("  private static int CountLines(string text, int start, int end) {");
+			ostr.WriteLine("    int n = 0;");
+			ostr.WriteLine("    for (int i = start; i < end; i++) {");
+			ostr.WriteLine("      char c = text[i];");
+			ostr.WriteLine("      if (c == '\\n' || (c == '\\r' && (i + 1 == text.Length || text[i + 1] != '\\n')))");
+			ostr.WriteLine("        n++;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("    return n;");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  // Lexes from 'start' until the first token beginning at or after 'limit'. When");
+			ostr.WriteLine("  // 'candidates' are given, the lexing stops as soon as a token agrees with one of");
+			ostr.WriteLine("  // them, and the rest of that candidate is taken instead.");
+			ostr.WriteLine("  private static Run Lex(string text, int start, int line, int column, int state, int limit, Run[] candidates) {");
+			ostr.WriteLine("    Run run = new Run();");
+			ostr.WriteLine("    SimpleCharStream stream = new SimpleCharStream(new Slice(text, start), line, column);");
+			ostr.WriteLine("    " + tokMgrName + " tm = new " + tokMgrName + "(stream, state);");
+			ostr.WriteLine("    try {");
+			ostr.WriteLine("      for (;;) {");
+			ostr.WriteLine("        Token t = tm.GetNextToken();");
+			ostr.WriteLine("        int begin = start + stream.BeginOffset;");
+			ostr.WriteLine("        int end = start + stream.EndOffset;");
+			ostr.WriteLine("        run.Add(t, begin, end, tm.LexicalState);");
+			ostr.WriteLine("        if (t.Kind == " + constantsName + ".EOF || begin >= limit)");
+			ostr.WriteLine("          return run;");
+			ostr.WriteLine("");
+			ostr.WriteLine("        if (candidates != null) {");
+			ostr.WriteLine("          foreach (Run candidate in candidates) {");
+			ostr.WriteLine("            int index = candidate.Find(t.Kind, begin, end, tm.LexicalState);");
+			ostr.WriteLine("            if (index >= 0) {");
+			ostr.WriteLine("              run.AddRange(candidate, index + 1);");
+			ostr.WriteLine("              return run;");
+			ostr.WriteLine("            }");
+			ostr.WriteLine("          }");
+			ostr.WriteLine("        }");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("    } catch (TokenManagerError e) {");
+			ostr.WriteLine("      run.Error = e;");
+			ostr.WriteLine("      return run;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  private static void ForEach(int count, Job job) {");
+			ostr.WriteLine("    int next = -1;");
+			ostr.WriteLine("    System.Exception error = null;");
+			ostr.WriteLine("    object sync = new object();");
+			ostr.WriteLine("    System.Threading.ThreadStart body = delegate {");
+			ostr.WriteLine("      try {");
+			ostr.WriteLine("        int i;");
+			ostr.WriteLine("        while ((i = System.Threading.Interlocked.Increment(ref next)) < count)");
+			ostr.WriteLine("          job(i);");
+			ostr.WriteLine("      } catch (System.Exception e) {");
+			ostr.WriteLine("        lock (sync) {");
+			ostr.WriteLine("          if (error == null)");
+			ostr.WriteLine("            error = e;");
+			ostr.WriteLine("        }");
+			ostr.WriteLine("      }");
+			ostr.WriteLine("    };");
+			ostr.WriteLine("");
+			ostr.WriteLine("    System.Threading.Thread[] threads = new System.Threading.Thread[System.Math.Min(System.Environment.ProcessorCount, count)];");
+			ostr.WriteLine("    for (int i = 0; i < threads.Length; i++) {");
+			ostr.WriteLine("      threads[i] = new System.Threading.Thread(body);");
+			ostr.WriteLine("      threads[i].IsBackground = true;");
+			ostr.WriteLine("      threads[i].Start();");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("    foreach (System.Threading.Thread thread in threads)");
+			ostr.WriteLine("      thread.Join();");
+			ostr.WriteLine("    if (error != null)");
+			ostr.WriteLine("      throw new System.InvalidOperationException(\"The parallel lexing failed.\", error);");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  // The tokens lexed from a position, with their offsets and the lexical state");
+			ostr.WriteLine("  // the token manager is in after each of them.");
+			ostr.WriteLine("  private sealed class Run {");
+			ostr.WriteLine("    public readonly System.Collections.Generic.List<Token> Tokens = new System.Collections.Generic.List<Token>();");
+			ostr.WriteLine("    public readonly System.Collections.Generic.List<int> Begins = new System.Collections.Generic.List<int>();");
+			ostr.WriteLine("    public readonly System.Collections.Generic.List<int> Ends = new System.Collections.Generic.List<int>();");
+			ostr.WriteLine("    public readonly System.Collections.Generic.List<int> States = new System.Collections.Generic.List<int>();");
+			ostr.WriteLine("    public System.Exception Error;");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public void Add(Token t, int begin, int end, int state) {");
+			ostr.WriteLine("      Tokens.Add(t);");
+			ostr.WriteLine("      Begins.Add(begin);");
+			ostr.WriteLine("      Ends.Add(end);");
+			ostr.WriteLine("      States.Add(state);");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public void AddRange(Run other, int from) {");
+			ostr.WriteLine("      for (int i = from; i < other.Tokens.Count; i++)");
+			ostr.WriteLine("        Add(other.Tokens[i], other.Begins[i], other.Ends[i], other.States[i]);");
+			ostr.WriteLine("      Error = other.Error;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    // From a token both runs agree on, the token manager is in the same");
+			ostr.WriteLine("    // position and state: the rest of the run is what a sequential lexing gives.");
+			ostr.WriteLine("    public int Find(int kind, int begin, int end, int state) {");
+			ostr.WriteLine("      int i = Begins.BinarySearch(begin);");
+			ostr.WriteLine("      if (i >= 0 && Ends[i] == end && States[i] == state && Tokens[i].Kind == kind)");
+			ostr.WriteLine("        return i;");
+			ostr.WriteLine("      return -1;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("");
+			ostr.WriteLine("  // Reads the input from an offset without copying it.");
+			ostr.WriteLine("  private sealed class Slice : System.IO.TextReader {");
+			ostr.WriteLine("    private readonly string text;");
+			ostr.WriteLine("    private int position;");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public Slice(string text, int start) {");
+			ostr.WriteLine("      this.text = text;");
+			ostr.WriteLine("      position = start;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public override int Peek() {");
+			ostr.WriteLine("      return position < text.Length ? text[position] : -1;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public override int Read() {");
+			ostr.WriteLine("      return position < text.Length ? text[position++] : -1;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("");
+			ostr.WriteLine("    public override int Read(char[] buffer, int index, int count) {");
+			ostr.WriteLine("      int n = System.Math.Min(count, text.Length - position);");
+			ostr.WriteLine("      if (n <= 0)");
+			ostr.WriteLine("        return 0;");
+			ostr.WriteLine("      text.CopyTo(position, buffer, index, n);");
+			ostr.WriteLine("      position += n;");
+			ostr.WriteLine("      return n;");
+			ostr.WriteLine("    }");
+			ostr.WriteLine("  }");
+			ostr.WriteLine("}");
+			if (namespaceInserted)
+				ostr.WriteLine("}");
+			ostr.Close();
+		}
+
+		private static bool CanGenerate() {
+			string reason = null;
+			if (Options.getStatic()) {
+				reason = "STATIC is set to true";
+			} else if (!Options.getBuildTokenManager()) {
+				reason = "the token manager is not generated";
+			} else if (Options.getUserTokenManager() || Options.getUserCharStream() || Options.getUnicodeEscape()) {
+				reason = "the parallel tokenizer requires the generated token manager and SimpleCharStream";
+			} else if (Options.getTokenManagerUsesParser()) {
+				reason = "TOKEN_MANAGER_USES_PARSER is set to true";
+			} else if (!Options.getKeepLineColumn()) {
+				reason = "KEEP_LINE_COLUMN is set to false";
+			}
+
+			if (reason != null) {
+				CSharpCCErrors.Warning("Option PARALLEL_TOKENIZER is ignored since " + reason + ".");
+				return false;
+			}
+
+			if (CSharpCCGlobals.token_mgr_decls != null && CSharpCCGlobals.token_mgr_decls.Count > 0) {
+				CSharpCCErrors.Warning("The parallel tokenizer lexes every chunk with its own token manager: " +
+				                       "state declared in TOKEN_MGR_DECLS is not carried from one chunk to the next.");
+			}
+
+			return true;
+		}
+
+		public static void reInit() {
+			ostr = null;
+		}
+	}
+}
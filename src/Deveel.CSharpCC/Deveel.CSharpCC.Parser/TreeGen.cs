@@ -0,0 +1,67 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Generates the parse tree built by a parser (option <c>BUILD_TREE</c>): every
+	/// production opens a node when called and closes it when it returns, in an
+	/// arena of structures linked by index, without a preprocessor of the grammar.
+	/// </summary>
+	public class TreeGen {
+		private static bool? enabled;
+
+		/// <summary>
+		/// Whether the parser builds its tree: warns the first time if the option
+		/// is set but cannot be honored.
+		/// </summary>
+		public static bool Enabled {
+			get {
+				if (enabled == null)
+					enabled = CanBuildTree();
+				return enabled.Value;
+			}
+		}
+
+		/// <summary>
+		/// The name of the generated tree class.
+		/// </summary>
+		public static string ClassName {
+			get { return CSharpCCGlobals.cu_name + "Tree"; }
+		}
+
+		public static void start() {
+			if (!Enabled)
+				return;
+
+			StringBuilder names = new StringBuilder();
+			foreach (NormalProduction p in CSharpCCGlobals.bnfproductions) {
+				if (names.Length > 0)
+					names.Append(", ");
+				names.Append('"').Append(p.Lhs).Append('"');
+			}
+
+			IDictionary<string, object> options = new Dictionary<string, object>(Options.getOptions());
+			options["PARSER_NAME"] = CSharpCCGlobals.cu_name;
+			options["PRODUCTION_NAMES"] = names.ToString();
+
+			CSharpFiles.GenerateParseTree(ClassName + ".cs", options);
+		}
+
+		private static bool CanBuildTree() {
+			if (!Options.getBuildTree())
+				return false;
+
+			if (CSharpCCGlobals.TreeGenerated) {
+				CSharpCCErrors.Warning("Option BUILD_TREE is ignored since the grammar was generated by CSTree.");
+				return false;
+			}
+
+			return true;
+		}
+
+		public static void reInit() {
+			enabled = null;
+		}
+	}
+}
@@ -8,6 +8,7 @@ namespace Deveel.CSharpCC.Parser {
 			Line = token.beginLine;
 			Column = token.beginColumn;
 			Expansion = expansion;
+			Expansion.Parent = this;
 		}
 
 		public ZeroOrOne() {
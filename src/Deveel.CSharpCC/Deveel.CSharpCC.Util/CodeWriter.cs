@@ -0,0 +1,137 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace Deveel.CSharpCC.Util {
+	/// <summary>
+	/// Writes generated code, starting every new line at the current indentation.
+	/// </summary>
+	/// <remarks>
+	/// A writer over an output writes through to it. A writer created without one keeps
+	/// the code, with its line breaks relative to its own indentation, until it is written
+	/// to another writer at the indentation of that one: this is how the code of the
+	/// alternatives of a choice is generated before the lookahead that selects them.
+	/// </remarks>
+	internal sealed class CodeWriter : TextWriter {
+		private readonly TextWriter output;
+		private readonly StringBuilder text;
+		private readonly List<int> breakAt;
+		private readonly List<int> breakIndentation;
+		private char previous = ' ';
+
+		public CodeWriter(TextWriter output, int indentation) {
+			this.output = output;
+			Indentation = indentation;
+		}
+
+		public CodeWriter() {
+			text = new StringBuilder();
+			breakAt = new List<int>();
+			breakIndentation = new List<int>();
+		}
+
+		public CodeWriter(string code)
+			: this() {
+			Write(code);
+		}
+
+		public int Indentation { get; private set; }
+
+		/// <summary>
+		/// Whether the new lines are left unindented, to keep the layout of the user code.
+		/// </summary>
+		public bool Verbatim { get; set; }
+
+		public override Encoding Encoding {
+			get { return output != null ? output.Encoding : Encoding.Unicode; }
+		}
+
+		public void Indent() {
+			Indentation += 2;
+		}
+
+		public void Outdent() {
+			Indentation -= 2;
+		}
+
+		public override void Write(char value) {
+			char last = previous;
+			previous = value;
+
+			// A "\r\n" is a single new line.
+			if (value == '\n' && last == '\r')
+				return;
+
+			if (value == '\n' || value == '\r')
+				Break(Verbatim ? -1 : Indentation);
+			else if (output != null)
+				output.Write(value);
+			else
+				text.Append(value);
+		}
+
+		public override void Write(string value) {
+			if (value == null)
+				return;
+
+			int start = 0;
+			for (int i = 0; i < value.Length; i++) {
+				char c = value[i];
+				if (c == '\n' || c == '\r') {
+					Append(value, start, i - start);
+					Write(c);
+					start = i + 1;
+				}
+			}
+
+			Append(value, start, value.Length - start);
+		}
+
+		/// <summary>
+		/// Writes the code kept by a writer created without an output, indented from
+		/// the current indentation.
+		/// </summary>
+		public void Write(CodeWriter code) {
+			int start = 0;
+			for (int i = 0; i < code.breakAt.Count; i++) {
+				Append(code.text.ToString(start, code.breakAt[i] - start));
+				int indentation = code.breakIndentation[i];
+				Break(indentation < 0 ? -1 : Indentation + indentation);
+				start = code.breakAt[i];
+			}
+
+			Append(code.text.ToString(start, code.text.Length - start));
+			Indentation += code.Indentation;
+			if (code.breakAt.Count > 0 || code.text.Length > 0)
+				previous = code.previous;
+		}
+
+		private void Append(string value) {
+			Append(value, 0, value.Length);
+		}
+
+		private void Append(string value, int start, int length) {
+			if (length == 0)
+				return;
+
+			if (output != null)
+				output.Write(length == value.Length ? value : value.Substring(start, length));
+			else
+				text.Append(value, start, length);
+
+			previous = value[start + length - 1];
+		}
+
+		private void Break(int indentation) {
+			if (output == null) {
+				breakAt.Add(text.Length);
+				breakIndentation.Add(indentation);
+			} else {
+				output.WriteLine();
+				if (indentation > 0)
+					output.Write(new String(' ', indentation));
+			}
+		}
+	}
+}
@@ -0,0 +1,59 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+using Deveel.CSharpCC.Parser;
+
+namespace Deveel.CSharpCC.Util {
+	/// <summary>
+	/// Keeps what is written to a generated file and writes it when closed, only if it
+	/// differs from what the file already holds.
+	/// </summary>
+	/// <remarks>
+	/// An unchanged file keeps its timestamp, and does not make the project that
+	/// compiles it build again.
+	/// </remarks>
+	internal sealed class GeneratedFileStream : MemoryStream {
+		private readonly string file;
+		private bool closed;
+
+		public GeneratedFileStream(string file) {
+			this.file = file;
+		}
+
+		/// <summary>
+		/// When set, the generated files are kept in this table by their path instead of
+		/// being written, for a generation that runs inside another process.
+		/// </summary>
+		public static IDictionary<string, byte[]> Capture { get; set; }
+
+		protected override void Dispose(bool disposing) {
+			if (disposing && !closed) {
+				closed = true;
+
+				byte[] content = ToArray();
+				if (Capture != null)
+					Capture[file] = content;
+				else if (!File.Exists(file) || !SameContent(File.ReadAllBytes(file), content))
+					File.WriteAllBytes(file, content);
+
+				GenerationCache.AddOutput(file, content);
+				GenerationStats.AddGeneratedFile(content);
+			}
+
+			base.Dispose(disposing);
+		}
+
+		private static bool SameContent(byte[] existing, byte[] content) {
+			if (existing.Length != content.Length)
+				return false;
+
+			for (int i = 0; i < content.Length; i++) {
+				if (existing[i] != content[i])
+					return false;
+			}
+
+			return true;
+		}
+	}
+}
@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.IO;
 using System.Reflection;
 using System.Security.Cryptography;
@@ -15,6 +16,7 @@ namespace Deveel.CSharpCC.Util {
 		private readonly string file;
 		private readonly String compatibleVersion;
 		private readonly String[] options;
+		private readonly IDictionary<string, object> optionValues;
 
 		internal bool needToWrite;
 
@@ -24,12 +26,28 @@ namespace Deveel.CSharpCC.Util {
 		private const String MD5_LINE_PART_2q = " \\(do not edit this line\\) \\*/";
 
 
-		public OutputFile(string file, String compatibleVersion, String[] options) {
+		public OutputFile(string file, String compatibleVersion, String[] options)
+			: this(file, compatibleVersion, options, null, false) {
+		}
+
+		/// <summary>
+		/// Opens a file generated from a template, whose options are read in the given
+		/// values, and rebuilt when they differ from those it was generated with.
+		/// </summary>
+		/// <param name="file">The path of the file.</param>
+		/// <param name="compatibleVersion">The version of the generator.</param>
+		/// <param name="options">The names of the options the content depends on.</param>
+		/// <param name="optionValues">The values of the options, or null to read them in <see cref="Options"/>.</param>
+		/// <param name="rebuild">Whether the file is made from the grammar, and always rebuilt as the parser is.</param>
+		public OutputFile(string file, String compatibleVersion, String[] options, IDictionary<string, object> optionValues, bool rebuild) {
 			this.file = file;
 			this.compatibleVersion = compatibleVersion;
 			this.options = options;
+			this.optionValues = optionValues;
 
-			if (File.Exists(file)) {
+			if (rebuild) {
+				needToWrite = true;
+			} else if (File.Exists(file)) {
 				// Generate the checksum of the file, and compare with any value
 				// stored
 				// in the file.
@@ -66,8 +84,10 @@ namespace Deveel.CSharpCC.Util {
 						CheckVersion(file, compatibleVersion);
 					}
 
-					if (options != null) {
-						CheckOptions(file, options);
+					if (options != null && !CheckOptions(file, options)) {
+						// A file made for other options does not fit the parser.
+						Console.Out.WriteLine("File \"" + Path.GetFileName(file) + "\" was generated with other options and is being rebuilt.");
+						needToWrite = true;
 					}
 
 				} else {
@@ -119,20 +139,15 @@ namespace Deveel.CSharpCC.Util {
 			}
 		}
 
-		private void CheckOptions(string file, string[] options) {
+		// Whether the file was generated with the current values of the options, or
+		// has no record of them.
+		private bool CheckOptions(string file, string[] options) {
 			try {
-				StreamReader reader = new StreamReader(file);
-
-				String line;
-				while ((line = reader.ReadLine()) != null) {
-					if (line.StartsWith("/* CSharpCCOptions:")) {
-						String currentOptions = Options.GetOptionsString(options);
-						if (line.IndexOf(currentOptions) == -1) {
-							CSharpCCErrors.Warning(Path.GetFileName(file)
-								+ ": Generated using incompatible options. Please rename or delete this file so"
-								+ " that a new one can be generated for you.");
-						}
-						return;
+				using (StreamReader reader = new StreamReader(file)) {
+					String line;
+					while ((line = reader.ReadLine()) != null) {
+						if (line.StartsWith("/* CSharpCCOptions:"))
+							return line == "/* CSharpCCOptions:" + GetOptionsString() + " */";
 					}
 				}
 			} catch (FileNotFoundException e1) {
@@ -144,6 +159,11 @@ namespace Deveel.CSharpCC.Util {
 			}
 
 			// Not found so cannot check
+			return true;
+		}
+
+		private string GetOptionsString() {
+			return optionValues == null ? Options.GetOptionsString(options) : Options.GetOptionsString(optionValues, options);
 		}
 
 		public void Close() {
@@ -171,14 +191,14 @@ namespace Deveel.CSharpCC.Util {
 					throw new IOException("No MD5 implementation", e);
 				}
 
-				dos = new DigestOutputStream(new FileStream(file, FileMode.OpenOrCreate, FileAccess.Write), digest);
+				dos = new DigestOutputStream(new GeneratedFileStream(file), digest);
 				pw = new TrapCloseTextWriter(this, dos);
 
 				// Write the headers....
 				String version = compatibleVersion ?? typeof(OutputFile).Assembly.GetName().Version.ToString();
 				pw.WriteLine("/* " + CSharpCCGlobals.GetIdString(toolName, Path.GetFileName(file)) + " Version " + version + " */");
 				if (options != null) {
-					pw.WriteLine("/* CSharpCCOptions:" + Options.GetOptionsString(options) + " */");
+					pw.WriteLine("/* CSharpCCOptions:" + GetOptionsString() + " */");
 				}
 			}
 
@@ -244,6 +264,13 @@ namespace Deveel.CSharpCC.Util {
 				output.Flush();
 			}
 
+			protected override void Dispose(bool disposing) {
+				if (disposing)
+					output.Close();
+
+				base.Dispose(disposing);
+			}
+
 			public override long Seek(long offset, SeekOrigin origin) {
 				return output.Seek(offset, origin);
 			}
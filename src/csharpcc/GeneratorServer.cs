@@ -0,0 +1,166 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+namespace Deveel.CSharpCC.Parser {
+	/// <summary>
+	/// Keeps the generator running, so that a new generation does not pay for the
+	/// start of the process and the compilation of the generator again.
+	/// </summary>
+	/// <remarks>
+	/// <para>
+	/// With <c>--server</c>, every line read from the standard input is a command line
+	/// (the option settings and the grammar file), answered with the output of the
+	/// generation, errors included, and a last line <c>csharpcc-exit: &lt;code&gt;</c>.
+	/// An empty line or the end of the input stops the server.
+	/// </para>
+	/// <para>
+	/// With <c>--watch</c>, the grammars given are generated again every time they are
+	/// saved, until the process is stopped.
+	/// </para>
+	/// <para>
+	/// Every generation starts from a clean state: the generator keeps all it knows in
+	/// static fields. A grammar saved without change is skipped by the generation cache.
+	/// </para>
+	/// </remarks>
+	internal static class GeneratorServer {
+		private const int SettleMilliseconds = 200;
+
+		private static readonly object pendingLock = new object();
+		private static readonly Dictionary<string, DateTime> pending = new Dictionary<string, DateTime>(StringComparer.OrdinalIgnoreCase);
+
+		public static int Serve(TextReader input, TextWriter output) {
+			string line;
+			while ((line = input.ReadLine()) != null && line.Trim().Length != 0) {
+				// The generator writes to the console: the answer is all in the output,
+				// in the order it was written.
+				TextWriter stdout = Console.Out;
+				TextWriter stderr = Console.Error;
+				Console.SetOut(output);
+				Console.SetError(output);
+
+				int code;
+				try {
+					code = Program.MainProgram(SplitCommandLine(line));
+				} catch (Exception e) {
+					output.WriteLine(e.ToString());
+					code = 1;
+				} finally {
+					Console.SetOut(stdout);
+					Console.SetError(stderr);
+				}
+
+				output.WriteLine("csharpcc-exit: " + code);
+				output.Flush();
+			}
+
+			return 0;
+		}
+
+		public static int Watch(string[] args) {
+			List<string> options = new List<string>();
+			List<string> grammars = new List<string>();
+			foreach (string arg in args) {
+				if (Options.IsOption(arg))
+					options.Add(arg);
+				else
+					grammars.Add(Path.GetFullPath(arg));
+			}
+
+			if (grammars.Count == 0) {
+				Console.Out.WriteLine("No grammar file to watch.");
+				return 1;
+			}
+
+			List<FileSystemWatcher> watchers = new List<FileSystemWatcher>();
+			foreach (string grammar in grammars) {
+				if (!File.Exists(grammar)) {
+					Console.Out.WriteLine("File " + grammar + " not found.");
+					return 1;
+				}
+
+				FileSystemWatcher watcher = new FileSystemWatcher(Path.GetDirectoryName(grammar), Path.GetFileName(grammar));
+				watcher.NotifyFilter = NotifyFilters.LastWrite | NotifyFilters.FileName | NotifyFilters.Size;
+				watcher.Changed += OnGrammarChanged;
+				watcher.Created += OnGrammarChanged;
+				watcher.Renamed += OnGrammarChanged;
+				watcher.EnableRaisingEvents = true;
+				watchers.Add(watcher);
+
+				Generate(options, grammar);
+			}
+
+			Console.Out.WriteLine("Watching " + grammars.Count + " grammar(s); stop with Ctrl+C.");
+
+			// Editors often write a file several times when saving it: the generation
+			// waits for the events to settle.
+			while (true) {
+				Thread.Sleep(SettleMilliseconds / 2);
+
+				List<string> ready = new List<string>();
+				lock (pendingLock) {
+					foreach (KeyValuePair<string, DateTime> entry in pending) {
+						if ((DateTime.Now - entry.Value).TotalMilliseconds >= SettleMilliseconds)
+							ready.Add(entry.Key);
+					}
+
+					foreach (string grammar in ready)
+						pending.Remove(grammar);
+				}
+
+				foreach (string grammar in ready)
+					Generate(options, grammar);
+			}
+		}
+
+		private static void OnGrammarChanged(object sender, FileSystemEventArgs e) {
+			lock (pendingLock) {
+				pending[e.FullPath] = DateTime.Now;
+			}
+		}
+
+		private static void Generate(List<string> options, string grammar) {
+			string[] args = new string[options.Count + 1];
+			options.CopyTo(args, 0);
+			args[options.Count] = grammar;
+
+			Console.Out.WriteLine("");
+			Console.Out.WriteLine("[" + DateTime.Now.ToString("HH:mm:ss") + "] " + Path.GetFileName(grammar));
+			try {
+				Program.MainProgram(args);
+			} catch (Exception e) {
+				Console.Out.WriteLine(e.ToString());
+			}
+		}
+
+		// Splits a command line on the spaces, except between double quotes.
+		private static string[] SplitCommandLine(string line) {
+			List<string> args = new List<string>();
+			StringBuilder arg = new StringBuilder();
+			bool quoted = false;
+			bool any = false;
+
+			foreach (char c in line) {
+				if (c == '"') {
+					quoted = !quoted;
+					any = true;
+				} else if (Char.IsWhiteSpace(c) && !quoted) {
+					if (any)
+						args.Add(arg.ToString());
+					arg.Length = 0;
+					any = false;
+				} else {
+					arg.Append(c);
+					any = true;
+				}
+			}
+
+			if (any)
+				args.Add(arg.ToString());
+
+			return args.ToArray();
+		}
+	}
+}
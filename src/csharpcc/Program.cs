@@ -4,10 +4,16 @@ using System.Security;
 using System.Text;
 
 namespace Deveel.CSharpCC.Parser {
-	internal class Program {
+	public class Program {
 		private static void help_message() {
 			Console.Out.WriteLine("Usage:");
 			Console.Out.WriteLine("    csharpcc option-settings inputfile");
+			Console.Out.WriteLine("    csharpcc --watch option-settings inputfile...");
+			Console.Out.WriteLine("    csharpcc --server");
+			Console.Out.WriteLine("");
+			Console.Out.WriteLine("--watch generates the grammars again every time they are saved.");
+			Console.Out.WriteLine("--server reads one command line per line of the standard input and");
+			Console.Out.WriteLine("ends the output of each generation with \"csharpcc-exit: <code>\".");
 			Console.Out.WriteLine("");
 			Console.Out.WriteLine("\"option-settings\" is a sequence of settings separated by spaces.");
 			Console.Out.WriteLine("Each option setting must be of one of the following forms:");
@@ -26,6 +32,8 @@ namespace Deveel.CSharpCC.Parser {
 			Console.Out.WriteLine("    LOOKAHEAD              (default 1)");
 			Console.Out.WriteLine("    CHOICE_AMBIGUITY_CHECK (default 2)");
 			Console.Out.WriteLine("    OTHER_AMBIGUITY_CHECK  (default 1)");
+			Console.Out.WriteLine("    TOKEN_RING_SIZE        (default 1024)");
+			Console.Out.WriteLine("    MAX_METHOD_SIZE        (default 60000)");
 			Console.Out.WriteLine("");
 			Console.Out.WriteLine("The boolean valued options are:");
 			Console.Out.WriteLine("");
@@ -48,6 +56,19 @@ namespace Deveel.CSharpCC.Parser {
 			Console.Out.WriteLine("    FORCE_LA_CHECK         (default false)");
 			Console.Out.WriteLine("    CACHE_TOKENS           (default false)");
 			Console.Out.WriteLine("    KEEP_LINE_COLUMN       (default true)");
+			Console.Out.WriteLine("    PIPELINED_TOKEN_MANAGER (default false)");
+			Console.Out.WriteLine("    PARALLEL_TOKENIZER     (default false)");
+			Console.Out.WriteLine("    TOKEN_KIND_SCANNER     (default false)");
+			Console.Out.WriteLine("    INSTRUMENT             (default false)");
+			Console.Out.WriteLine("    PROFILE_LOOKAHEAD      (default false)");
+			Console.Out.WriteLine("    PROFILE_TOKEN_MANAGER  (default false)");
+			Console.Out.WriteLine("    STATS                  (default false)");
+			Console.Out.WriteLine("    PROFILE_PARSER         (default false)");
+			Console.Out.WriteLine("    UNICODE_TABLES         (default false)");
+			Console.Out.WriteLine("    KEYWORD_HASH           (default false)");
+			Console.Out.WriteLine("    GENERATION_CACHE       (default false)");
+			Console.Out.WriteLine("    BUILD_TREE             (default false)");
+			Console.Out.WriteLine("    EVENT_SINK             (default false)");
 			Console.Out.WriteLine("");
 			Console.Out.WriteLine("The string valued options are:");
 			Console.Out.WriteLine("");
@@ -56,6 +77,10 @@ namespace Deveel.CSharpCC.Parser {
 			Console.Out.WriteLine("    TOKEN_FACTORY          (default none)");
 			Console.Out.WriteLine("    CLR_VERSION            (default 2.0)");
 			Console.Out.WriteLine("    GRAMMAR_ENCODING       (defaults to platform file encoding)");
+			Console.Out.WriteLine("    STATEMENT_SEPARATOR    (default none)");
+			Console.Out.WriteLine("    INTERN_TOKENS          (default none)");
+			Console.Out.WriteLine("    TOKEN_VALUES           (default none)");
+			Console.Out.WriteLine("    PROFILE_FILE           (default none)");
 			Console.Out.WriteLine("");
 			Console.Out.WriteLine("EXAMPLE:");
 			Console.Out.WriteLine("    csharpcc -STATIC=false -LOOKAHEAD:2 -debug_parser mygrammar.cc");
@@ -64,18 +89,28 @@ namespace Deveel.CSharpCC.Parser {
 
 
 		private static void Main(string[] args) {
-			int errorcode = MainProgram(args);
+			int errorcode;
+			if (args.Length > 0 && args[0] == "--server") {
+				errorcode = GeneratorServer.Serve(Console.In, Console.Out);
+			} else if (args.Length > 0 && args[0] == "--watch") {
+				string[] rest = new string[args.Length - 1];
+				Array.Copy(args, 1, rest, 0, rest.Length);
+				errorcode = GeneratorServer.Watch(rest);
+			} else {
+				errorcode = MainProgram(args);
+			}
 			Environment.Exit(errorcode);
 		}
 
 		public static int MainProgram(String[] args) {
 
 			// Initialize all static state
-			ReInitAll();
+			CSharpCCGlobals.ReInitAll();
 
 			CSharpCCGlobals.BannerLine("Parser Generator", "");
 
 			CSharpCCParser parser = null;
+			StreamReader grammar = null;
 			if (args.Length == 0) {
 				Console.Out.WriteLine("");
 				help_message();
@@ -102,10 +137,9 @@ namespace Deveel.CSharpCC.Parser {
 					Console.Out.WriteLine("File " + args[args.Length - 1] + " not found.");
 					return 1;
 				}
-				parser =
-					new CSharpCCParser(
-						new StreamReader(new FileStream(args[args.Length - 1], FileMode.Open, FileAccess.Read, FileShare.Read),
-						                 Encoding.GetEncoding(Options.getGrammarEncoding())));
+				grammar = new StreamReader(new FileStream(args[args.Length - 1], FileMode.Open, FileAccess.Read, FileShare.Read),
+				                           Encoding.GetEncoding(Options.getGrammarEncoding()));
+				parser = new CSharpCCParser(grammar);
 			} catch (SecurityException) {
 				Console.Out.WriteLine("Security violation while trying to open " + args[args.Length - 1]);
 				return 1;
@@ -115,25 +149,46 @@ namespace Deveel.CSharpCC.Parser {
 			}
 
 			try {
-				Console.Out.WriteLine("Reading from file " + args[args.Length - 1] + " . . .");
-				CSharpCCGlobals.FileName = CSharpCCGlobals.OriginalFileName = args[args.Length - 1];
-				CSharpCCGlobals.TreeGenerated = CSharpCCGlobals.IsGeneratedBy("CSTree", args[args.Length - 1]);
-				CSharpCCGlobals.ToolNames = CSharpCCGlobals.GetToolNames(args[args.Length - 1]);
-				parser.csharpcc_input();
+				// The grammar is read at once: close it before the generation, that can
+				// take long in a server process.
+				using (grammar) {
+					Console.Out.WriteLine("Reading from file " + args[args.Length - 1] + " . . .");
+					CSharpCCGlobals.FileName = CSharpCCGlobals.OriginalFileName = args[args.Length - 1];
+					CSharpCCGlobals.TreeGenerated = CSharpCCGlobals.IsGeneratedBy("CSTree", args[args.Length - 1]);
+					CSharpCCGlobals.ToolNames = CSharpCCGlobals.GetToolNames(args[args.Length - 1]);
+					using (GenerationStats.Begin("CSharpCCParser.csharpcc_input")) {
+						parser.csharpcc_input();
+					}
+				}
 				CSharpCCGlobals.CreateOutputDir(Options.getOutputDirectory().FullName);
 
+				if (GenerationCache.IsUpToDate()) {
+					Console.Out.WriteLine("Parser is up to date: the grammar, the options and the generated files are unchanged.");
+					return 0;
+				}
+
 				if (Options.getUnicodeInput()) {
 					NfaState.unicodeWarningGiven = true;
 					Console.Out.WriteLine("Note: UNICODE_INPUT option is specified. " +
 					                      "Please make sure you create the parser/lexer using a Reader with the correct character encoding.");
 				}
 
-				Semanticize.start();
-				ParseGen.start();
-				LexGen.start();
-				OtherFilesGen.start();
+				using (GenerationStats.Begin("Semanticize.start")) {
+					Semanticize.start();
+				}
+				using (GenerationStats.Begin("ParseGen.start")) {
+					ParseGen.start();
+				}
+				using (GenerationStats.Begin("LexGen.start")) {
+					LexGen.start();
+				}
+				using (GenerationStats.Begin("OtherFilesGen.start")) {
+					OtherFilesGen.start();
+				}
+				GenerationStats.start();
 
 				if ((CSharpCCErrors.ErrorCount == 0) && (Options.getBuildParser() || Options.getBuildTokenManager())) {
+					GenerationCache.Save();
 					if (CSharpCCErrors.WarningCount == 0) {
 						Console.Out.WriteLine("Parser generated successfully.");
 					} else {
@@ -157,23 +212,5 @@ namespace Deveel.CSharpCC.Parser {
 				return 1;
 			}
 		}
-
-		private static void ReInitAll() {
-			Expansion.reInit();
-			CSharpCCErrors.ReInit();
-			CSharpCCGlobals.ReInit();
-			Options.init();
-			CSharpCCParserInternals.reInit();
-			RStringLiteral.reInit();
-			// CSharpFiles.reInit();
-			LexGen.reInit();
-			NfaState.reInit();
-			MatchInfo.reInit();
-			LookaheadWalk.reInit();
-			Semanticize.reInit();
-			ParseGen.reInit();
-			OtherFilesGen.reInit();
-			ParseEngine.reInit();
-		}
 	}
 }
\ No newline at end of file